@@ -514,6 +514,13 @@ bool OBSApp::InitGlobalConfigDefaults()
 	config_set_default_bool(globalConfig, "BasicWindow",
 				"MultiviewDrawAreas", true);
 
+	config_set_default_bool(globalConfig, "Audio", "ParallelAudioRender",
+				false);
+	config_set_default_bool(globalConfig, "Audio", "ParallelAudioEncode",
+				false);
+	config_set_default_uint(globalConfig, "Audio", "TickFrames",
+				AUDIO_OUTPUT_FRAMES);
+
 #ifdef _WIN32
 	config_set_default_bool(globalConfig, "Audio", "DisableAudioDucking",
 				true);
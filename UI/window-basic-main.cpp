@@ -4802,7 +4802,7 @@ bool OBSBasic::ResetAudio()
 {
 	ProfileScope("OBSBasic::ResetAudio");
 
-	struct obs_audio_info2 ai = {};
+	struct obs_audio_info3 ai = {};
 	ai.samples_per_sec =
 		config_get_uint(basicConfig, "Audio", "SampleRate");
 
@@ -4831,7 +4831,14 @@ bool OBSBasic::ResetAudio()
 		ai.fixed_buffering = true;
 	}
 
-	return obs_reset_audio2(&ai);
+	ai.parallel_render = config_get_bool(GetGlobalConfig(), "Audio",
+					     "ParallelAudioRender");
+	ai.parallel_encode = config_get_bool(GetGlobalConfig(), "Audio",
+					     "ParallelAudioEncode");
+	ai.frames_per_tick = (uint32_t)config_get_uint(
+		GetGlobalConfig(), "Audio", "TickFrames");
+
+	return obs_reset_audio3(&ai);
 }
 
 extern char *get_new_source_name(const char *name, const char *format);
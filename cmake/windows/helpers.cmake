@@ -68,6 +68,7 @@ function(set_target_properties_obs target)
     set_target_properties(${target} PROPERTIES VERSION 0 SOVERSION ${OBS_VERSION_CANONICAL})
 
     if(target STREQUAL libobs-d3d11
+       OR target STREQUAL libobs-null
        OR target STREQUAL libobs-opengl
        OR target STREQUAL libobs-winrt)
       set(target_destination "${OBS_EXECUTABLE_DESTINATION}")
@@ -553,6 +553,7 @@ bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info)
 
 	info2.opaque = c;
 	info2.v_cb = fill_video;
+	info2.v_ref_cb = NULL;
 	info2.a_cb = fill_audio;
 	info2.v_preload_cb = NULL;
 	info2.v_seek_cb = NULL;
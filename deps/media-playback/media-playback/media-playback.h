@@ -22,6 +22,9 @@ struct media_playback;
 typedef struct media_playback media_playback_t;
 
 typedef void (*mp_video_cb)(void *opaque, struct obs_source_frame *frame);
+typedef void (*mp_video_ref_cb)(void *opaque, struct obs_source_frame *frame,
+				obs_source_frame_release_t release,
+				void *param);
 typedef void (*mp_audio_cb)(void *opaque, struct obs_source_audio *audio);
 typedef void (*mp_stop_cb)(void *opaque);
 
@@ -29,6 +32,9 @@ struct mp_media_info {
 	void *opaque;
 
 	mp_video_cb v_cb;
+	/* optional, used instead of v_cb when the decoded frame can be
+	 * passed on without copying, release(param) frees it */
+	mp_video_ref_cb v_ref_cb;
 	mp_video_cb v_preload_cb;
 	mp_video_cb v_seek_cb;
 	mp_audio_cb a_cb;
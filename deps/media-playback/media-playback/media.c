@@ -396,6 +396,21 @@ void mp_media_next_audio(mp_media_t *m)
 	m->a_cb(m->opaque, &audio);
 }
 
+static void release_frame_ref(void *param)
+{
+	AVFrame *f = param;
+	av_frame_free(&f);
+}
+
+/* frames can be handed out by reference unless they're rescaled into
+ * m->scale_pic or transferred from the GPU into d->sw_frame, both of which
+ * are overwritten in place by the next frame */
+static inline bool can_ref_frame(mp_media_t *m, struct mp_decode *d,
+				 AVFrame *f)
+{
+	return m->v_ref_cb && !m->swscale && !(d->hw && f == d->sw_frame);
+}
+
 void mp_media_next_video(mp_media_t *m, bool preload)
 {
 	struct mp_decode *d = &m->v;
@@ -521,6 +536,12 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 		} else if (!m->request_preload) {
 			m->v_preload_cb(m->opaque, frame);
 		}
+	} else if (can_ref_frame(m, d, f)) {
+		AVFrame *ref = av_frame_clone(f);
+		if (ref)
+			m->v_ref_cb(m->opaque, frame, release_frame_ref, ref);
+		else
+			m->v_cb(m->opaque, frame);
 	} else {
 		m->v_cb(m->opaque, frame);
 	}
@@ -925,6 +946,7 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	pthread_mutex_init_value(&media->mutex);
 	media->opaque = info->opaque;
 	media->v_cb = info->v_cb;
+	media->v_ref_cb = info->v_ref_cb;
 	media->a_cb = info->a_cb;
 	media->stop_cb = info->stop_cb;
 	media->ffmpeg_options = info->ffmpeg_options;
@@ -0,0 +1,25 @@
+project(libobs-null)
+
+add_library(libobs-null SHARED)
+add_library(OBS::libobs-null ALIAS libobs-null)
+
+target_sources(libobs-null PRIVATE null-buffers.c null-shader.c null-subsystem.c null-subsystem.h null-texture.c)
+
+target_link_libraries(libobs-null PRIVATE OBS::libobs)
+
+set_target_properties(
+  libobs-null
+  PROPERTIES FOLDER "core"
+             VERSION "${OBS_VERSION_MAJOR}"
+             SOVERSION "1")
+
+if(OS_WINDOWS)
+  set(MODULE_DESCRIPTION "OBS Library null graphics module")
+  configure_file(${CMAKE_SOURCE_DIR}/cmake/bundle/windows/obs-module.rc.in libobs-null.rc)
+
+  target_sources(libobs-null PRIVATE libobs-null.rc)
+else()
+  set_target_properties(libobs-null PROPERTIES PREFIX "")
+endif()
+
+setup_binary_target(libobs-null)
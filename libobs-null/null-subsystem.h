@@ -0,0 +1,160 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/*
+ * Null graphics subsystem.  Textures and stage surfaces are plain system
+ * memory, draws and clears do nothing.  Meant for running the full libobs
+ * pipeline without a GPU (benchmarks, CI), not for producing real images.
+ */
+
+#include <util/darray.h>
+#include <graphics/graphics.h>
+#include <graphics/device-exports.h>
+#include <graphics/matrix4.h>
+
+struct gs_texture {
+	gs_device_t *device;
+	enum gs_texture_type type;
+	enum gs_color_format format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+	uint32_t levels;
+	uint32_t flags;
+
+	/* level 0 only, cube faces and volume slices are stored one after
+	 * another */
+	uint32_t linesize;
+	size_t slice_size;
+	uint8_t *data;
+};
+
+struct gs_stage_surface {
+	gs_device_t *device;
+	enum gs_color_format format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t linesize;
+	uint8_t *data;
+};
+
+struct gs_zstencil_buffer {
+	gs_device_t *device;
+	enum gs_zstencil_format format;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct gs_sampler_state {
+	gs_device_t *device;
+	struct gs_sampler_info info;
+};
+
+struct gs_vertex_buffer {
+	gs_device_t *device;
+	struct gs_vb_data *data;
+	uint32_t flags;
+};
+
+struct gs_index_buffer {
+	gs_device_t *device;
+	enum gs_index_type type;
+	void *data;
+	size_t num;
+	size_t width;
+	uint32_t flags;
+};
+
+struct gs_timer {
+	gs_device_t *device;
+};
+
+struct gs_timer_range {
+	gs_device_t *device;
+};
+
+struct gs_swap_chain {
+	gs_device_t *device;
+	struct gs_init_data info;
+};
+
+struct gs_shader_param {
+	enum gs_shader_param_type type;
+
+	char *name;
+	gs_shader_t *shader;
+	gs_samplerstate_t *next_sampler;
+	int array_count;
+
+	struct gs_texture *texture;
+	bool srgb;
+
+	DARRAY(uint8_t) cur_value;
+	DARRAY(uint8_t) def_value;
+};
+
+struct gs_shader {
+	gs_device_t *device;
+	enum gs_shader_type type;
+
+	struct gs_shader_param *viewproj;
+	struct gs_shader_param *world;
+
+	DARRAY(struct gs_shader_param) params;
+	DARRAY(gs_samplerstate_t *) samplers;
+};
+
+struct gs_device {
+	struct gs_swap_chain *cur_swap;
+
+	struct gs_texture *cur_render_target;
+	struct gs_zstencil_buffer *cur_zstencil_buffer;
+	enum gs_color_space cur_color_space;
+	int cur_render_side;
+	bool framebuffer_srgb;
+
+	struct gs_shader *cur_vertex_shader;
+	struct gs_shader *cur_pixel_shader;
+	struct gs_vertex_buffer *cur_vertex_buffer;
+	struct gs_index_buffer *cur_index_buffer;
+
+	enum gs_cull_mode cur_cull_mode;
+	struct gs_rect cur_viewport;
+
+	struct matrix4 cur_proj;
+	DARRAY(struct matrix4) proj_stack;
+};
+
+static inline size_t null_texture_linesize(enum gs_color_format format,
+					   uint32_t width)
+{
+	return ((size_t)width * gs_get_format_bpp(format) + 7) / 8;
+}
+
+/* compressed formats are stored in rows of 4x4 blocks */
+static inline size_t null_texture_slice_size(enum gs_color_format format,
+					     uint32_t width, uint32_t height)
+{
+	if (gs_is_compressed_format(format)) {
+		width = (width + 3) & ~3;
+		height = (height + 3) & ~3;
+	}
+
+	return null_texture_linesize(format, width) * height;
+}
@@ -0,0 +1,371 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "null-subsystem.h"
+
+static struct gs_texture *texture_create(gs_device_t *device,
+					 enum gs_texture_type type,
+					 uint32_t width, uint32_t height,
+					 uint32_t depth,
+					 enum gs_color_format color_format,
+					 uint32_t levels, uint32_t flags)
+{
+	struct gs_texture *tex;
+
+	if (!width || !height || !depth) {
+		blog(LOG_ERROR, "texture_create (null): Invalid size %ux%ux%u",
+		     width, height, depth);
+		return NULL;
+	}
+
+	tex = bzalloc(sizeof(struct gs_texture));
+	tex->device = device;
+	tex->type = type;
+	tex->format = color_format;
+	tex->width = width;
+	tex->height = height;
+	tex->depth = depth;
+	tex->levels = levels;
+	tex->flags = flags;
+	tex->linesize = (uint32_t)null_texture_linesize(color_format, width);
+	tex->slice_size = null_texture_slice_size(color_format, width, height);
+	tex->data = bzalloc(tex->slice_size * depth);
+	return tex;
+}
+
+/* only the top mip level is kept, the rest are never sampled */
+static inline void texture_upload(struct gs_texture *tex, uint32_t slice,
+				  const uint8_t *data)
+{
+	if (data)
+		memcpy(tex->data + tex->slice_size * slice, data,
+		       tex->slice_size);
+}
+
+gs_texture_t *device_texture_create(gs_device_t *device, uint32_t width,
+				    uint32_t height,
+				    enum gs_color_format color_format,
+				    uint32_t levels, const uint8_t **data,
+				    uint32_t flags)
+{
+	struct gs_texture *tex = texture_create(device, GS_TEXTURE_2D, width,
+						height, 1, color_format,
+						levels, flags);
+	if (tex && data)
+		texture_upload(tex, 0, data[0]);
+	return tex;
+}
+
+gs_texture_t *device_cubetexture_create(gs_device_t *device, uint32_t size,
+					enum gs_color_format color_format,
+					uint32_t levels, const uint8_t **data,
+					uint32_t flags)
+{
+	struct gs_texture *tex = texture_create(device, GS_TEXTURE_CUBE, size,
+						size, 6, color_format, levels,
+						flags);
+	uint32_t num_levels = levels;
+
+	if (!num_levels)
+		num_levels = gs_get_total_levels(size, size, 1);
+
+	if (tex && data) {
+		for (uint32_t i = 0; i < 6; i++)
+			texture_upload(tex, i, data[i * num_levels]);
+	}
+	return tex;
+}
+
+gs_texture_t *device_voltexture_create(gs_device_t *device, uint32_t width,
+				       uint32_t height, uint32_t depth,
+				       enum gs_color_format color_format,
+				       uint32_t levels,
+				       const uint8_t *const *data,
+				       uint32_t flags)
+{
+	struct gs_texture *tex = texture_create(device, GS_TEXTURE_3D, width,
+						height, depth, color_format,
+						levels, flags);
+	if (tex && data && data[0])
+		memcpy(tex->data, data[0], tex->slice_size * depth);
+	return tex;
+}
+
+enum gs_texture_type device_get_texture_type(const gs_texture_t *texture)
+{
+	return texture->type;
+}
+
+static void texture_destroy(gs_texture_t *tex)
+{
+	if (!tex)
+		return;
+
+	if (tex->device->cur_render_target == tex)
+		tex->device->cur_render_target = NULL;
+
+	bfree(tex->data);
+	bfree(tex);
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+	texture_destroy(tex);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	return tex->width;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	return tex->height;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex)
+{
+	return tex->format;
+}
+
+bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
+{
+	if (!(tex->flags & GS_DYNAMIC)) {
+		blog(LOG_ERROR,
+		     "gs_texture_map (null): Texture is not dynamic");
+		return false;
+	}
+
+	*ptr = tex->data;
+	*linesize = tex->linesize;
+	return true;
+}
+
+void gs_texture_unmap(gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+}
+
+void *gs_texture_get_obj(gs_texture_t *tex)
+{
+	return tex->data;
+}
+
+void gs_cubetexture_destroy(gs_texture_t *cubetex)
+{
+	texture_destroy(cubetex);
+}
+
+uint32_t gs_cubetexture_get_size(const gs_texture_t *cubetex)
+{
+	return cubetex->width;
+}
+
+enum gs_color_format
+gs_cubetexture_get_color_format(const gs_texture_t *cubetex)
+{
+	return cubetex->format;
+}
+
+void gs_voltexture_destroy(gs_texture_t *voltex)
+{
+	texture_destroy(voltex);
+}
+
+uint32_t gs_voltexture_get_width(const gs_texture_t *voltex)
+{
+	return voltex->width;
+}
+
+uint32_t gs_voltexture_get_height(const gs_texture_t *voltex)
+{
+	return voltex->height;
+}
+
+uint32_t gs_voltexture_get_depth(const gs_texture_t *voltex)
+{
+	return voltex->depth;
+}
+
+enum gs_color_format gs_voltexture_get_color_format(const gs_texture_t *voltex)
+{
+	return voltex->format;
+}
+
+gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width,
+					   uint32_t height,
+					   enum gs_color_format color_format)
+{
+	struct gs_stage_surface *surf;
+
+	surf = bzalloc(sizeof(struct gs_stage_surface));
+	surf->device = device;
+	surf->format = color_format;
+	surf->width = width;
+	surf->height = height;
+	surf->linesize = (uint32_t)null_texture_linesize(color_format, width);
+	surf->data = bzalloc((size_t)surf->linesize * height);
+	return surf;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
+{
+	if (stagesurf) {
+		bfree(stagesurf->data);
+		bfree(stagesurf);
+	}
+}
+
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->width;
+}
+
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->height;
+}
+
+enum gs_color_format
+gs_stagesurface_get_color_format(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->format;
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+			 uint32_t *linesize)
+{
+	*data = stagesurf->data;
+	*linesize = stagesurf->linesize;
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
+{
+	UNUSED_PARAMETER(stagesurf);
+}
+
+gs_zstencil_t *device_zstencil_create(gs_device_t *device, uint32_t width,
+				      uint32_t height,
+				      enum gs_zstencil_format format)
+{
+	struct gs_zstencil_buffer *zs;
+
+	zs = bzalloc(sizeof(struct gs_zstencil_buffer));
+	zs->device = device;
+	zs->format = format;
+	zs->width = width;
+	zs->height = height;
+	return zs;
+}
+
+void gs_zstencil_destroy(gs_zstencil_t *zs)
+{
+	if (!zs)
+		return;
+
+	if (zs->device->cur_zstencil_buffer == zs)
+		zs->device->cur_zstencil_buffer = NULL;
+
+	bfree(zs);
+}
+
+void device_copy_texture_region(gs_device_t *device, gs_texture_t *dst,
+				uint32_t dst_x, uint32_t dst_y,
+				gs_texture_t *src, uint32_t src_x,
+				uint32_t src_y, uint32_t src_w, uint32_t src_h)
+{
+	uint32_t bpp;
+	uint32_t nw, nh;
+
+	UNUSED_PARAMETER(device);
+
+	if (!src) {
+		blog(LOG_ERROR, "device_copy_texture_region (null): "
+				"Source texture is NULL");
+		return;
+	}
+	if (!dst) {
+		blog(LOG_ERROR, "device_copy_texture_region (null): "
+				"Destination texture is NULL");
+		return;
+	}
+	if (dst->type != GS_TEXTURE_2D || src->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "device_copy_texture_region (null): "
+				"Source and destination textures must be 2D");
+		return;
+	}
+	if (dst->format != src->format) {
+		blog(LOG_ERROR, "device_copy_texture_region (null): "
+				"Source and destination formats do not match");
+		return;
+	}
+
+	nw = src_w ? src_w : src->width - src_x;
+	nh = src_h ? src_h : src->height - src_y;
+
+	if (src_x + nw > src->width || src_y + nh > src->height ||
+	    dst_x + nw > dst->width || dst_y + nh > dst->height) {
+		blog(LOG_ERROR, "device_copy_texture_region (null): "
+				"Region is out of bounds");
+		return;
+	}
+
+	/* compressed formats are copied as whole textures only */
+	if (gs_is_compressed_format(src->format)) {
+		if (src->slice_size == dst->slice_size && !src_x && !src_y &&
+		    !dst_x && !dst_y)
+			memcpy(dst->data, src->data, src->slice_size);
+		return;
+	}
+
+	bpp = gs_get_format_bpp(src->format) / 8;
+	for (uint32_t y = 0; y < nh; y++) {
+		uint8_t *out = dst->data + (size_t)(dst_y + y) * dst->linesize +
+			       (size_t)dst_x * bpp;
+		const uint8_t *in = src->data +
+				    (size_t)(src_y + y) * src->linesize +
+				    (size_t)src_x * bpp;
+		memcpy(out, in, (size_t)nw * bpp);
+	}
+}
+
+void device_copy_texture(gs_device_t *device, gs_texture_t *dst,
+			 gs_texture_t *src)
+{
+	device_copy_texture_region(device, dst, 0, 0, src, 0, 0, 0, 0);
+}
+
+void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
+			  gs_texture_t *src)
+{
+	UNUSED_PARAMETER(device);
+
+	if (!src || !dst) {
+		blog(LOG_ERROR, "device_stage_texture (null): "
+				"Source or destination is NULL");
+		return;
+	}
+	if (src->type != GS_TEXTURE_2D || src->format != dst->format ||
+	    src->width != dst->width || src->height != dst->height) {
+		blog(LOG_ERROR, "device_stage_texture (null): "
+				"Source and destination do not match");
+		return;
+	}
+
+	memcpy(dst->data, src->data, (size_t)dst->linesize * dst->height);
+}
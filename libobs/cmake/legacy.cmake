@@ -42,6 +42,7 @@ target_sources(
           obs-display.c
           obs-encoder.c
           obs-encoder.h
+          obs-frame-pool.c
           obs-ffmpeg-compat.h
           obs-hotkey.c
           obs-hotkey.h
@@ -52,6 +53,7 @@ target_sources(
           obs-nal.h
           obs-hotkey-name-map.c
           obs-interaction.h
+          obs-interleave.h
           obs-internal.h
           obs-module.c
           obs-module.h
@@ -147,9 +149,17 @@ target_sources(
   libobs
   PRIVATE media-io/audio-io.c
           media-io/audio-io.h
+          media-io/audio-kernels-avx2.c
+          media-io/audio-kernels-internal.h
+          media-io/audio-kernels.c
+          media-io/audio-kernels.h
           media-io/audio-math.h
           media-io/audio-resampler.h
           media-io/audio-resampler-ffmpeg.c
+          media-io/audio-resampler-polyphase.c
+          media-io/audio-resampler-polyphase.h
+          media-io/format-conversion-avx2.c
+          media-io/format-conversion-internal.h
           media-io/format-conversion.c
           media-io/format-conversion.h
           media-io/frame-rate.h
@@ -169,6 +179,7 @@ target_sources(
   libobs
   PRIVATE util/array-serializer.c
           util/array-serializer.h
+          util/avx2-intrin.h
           util/base.c
           util/base.h
           util/bitstream.c
@@ -210,6 +221,8 @@ target_sources(
           util/uthash.h
           util/util_uint64.h
           util/util_uint128.h
+          util/virtual-clock.c
+          util/virtual-clock.h
           util/curl/curl-helper.h
           util/darray.h
           util/util.hpp)
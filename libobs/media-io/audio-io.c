@@ -19,6 +19,7 @@
 #include <inttypes.h>
 
 #include "../util/threading.h"
+#include "../util/task.h"
 #include "../util/darray.h"
 #include "../util/deque.h"
 #include "../util/platform.h"
@@ -26,6 +27,7 @@
 #include "../util/util_uint64.h"
 
 #include "audio-io.h"
+#include "audio-kernels.h"
 #include "audio-resampler.h"
 
 #ifdef _WIN32
@@ -56,10 +58,29 @@ static inline void audio_input_free(struct audio_input *input)
 	audio_resampler_destroy(input->resampler);
 }
 
+struct audio_input_id {
+	size_t mix_idx;
+	audio_output_callback_t callback;
+	void *param;
+};
+
+struct parallel_output {
+	struct audio_input_id id;
+	struct audio_input *input;
+	uint64_t timestamp;
+	uint32_t frames;
+};
+
 struct audio_mix {
 	DARRAY(struct audio_input) inputs;
 	float buffer[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
 	float buffer_unclamped[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
+
+	/* buffers are known to be all zeroes */
+	bool silent;
+	bool unclamped_silent;
+
+	uint64_t latency;
 };
 
 struct audio_output {
@@ -73,12 +94,25 @@ struct audio_output {
 
 	bool initialized;
 
+	const struct audio_kernels *kernels;
+
 	audio_input_callback_t input_cb;
 	void *input_param;
 	pthread_mutex_t input_mutex;
 	struct audio_mix mixes[MAX_AUDIO_MIXES];
+
+	/* parallel inputs of all mixes are called together on the output
+	 * pool.  inputs they disconnect are removed after that. */
+	DARRAY(struct parallel_output) parallel_outputs;
+	pthread_mutex_t pending_mutex;
+	DARRAY(struct audio_input_id) pending_disconnects;
+
+	uint64_t silent_mixes;
 };
 
+/* set while a parallel input's callback runs */
+static THREAD_LOCAL struct audio_output *parallel_output_audio = NULL;
+
 /* ------------------------------------------------------------------------- */
 
 static bool resample_audio_output(struct audio_input *input,
@@ -106,34 +140,106 @@ static bool resample_audio_output(struct audio_input *input,
 	return success;
 }
 
-static inline void do_audio_output(struct audio_output *audio, size_t mix_idx,
-				   uint64_t timestamp, uint32_t frames)
+static void output_to_input(struct audio_output *audio, size_t mix_idx,
+			    struct audio_input *input, uint64_t timestamp,
+			    uint32_t frames)
 {
 	struct audio_mix *mix = &audio->mixes[mix_idx];
 	struct audio_data data;
 
-	pthread_mutex_lock(&audio->input_mutex);
+	float(*buf)[AUDIO_OUTPUT_FRAMES] = input->conversion.allow_clipping
+						   ? mix->buffer_unclamped
+						   : mix->buffer;
+	for (size_t i = 0; i < audio->planes; i++)
+		data.data[i] = (uint8_t *)buf[i];
+
+	data.frames = frames;
+	data.timestamp = timestamp;
+	data.silent = mix->silent && !input->resampler;
+
+	if (resample_audio_output(input, &data))
+		input->callback(input->param, mix_idx, &data);
+}
+
+/* must be called with input_mutex locked */
+static inline void do_audio_output(struct audio_output *audio, size_t mix_idx,
+				   uint64_t timestamp, uint32_t frames)
+{
+	struct audio_mix *mix = &audio->mixes[mix_idx];
 
 	for (size_t i = mix->inputs.num; i > 0; i--) {
 		struct audio_input *input = mix->inputs.array + (i - 1);
 
-		float(*buf)[AUDIO_OUTPUT_FRAMES] =
-			input->conversion.allow_clipping ? mix->buffer_unclamped
-							 : mix->buffer;
-		for (size_t i = 0; i < audio->planes; i++)
-			data.data[i] = (uint8_t *)buf[i];
+		if (input->conversion.parallel && audio->info.output_pool) {
+			struct parallel_output po = {
+				.id = {mix_idx, input->callback, input->param},
+				.timestamp = timestamp,
+				.frames = frames};
+			da_push_back(audio->parallel_outputs, &po);
+			continue;
+		}
+
+		output_to_input(audio, mix_idx, input, timestamp, frames);
+	}
+}
+
+static void parallel_output_job(void *param, size_t idx)
+{
+	struct audio_output *audio = param;
+	struct parallel_output *po = audio->parallel_outputs.array + idx;
 
-		data.frames = frames;
-		data.timestamp = timestamp;
+	parallel_output_audio = audio;
+	output_to_input(audio, po->id.mix_idx, po->input, po->timestamp,
+			po->frames);
+	parallel_output_audio = NULL;
+}
 
-		if (resample_audio_output(input, &data))
-			input->callback(input->param, mix_idx, &data);
+static size_t audio_get_input_idx(const audio_t *audio, size_t mix_idx,
+				  audio_output_callback_t callback,
+				  void *param);
+static void remove_input(struct audio_output *audio, size_t mix_idx,
+			 audio_output_callback_t callback, void *param);
+
+/* must be called with input_mutex locked.  every input is called once per
+ * tick, and the tick only ends after all of them have returned, so each
+ * input still receives its audio in order */
+static void do_parallel_audio_output(struct audio_output *audio)
+{
+	/* serial callbacks may have connected or disconnected inputs */
+	for (size_t i = audio->parallel_outputs.num; i > 0; i--) {
+		struct parallel_output *po = audio->parallel_outputs.array +
+					     (i - 1);
+		struct audio_input_id *id = &po->id;
+		size_t idx = audio_get_input_idx(audio, id->mix_idx,
+						 id->callback, id->param);
+
+		if (idx == DARRAY_INVALID)
+			da_erase(audio->parallel_outputs, i - 1);
+		else
+			po->input = audio->mixes[id->mix_idx].inputs.array +
+				    idx;
 	}
 
-	pthread_mutex_unlock(&audio->input_mutex);
+	if (!audio->parallel_outputs.num)
+		return;
+
+	os_thread_pool_parallel_for(audio->info.output_pool,
+				    parallel_output_job, audio,
+				    audio->parallel_outputs.num);
+	da_resize(audio->parallel_outputs, 0);
+
+	pthread_mutex_lock(&audio->pending_mutex);
+	for (size_t i = 0; i < audio->pending_disconnects.num; i++) {
+		struct audio_input_id *id;
+		id = audio->pending_disconnects.array + i;
+		remove_input(audio, id->mix_idx, id->callback, id->param);
+	}
+	da_resize(audio->pending_disconnects, 0);
+	pthread_mutex_unlock(&audio->pending_mutex);
 }
 
-static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
+static inline void clamp_audio_output(struct audio_output *audio, size_t bytes,
+				      uint32_t active_mixes)
 {
 	size_t float_size = bytes / sizeof(float);
 
@@ -141,22 +247,30 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
 		/* do not process mixing if a specific mix is inactive */
-		if (!mix->inputs.num)
+		if ((active_mixes & (1 << mix_idx)) == 0)
 			continue;
 
+		/* nothing was mixed in, both buffers are still zeroed */
+		if (mix->silent) {
+			if (!mix->unclamped_silent) {
+				for (size_t plane = 0; plane < audio->planes;
+				     plane++)
+					memset(mix->buffer_unclamped[plane], 0,
+					       bytes);
+				mix->unclamped_silent = true;
+			}
+			audio->silent_mixes++;
+			continue;
+		}
+
+		mix->unclamped_silent = false;
+
 		for (size_t plane = 0; plane < audio->planes; plane++) {
 			float *mix_data = mix->buffer[plane];
-			float *mix_end = &mix_data[float_size];
 			/* Unclamped mix is copied directly. */
 			memcpy(mix->buffer_unclamped[plane], mix_data, bytes);
 
-			while (mix_data < mix_end) {
-				float val = *mix_data;
-				val = (val == val) ? val : 0.0f;
-				val = (val > 1.0f) ? 1.0f : val;
-				val = (val < -1.0f) ? -1.0f : val;
-				*(mix_data++) = val;
-			}
+			audio->kernels->clamp(mix_data, float_size);
 		}
 	}
 }
@@ -164,7 +278,8 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 static void input_and_output(struct audio_output *audio, uint64_t audio_time,
 			     uint64_t prev_time)
 {
-	size_t bytes = AUDIO_OUTPUT_FRAMES * audio->block_size;
+	uint32_t frames = audio->info.frames_per_tick;
+	size_t bytes = frames * audio->block_size;
 	struct audio_output_data data[MAX_AUDIO_MIXES];
 	uint32_t active_mixes = 0;
 	uint64_t new_ts = 0;
@@ -185,28 +300,51 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time,
 	}
 	pthread_mutex_unlock(&audio->input_mutex);
 
-	/* clear mix buffers */
+	/* clear active mix buffers, unless they are still clear from last
+	 * tick.  inactive mixes are not touched by anything this tick. */
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
+		bool active = (active_mixes & (1 << mix_idx)) != 0;
 
-		memset(mix->buffer, 0, sizeof(mix->buffer));
-
-		for (size_t i = 0; i < audio->planes; i++)
+		for (size_t i = 0; i < audio->planes; i++) {
+			if (active && !mix->silent)
+				memset(mix->buffer[i], 0, bytes);
 			data[mix_idx].data[i] = mix->buffer[i];
+		}
+		data[mix_idx].silent = active;
 	}
 
 	/* get new audio data */
 	success = audio->input_cb(audio->input_param, prev_time, audio_time,
 				  &new_ts, active_mixes, data);
+
+	/* an inactive mix is left as-is, so it must be cleared again once it
+	 * becomes active */
+	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++)
+		audio->mixes[mix_idx].silent = success && data[mix_idx].silent;
+
 	if (!success)
 		return;
 
 	/* clamps audio data to -1.0..1.0 */
-	clamp_audio_output(audio, bytes);
+	clamp_audio_output(audio, bytes, active_mixes);
+
+	/* output, mixes that gained inputs mid-tick start on the next one */
+	uint64_t now = audio->info.clock ? audio_time : os_gettime_ns();
+	pthread_mutex_lock(&audio->input_mutex);
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+		struct audio_mix *mix = &audio->mixes[i];
 
-	/* output */
-	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
-		do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
+		if ((active_mixes & (1 << i)) == 0) {
+			mix->latency = 0;
+			continue;
+		}
+
+		mix->latency = now > new_ts ? now - new_ts : 0;
+		do_audio_output(audio, i, new_ts, frames);
+	}
+	do_parallel_audio_output(audio);
+	pthread_mutex_unlock(&audio->input_mutex);
 }
 
 static void *audio_thread(void *param)
@@ -217,9 +355,13 @@ static void *audio_thread(void *param)
 #endif
 
 	struct audio_output *audio = param;
+	virtual_clock_t *clock = audio->info.clock;
 	size_t rate = audio->info.samples_per_sec;
+	uint32_t frames = audio->info.frames_per_tick;
 	uint64_t samples = 0;
-	uint64_t start_time = os_gettime_ns();
+	size_t clock_id = clock ? virtual_clock_join(clock) : 0;
+	uint64_t start_time = clock ? virtual_clock_get_time(clock)
+				    : os_gettime_ns();
 	uint64_t prev_time = start_time;
 
 	os_set_thread_name("audio-io: audio thread");
@@ -229,11 +371,14 @@ static void *audio_thread(void *param)
 				   "audio_thread(%s)", audio->info.name);
 
 	while (os_event_try(audio->stop_event) == EAGAIN) {
-		samples += AUDIO_OUTPUT_FRAMES;
+		samples += frames;
 		uint64_t audio_time =
 			start_time + audio_frames_to_ns(rate, samples);
 
-		os_sleepto_ns_fast(audio_time);
+		if (clock)
+			virtual_clock_sleepto(clock, clock_id, audio_time);
+		else
+			os_sleepto_ns_fast(audio_time);
 
 		profile_start(audio_thread_name);
 
@@ -245,6 +390,9 @@ static void *audio_thread(void *param)
 		profile_reenable_thread();
 	}
 
+	if (clock)
+		virtual_clock_leave(clock, clock_id);
+
 #ifdef _WIN32
 	if (handle)
 		AvRevertMmThreadCharacteristics(handle);
@@ -286,7 +434,10 @@ static inline bool audio_input_init(struct audio_input *input,
 			.samples_per_sec = input->conversion.samples_per_sec,
 			.speakers = input->conversion.speakers};
 
-		input->resampler = audio_resampler_create(&to, &from);
+		/* planar float at another rate (most audio encoders) takes
+		 * the polyphase resampler, other conversions swresample */
+		input->resampler = audio_resampler_create2(
+			&to, &from, AUDIO_RESAMPLER_AUTO);
 		if (!input->resampler) {
 			blog(LOG_ERROR, "audio_input_init: Failed to "
 					"create resampler");
@@ -343,28 +494,44 @@ bool audio_output_connect(audio_t *audio, size_t mi,
 	return success;
 }
 
+static void remove_input(struct audio_output *audio, size_t mix_idx,
+			 audio_output_callback_t callback, void *param)
+{
+	size_t idx = audio_get_input_idx(audio, mix_idx, callback, param);
+	if (idx != DARRAY_INVALID) {
+		struct audio_mix *mix = &audio->mixes[mix_idx];
+		audio_input_free(mix->inputs.array + idx);
+		da_erase(mix->inputs, idx);
+	}
+}
+
 void audio_output_disconnect(audio_t *audio, size_t mix_idx,
 			     audio_output_callback_t callback, void *param)
 {
 	if (!audio || mix_idx >= MAX_AUDIO_MIXES)
 		return;
 
-	pthread_mutex_lock(&audio->input_mutex);
+	/* the audio thread holds input_mutex until all parallel callbacks
+	 * have returned, so inputs disconnected from one are removed then */
+	if (parallel_output_audio == audio) {
+		struct audio_input_id id = {mix_idx, callback, param};
 
-	size_t idx = audio_get_input_idx(audio, mix_idx, callback, param);
-	if (idx != DARRAY_INVALID) {
-		struct audio_mix *mix = &audio->mixes[mix_idx];
-		audio_input_free(mix->inputs.array + idx);
-		da_erase(mix->inputs, idx);
+		pthread_mutex_lock(&audio->pending_mutex);
+		da_push_back(audio->pending_disconnects, &id);
+		pthread_mutex_unlock(&audio->pending_mutex);
+		return;
 	}
 
+	pthread_mutex_lock(&audio->input_mutex);
+	remove_input(audio, mix_idx, callback, param);
 	pthread_mutex_unlock(&audio->input_mutex);
 }
 
 static inline bool valid_audio_params(const struct audio_output_info *info)
 {
 	return info->format && info->name && info->samples_per_sec > 0 &&
-	       info->speakers > 0;
+	       info->speakers > 0 &&
+	       info->frames_per_tick <= AUDIO_OUTPUT_FRAMES;
 }
 
 int audio_output_open(audio_t **audio, struct audio_output_info *info)
@@ -380,8 +547,11 @@ int audio_output_open(audio_t **audio, struct audio_output_info *info)
 		goto fail0;
 
 	memcpy(&out->info, info, sizeof(struct audio_output_info));
+	if (!out->info.frames_per_tick)
+		out->info.frames_per_tick = AUDIO_OUTPUT_FRAMES;
 	out->channels = get_audio_channels(info->speakers);
 	out->planes = planar ? out->channels : 1;
+	out->kernels = audio_kernels_get();
 	out->input_cb = info->input_callback;
 	out->input_param = info->input_param;
 	out->block_size = (planar ? 1 : out->channels) *
@@ -389,17 +559,21 @@ int audio_output_open(audio_t **audio, struct audio_output_info *info)
 
 	if (pthread_mutex_init_recursive(&out->input_mutex) != 0)
 		goto fail0;
-	if (os_event_init(&out->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+	if (pthread_mutex_init(&out->pending_mutex, NULL) != 0)
 		goto fail1;
-	if (pthread_create(&out->thread, NULL, audio_thread, out) != 0)
+	if (os_event_init(&out->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail2;
+	if (pthread_create(&out->thread, NULL, audio_thread, out) != 0)
+		goto fail3;
 
 	out->initialized = true;
 	*audio = out;
 	return AUDIO_OUTPUT_SUCCESS;
 
-fail2:
+fail3:
 	os_event_destroy(out->stop_event);
+fail2:
+	pthread_mutex_destroy(&out->pending_mutex);
 fail1:
 	pthread_mutex_destroy(&out->input_mutex);
 fail0:
@@ -419,6 +593,7 @@ void audio_output_close(audio_t *audio)
 		pthread_join(audio->thread, &thread_ret);
 		os_event_destroy(audio->stop_event);
 		pthread_mutex_destroy(&audio->input_mutex);
+		pthread_mutex_destroy(&audio->pending_mutex);
 	}
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
@@ -429,6 +604,8 @@ void audio_output_close(audio_t *audio)
 
 		da_free(mix->inputs);
 	}
+	da_free(audio->parallel_outputs);
+	da_free(audio->pending_disconnects);
 	bfree(audio);
 }
 
@@ -452,6 +629,18 @@ bool audio_output_active(const audio_t *audio)
 	return false;
 }
 
+uint64_t audio_output_get_silent_mixes(const audio_t *audio)
+{
+	return audio ? audio->silent_mixes : 0;
+}
+
+uint64_t audio_output_get_mix_latency(const audio_t *audio, size_t mix_idx)
+{
+	if (!audio || mix_idx >= MAX_AUDIO_MIXES)
+		return 0;
+	return audio->mixes[mix_idx].latency;
+}
+
 size_t audio_output_get_block_size(const audio_t *audio)
 {
 	return audio->block_size;
@@ -471,3 +660,8 @@ uint32_t audio_output_get_sample_rate(const audio_t *audio)
 {
 	return audio->info.samples_per_sec;
 }
+
+uint32_t audio_output_get_frames_per_tick(const audio_t *audio)
+{
+	return audio ? audio->info.frames_per_tick : AUDIO_OUTPUT_FRAMES;
+}
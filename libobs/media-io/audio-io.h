@@ -20,6 +20,8 @@
 #include "media-io-defs.h"
 #include "../util/c99defs.h"
 #include "../util/util_uint64.h"
+#include "../util/virtual-clock.h"
+#include "../util/task.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,6 +30,7 @@ extern "C" {
 #define MAX_AUDIO_MIXES 6
 #define MAX_AUDIO_CHANNELS 8
 #define MAX_DEVICE_INPUT_CHANNELS 64
+/* default and maximum number of frames processed per audio tick */
 #define AUDIO_OUTPUT_FRAMES 1024
 
 #define TOTAL_AUDIO_SIZE                                              \
@@ -80,10 +83,17 @@ struct audio_data {
 	uint8_t *data[MAX_AV_PLANES];
 	uint32_t frames;
 	uint64_t timestamp;
+
+	/* set by audio-io when the data is known to be all zeroes */
+	bool silent;
 };
 
 struct audio_output_data {
 	float *data[MAX_AUDIO_CHANNELS];
+
+	/* true while nothing has been mixed into the buffers, whoever
+	 * writes non-zero data to them must clear it */
+	bool silent;
 };
 
 typedef bool (*audio_input_callback_t)(void *param, uint64_t start_ts,
@@ -98,8 +108,19 @@ struct audio_output_info {
 	enum audio_format format;
 	enum speaker_layout speakers;
 
+	/* frames per tick, 0 for AUDIO_OUTPUT_FRAMES.  smaller ticks lower
+	 * latency at the cost of more per-tick overhead. */
+	uint32_t frames_per_tick;
+
 	audio_input_callback_t input_callback;
 	void *input_param;
+
+	/* paces the audio thread instead of the system clock if set */
+	virtual_clock_t *clock;
+
+	/* if set, the callbacks of inputs connected as parallel run
+	 * concurrently on this pool each tick */
+	os_thread_pool_t *output_pool;
 };
 
 struct audio_convert_info {
@@ -107,6 +128,10 @@ struct audio_convert_info {
 	enum audio_format format;
 	enum speaker_layout speakers;
 	bool allow_clipping;
+
+	/* the callback may run at the same time as the callbacks of other
+	 * parallel inputs, and must not connect inputs itself */
+	bool parallel;
 };
 
 static inline uint32_t get_audio_channels(enum speaker_layout speakers)
@@ -232,10 +257,18 @@ EXPORT void audio_output_disconnect(audio_t *video, size_t mix_idx,
 
 EXPORT bool audio_output_active(const audio_t *audio);
 
+/** Number of mix ticks that were output as silence without being clamped */
+EXPORT uint64_t audio_output_get_silent_mixes(const audio_t *audio);
+/** Time between the timestamp of the last audio output on a mix and it
+ * being handed to its inputs, 0 if the mix has no inputs */
+EXPORT uint64_t audio_output_get_mix_latency(const audio_t *audio,
+					     size_t mix_idx);
+
 EXPORT size_t audio_output_get_block_size(const audio_t *audio);
 EXPORT size_t audio_output_get_planes(const audio_t *audio);
 EXPORT size_t audio_output_get_channels(const audio_t *audio);
 EXPORT uint32_t audio_output_get_sample_rate(const audio_t *audio);
+EXPORT uint32_t audio_output_get_frames_per_tick(const audio_t *audio);
 EXPORT const struct audio_output_info *
 audio_output_get_info(const audio_t *audio);
 
@@ -0,0 +1,156 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "../util/avx2-intrin.h"
+#include "audio-kernels-internal.h"
+
+/* AVX2 kernels, 8 samples at a time */
+
+#ifdef HAVE_AVX2_INTRIN
+AVX2_FUNC static void mix_avx2(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 d = _mm256_loadu_ps(dst + i);
+		__m256 s = _mm256_loadu_ps(src + i);
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(d, s));
+	}
+
+	_mm256_zeroupper();
+	mix_scalar(dst + i, src + i, count - i);
+}
+
+AVX2_FUNC static void mix_mul_avx2(float *dst, const float *src,
+				   const float *mul, size_t count)
+{
+	size_t i = 0;
+
+	/* no FMA here, the result has to match the other kernels exactly */
+	for (; i + 8 <= count; i += 8) {
+		__m256 d = _mm256_loadu_ps(dst + i);
+		__m256 s = _mm256_loadu_ps(src + i);
+		__m256 m = _mm256_loadu_ps(mul + i);
+		_mm256_storeu_ps(dst + i,
+				 _mm256_add_ps(d, _mm256_mul_ps(s, m)));
+	}
+
+	_mm256_zeroupper();
+	mix_mul_scalar(dst + i, src + i, mul + i, count - i);
+}
+
+AVX2_FUNC static void mul_avx2(float *data, float vol, size_t count)
+{
+	const __m256 v = _mm256_set1_ps(vol);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(data + i,
+				 _mm256_mul_ps(_mm256_loadu_ps(data + i), v));
+
+	_mm256_zeroupper();
+	mul_scalar(data + i, vol, count - i);
+}
+
+AVX2_FUNC static void mul_buf_avx2(float *data, const float *vol, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 d = _mm256_loadu_ps(data + i);
+		__m256 v = _mm256_loadu_ps(vol + i);
+		_mm256_storeu_ps(data + i, _mm256_mul_ps(d, v));
+	}
+
+	_mm256_zeroupper();
+	mul_buf_scalar(data + i, vol + i, count - i);
+}
+
+AVX2_FUNC static void clamp_avx2(float *data, size_t count)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 neg_one = _mm256_set1_ps(-1.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(data + i);
+
+		val = _mm256_and_ps(val, _mm256_cmp_ps(val, val, _CMP_ORD_Q));
+		val = _mm256_max_ps(_mm256_min_ps(val, one), neg_one);
+		_mm256_storeu_ps(data + i, val);
+	}
+
+	_mm256_zeroupper();
+	clamp_scalar(data + i, count - i);
+}
+
+AVX2_FUNC static bool is_silent_avx2(const float *data, size_t count)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	bool silent = true;
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(data + i);
+		if (_mm256_movemask_ps(_mm256_cmp_ps(val, zero, _CMP_NEQ_UQ))) {
+			silent = false;
+			break;
+		}
+	}
+
+	_mm256_zeroupper();
+	return silent && is_silent_scalar(data + i, count - i);
+}
+
+AVX2_FUNC static float dot_avx2(const float *a, const float *b, size_t count)
+{
+	__m256 acc = _mm256_setzero_ps();
+	float lanes[DOT_LANES];
+	size_t i = 0;
+
+	for (; i + DOT_LANES <= count; i += DOT_LANES) {
+		__m256 va = _mm256_loadu_ps(a + i);
+		__m256 vb = _mm256_loadu_ps(b + i);
+		acc = _mm256_add_ps(acc, _mm256_mul_ps(va, vb));
+	}
+
+	_mm256_storeu_ps(lanes, acc);
+	_mm256_zeroupper();
+	return dot_finish(lanes, a + i, b + i, count - i);
+}
+
+static const struct audio_kernels kernels_avx2 = {
+	.type = AUDIO_KERNEL_AVX2,
+	.name = "AVX2",
+	.mix = mix_avx2,
+	.mix_mul = mix_mul_avx2,
+	.mul = mul_avx2,
+	.mul_buf = mul_buf_avx2,
+	.clamp = clamp_avx2,
+	.is_silent = is_silent_avx2,
+	.dot = dot_avx2,
+};
+#endif
+
+const struct audio_kernels *audio_kernels_get_avx2(void)
+{
+#ifdef HAVE_AVX2_INTRIN
+	return cpu_has_avx2() ? &kernels_avx2 : NULL;
+#else
+	return NULL;
+#endif
+}
@@ -0,0 +1,97 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "audio-kernels.h"
+
+/*
+ * Scalar kernels shared by the kernel sets, which use them for the samples
+ * that don't fill a whole vector.
+ */
+
+static inline void mix_scalar(float *dst, const float *src, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] += src[i];
+}
+
+static inline void mix_mul_scalar(float *dst, const float *src,
+				  const float *mul, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] += src[i] * mul[i];
+}
+
+static inline void mul_scalar(float *data, float vol, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] *= vol;
+}
+
+static inline void mul_buf_scalar(float *data, const float *vol, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] *= vol[i];
+}
+
+static inline float clamp_sample(float val)
+{
+	val = (val == val) ? val : 0.0f;
+	val = (val > 1.0f) ? 1.0f : val;
+	val = (val < -1.0f) ? -1.0f : val;
+	return val;
+}
+
+static inline void clamp_scalar(float *data, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] = clamp_sample(data[i]);
+}
+
+static inline bool is_silent_scalar(const float *data, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (data[i] != 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+#define DOT_LANES 8
+
+/* adds the tail into the first lanes, then reduces the lanes pairwise */
+static inline float dot_finish(float lanes[DOT_LANES], const float *a,
+			       const float *b, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		lanes[i] += a[i] * b[i];
+
+	float s0 = lanes[0] + lanes[4];
+	float s1 = lanes[1] + lanes[5];
+	float s2 = lanes[2] + lanes[6];
+	float s3 = lanes[3] + lanes[7];
+	return (s0 + s1) + (s2 + s3);
+}
+
+/*
+ * The AVX2 kernels live in their own translation unit so that the native
+ * intrinsics never meet simde's native aliases.  Returns NULL if the CPU or
+ * build doesn't support them.
+ */
+extern const struct audio_kernels *audio_kernels_get_avx2(void);
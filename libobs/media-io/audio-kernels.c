@@ -0,0 +1,198 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "../util/sse-intrin.h"
+#include "../util/threading.h"
+#include "audio-kernels-internal.h"
+
+/* ------------------------------------------------------------------------- */
+/* scalar                                                                    */
+
+static float dot_scalar(const float *a, const float *b, size_t count)
+{
+	float lanes[DOT_LANES] = {0};
+	size_t i = 0;
+
+	for (; i + DOT_LANES <= count; i += DOT_LANES) {
+		for (size_t j = 0; j < DOT_LANES; j++)
+			lanes[j] += a[i + j] * b[i + j];
+	}
+
+	return dot_finish(lanes, a + i, b + i, count - i);
+}
+
+static const struct audio_kernels kernels_scalar = {
+	.type = AUDIO_KERNEL_SCALAR,
+	.name = "scalar",
+	.mix = mix_scalar,
+	.mix_mul = mix_mul_scalar,
+	.mul = mul_scalar,
+	.mul_buf = mul_buf_scalar,
+	.clamp = clamp_scalar,
+	.is_silent = is_silent_scalar,
+	.dot = dot_scalar,
+};
+
+/* ------------------------------------------------------------------------- */
+/* SSE2 (NEON through simde on non-x86)                                      */
+
+static void mix_sse2(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 d = _mm_loadu_ps(dst + i);
+		__m128 s = _mm_loadu_ps(src + i);
+		_mm_storeu_ps(dst + i, _mm_add_ps(d, s));
+	}
+
+	mix_scalar(dst + i, src + i, count - i);
+}
+
+static void mix_mul_sse2(float *dst, const float *src, const float *mul,
+			 size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 d = _mm_loadu_ps(dst + i);
+		__m128 s = _mm_loadu_ps(src + i);
+		__m128 m = _mm_loadu_ps(mul + i);
+		_mm_storeu_ps(dst + i, _mm_add_ps(d, _mm_mul_ps(s, m)));
+	}
+
+	mix_mul_scalar(dst + i, src + i, mul + i, count - i);
+}
+
+static void mul_sse2(float *data, float vol, size_t count)
+{
+	const __m128 v = _mm_set1_ps(vol);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), v));
+
+	mul_scalar(data + i, vol, count - i);
+}
+
+static void mul_buf_sse2(float *data, const float *vol, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 d = _mm_loadu_ps(data + i);
+		__m128 v = _mm_loadu_ps(vol + i);
+		_mm_storeu_ps(data + i, _mm_mul_ps(d, v));
+	}
+
+	mul_buf_scalar(data + i, vol + i, count - i);
+}
+
+static void clamp_sse2(float *data, size_t count)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 neg_one = _mm_set1_ps(-1.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(data + i);
+
+		/* zero out NaNs first, min/max would otherwise pass them on */
+		val = _mm_and_ps(val, _mm_cmpord_ps(val, val));
+		val = _mm_max_ps(_mm_min_ps(val, one), neg_one);
+		_mm_storeu_ps(data + i, val);
+	}
+
+	clamp_scalar(data + i, count - i);
+}
+
+static bool is_silent_sse2(const float *data, size_t count)
+{
+	const __m128 zero = _mm_setzero_ps();
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(data + i);
+		if (_mm_movemask_ps(_mm_cmpneq_ps(val, zero)))
+			return false;
+	}
+
+	return is_silent_scalar(data + i, count - i);
+}
+
+static float dot_sse2(const float *a, const float *b, size_t count)
+{
+	__m128 lo = _mm_setzero_ps();
+	__m128 hi = _mm_setzero_ps();
+	float lanes[DOT_LANES];
+	size_t i = 0;
+
+	for (; i + DOT_LANES <= count; i += DOT_LANES) {
+		lo = _mm_add_ps(lo, _mm_mul_ps(_mm_loadu_ps(a + i),
+					       _mm_loadu_ps(b + i)));
+		hi = _mm_add_ps(hi, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+					       _mm_loadu_ps(b + i + 4)));
+	}
+
+	_mm_storeu_ps(lanes, lo);
+	_mm_storeu_ps(lanes + 4, hi);
+	return dot_finish(lanes, a + i, b + i, count - i);
+}
+
+static const struct audio_kernels kernels_sse2 = {
+	.type = AUDIO_KERNEL_SSE2,
+	.name = "SSE2",
+	.mix = mix_sse2,
+	.mix_mul = mix_mul_sse2,
+	.mul = mul_sse2,
+	.mul_buf = mul_buf_sse2,
+	.clamp = clamp_sse2,
+	.is_silent = is_silent_sse2,
+	.dot = dot_sse2,
+};
+
+/* ------------------------------------------------------------------------- */
+
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+static const struct audio_kernels *kernels_active = &kernels_scalar;
+
+static void select_audio_kernels(void)
+{
+	const struct audio_kernels *avx2 = audio_kernels_get_avx2();
+
+	kernels_active = avx2 ? avx2 : &kernels_sse2;
+}
+
+const struct audio_kernels *audio_kernels_get(void)
+{
+	pthread_once(&kernels_once, select_audio_kernels);
+	return kernels_active;
+}
+
+const struct audio_kernels *audio_kernels_get_type(enum audio_kernel_type type)
+{
+	switch (type) {
+	case AUDIO_KERNEL_SCALAR:
+		return &kernels_scalar;
+	case AUDIO_KERNEL_SSE2:
+		return &kernels_sse2;
+	case AUDIO_KERNEL_AVX2:
+		return audio_kernels_get_avx2();
+	}
+
+	return NULL;
+}
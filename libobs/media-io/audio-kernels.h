@@ -0,0 +1,74 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Float sample kernels used by the audio mixing path.  Every kernel set
+ * produces bit-identical results; the fastest set supported by the CPU is
+ * selected once at startup.  Buffers do not need to be aligned.
+ */
+
+enum audio_kernel_type {
+	AUDIO_KERNEL_SCALAR,
+	AUDIO_KERNEL_SSE2, /* NEON on ARM via simde */
+	AUDIO_KERNEL_AVX2,
+};
+
+#define AUDIO_KERNEL_COUNT 3
+
+struct audio_kernels {
+	enum audio_kernel_type type;
+	const char *name;
+
+	/* dst[i] += src[i] */
+	void (*mix)(float *dst, const float *src, size_t count);
+	/* dst[i] += src[i] * mul[i] */
+	void (*mix_mul)(float *dst, const float *src, const float *mul,
+			size_t count);
+	/* data[i] *= vol */
+	void (*mul)(float *data, float vol, size_t count);
+	/* data[i] *= vol[i] */
+	void (*mul_buf)(float *data, const float *vol, size_t count);
+	/* data[i] = clamp(data[i], -1.0, 1.0), NaN becomes 0.0 */
+	void (*clamp)(float *data, size_t count);
+	/* true if every sample is (+/-) 0.0 */
+	bool (*is_silent)(const float *data, size_t count);
+	/* sum of a[i] * b[i], accumulated in eight lanes so that every
+	 * kernel set sums in the same order */
+	float (*dot)(const float *a, const float *b, size_t count);
+};
+
+/** Returns the kernel set selected for this CPU */
+EXPORT const struct audio_kernels *audio_kernels_get(void);
+
+/**
+ * Returns a specific kernel set, or NULL if it is not supported by this
+ * CPU or build.  Mostly useful for testing and benchmarking.
+ */
+EXPORT const struct audio_kernels *
+audio_kernels_get_type(enum audio_kernel_type type);
+
+#ifdef __cplusplus
+}
+#endif
@@ -17,12 +17,14 @@
 
 #include "../util/bmem.h"
 #include "audio-resampler.h"
+#include "audio-resampler-polyphase.h"
 #include "audio-io.h"
 #include <libavutil/avutil.h>
 #include <libavformat/avformat.h>
 #include <libswresample/swresample.h>
 
 struct audio_resampler {
+	struct polyphase_resampler *polyphase;
 	struct SwrContext *context;
 	bool opened;
 
@@ -34,6 +36,7 @@ struct audio_resampler {
 	uint32_t output_ch;
 	uint32_t output_freq;
 	uint32_t output_planes;
+	int compensation;
 #if LIBSWRESAMPLE_VERSION_INT < AV_VERSION_INT(4, 5, 100)
 	uint64_t input_layout;
 	uint64_t output_layout;
@@ -100,9 +103,31 @@ static inline uint64_t convert_speaker_layout(enum speaker_layout layout)
 audio_resampler_t *audio_resampler_create(const struct resample_info *dst,
 					  const struct resample_info *src)
 {
-	struct audio_resampler *rs = bzalloc(sizeof(struct audio_resampler));
+	return audio_resampler_create2(dst, src, AUDIO_RESAMPLER_SWR);
+}
+
+audio_resampler_t *audio_resampler_create2(const struct resample_info *dst,
+					   const struct resample_info *src,
+					   enum audio_resampler_type type)
+{
+	struct audio_resampler *rs;
 	int errcode;
 
+	if (type != AUDIO_RESAMPLER_SWR &&
+	    polyphase_resampler_supported(dst, src)) {
+		rs = bzalloc(sizeof(struct audio_resampler));
+		rs->polyphase = polyphase_resampler_create(dst, src);
+		return rs;
+	}
+
+	if (type == AUDIO_RESAMPLER_POLYPHASE) {
+		blog(LOG_ERROR, "audio_resampler_create2: conversion not "
+				"supported by the polyphase resampler");
+		return NULL;
+	}
+
+	rs = bzalloc(sizeof(struct audio_resampler));
+
 	rs->opened = false;
 	rs->input_freq = src->samples_per_sec;
 	rs->input_format = convert_audio_format(src->format);
@@ -181,6 +206,7 @@ audio_resampler_t *audio_resampler_create(const struct resample_info *dst,
 void audio_resampler_destroy(audio_resampler_t *rs)
 {
 	if (rs) {
+		polyphase_resampler_destroy(rs->polyphase);
 		if (rs->context)
 			swr_free(&rs->context);
 		if (rs->output_buffer[0])
@@ -196,6 +222,10 @@ bool audio_resampler_resample(audio_resampler_t *rs, uint8_t *output[],
 {
 	if (!rs)
 		return false;
+	if (rs->polyphase)
+		return polyphase_resampler_resample(rs->polyphase, output,
+						    out_frames, ts_offset,
+						    input, in_frames);
 
 	struct SwrContext *context = rs->context;
 	int ret;
@@ -204,7 +234,8 @@ bool audio_resampler_resample(audio_resampler_t *rs, uint8_t *output[],
 	int estimated = (int)av_rescale_rnd(delay + (int64_t)in_frames,
 					    (int64_t)rs->output_freq,
 					    (int64_t)rs->input_freq,
-					    AV_ROUND_UP);
+					    AV_ROUND_UP) +
+			abs(rs->compensation);
 
 	*ts_offset = (uint64_t)swr_get_delay(context, 1000000000);
 
@@ -233,3 +264,27 @@ bool audio_resampler_resample(audio_resampler_t *rs, uint8_t *output[],
 	*out_frames = (uint32_t)ret;
 	return true;
 }
+
+bool audio_resampler_set_compensation(audio_resampler_t *rs, int sample_delta,
+				      int distance)
+{
+	if (!rs)
+		return false;
+	if (rs->polyphase) {
+		polyphase_resampler_set_compensation(rs->polyphase,
+						     sample_delta, distance);
+		return true;
+	}
+	if (sample_delta == 0 && rs->compensation == 0)
+		return true;
+
+	int errcode = swr_set_compensation(rs->context, sample_delta,
+					   sample_delta ? distance : 0);
+	if (errcode < 0) {
+		blog(LOG_ERROR, "swr_set_compensation failed: %d", errcode);
+		return false;
+	}
+
+	rs->compensation = sample_delta;
+	return true;
+}
@@ -0,0 +1,413 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+
+#include "../util/bmem.h"
+#include "../util/darray.h"
+#include "../util/threading.h"
+#include "../util/util_uint64.h"
+#include "audio-kernels.h"
+#include "audio-resampler-polyphase.h"
+
+/* same defaults as swresample: 32 taps, up to 1024 phases, kaiser window
+ * with beta 9 and the cutoff slightly below nyquist */
+#define FILTER_TAPS 32
+#define FILTER_CENTER (FILTER_TAPS / 2 - 1)
+#define MAX_PHASES 1024
+#define KAISER_BETA 9.0
+#define CUTOFF 0.97
+#define FILTER_PI 3.14159265358979323846
+
+struct polyphase_filter {
+	long refs;
+	uint32_t in_rate;
+	uint32_t out_rate;
+	uint32_t phases;
+	float *coeffs;
+};
+
+static pthread_mutex_t filter_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct polyphase_filter *) filter_cache;
+
+struct polyphase_resampler {
+	struct polyphase_filter *filter;
+	const struct audio_kernels *kernels;
+
+	enum audio_format in_format;
+	uint32_t channels;
+
+	/* input position is ipos + (phase + frac / out_rate) / phases */
+	size_t ipos;
+	uint32_t phase;
+	uint64_t frac;
+	uint64_t incr;
+	uint64_t ideal_incr;
+	uint64_t comp_left;
+
+	float *buf[MAX_AUDIO_CHANNELS];
+	size_t buf_count;
+	size_t buf_capacity;
+
+	float *out[MAX_AUDIO_CHANNELS];
+	size_t out_capacity;
+};
+
+/* ------------------------------------------------------------------------- */
+/* filter table cache                                                        */
+
+static double bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+
+	for (int k = 1; k < 50; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+
+	return sum;
+}
+
+static void build_filter(struct polyphase_filter *filter)
+{
+	double ratio = (double)filter->out_rate / (double)filter->in_rate;
+	double cutoff = CUTOFF * (ratio < 1.0 ? ratio : 1.0);
+	double i0_beta = bessel_i0(KAISER_BETA);
+	double half = FILTER_TAPS / 2.0;
+
+	filter->coeffs = bmalloc(sizeof(float) * FILTER_TAPS * filter->phases);
+
+	for (uint32_t p = 0; p < filter->phases; p++) {
+		float *row = filter->coeffs + (size_t)p * FILTER_TAPS;
+		double taps[FILTER_TAPS];
+		double sum = 0.0;
+
+		for (int t = 0; t < FILTER_TAPS; t++) {
+			double x = (double)(t - FILTER_CENTER) -
+				   (double)p / (double)filter->phases;
+			double w = x / half;
+			double sinc = 1.0;
+
+			if (fabs(x * cutoff) > 1e-9) {
+				double y = FILTER_PI * x * cutoff;
+				sinc = sin(y) / y;
+			}
+
+			if (w * w < 1.0)
+				w = bessel_i0(KAISER_BETA * sqrt(1.0 - w * w));
+			else
+				w = 0.0;
+
+			taps[t] = sinc * w / i0_beta;
+			sum += taps[t];
+		}
+
+		/* unity gain at DC for every phase */
+		for (int t = 0; t < FILTER_TAPS; t++)
+			row[t] = (float)(taps[t] / sum);
+	}
+}
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* the most phases that still step exactly from one output frame to the
+ * next, or MAX_PHASES with the rest carried in frac if there are none */
+static uint32_t get_phase_count(uint32_t in_rate, uint32_t out_rate)
+{
+	uint32_t exact = out_rate / gcd(in_rate, out_rate);
+
+	if (exact > MAX_PHASES)
+		return MAX_PHASES;
+	return exact * (MAX_PHASES / exact);
+}
+
+static struct polyphase_filter *filter_get(uint32_t in_rate, uint32_t out_rate)
+{
+	struct polyphase_filter *filter = NULL;
+
+	pthread_mutex_lock(&filter_cache_mutex);
+
+	for (size_t i = 0; i < filter_cache.num; i++) {
+		struct polyphase_filter *cur = filter_cache.array[i];
+		if (cur->in_rate == in_rate && cur->out_rate == out_rate) {
+			filter = cur;
+			filter->refs++;
+			break;
+		}
+	}
+
+	if (!filter) {
+		filter = bzalloc(sizeof(*filter));
+		filter->refs = 1;
+		filter->in_rate = in_rate;
+		filter->out_rate = out_rate;
+		filter->phases = get_phase_count(in_rate, out_rate);
+		build_filter(filter);
+
+		da_push_back(filter_cache, &filter);
+	}
+
+	pthread_mutex_unlock(&filter_cache_mutex);
+	return filter;
+}
+
+static void filter_release(struct polyphase_filter *filter)
+{
+	if (!filter)
+		return;
+
+	pthread_mutex_lock(&filter_cache_mutex);
+
+	if (--filter->refs == 0) {
+		da_erase_item(filter_cache, &filter);
+		bfree(filter->coeffs);
+		bfree(filter);
+	}
+
+	if (!filter_cache.num)
+		da_free(filter_cache);
+
+	pthread_mutex_unlock(&filter_cache_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+
+bool polyphase_resampler_supported(const struct resample_info *dst,
+				   const struct resample_info *src)
+{
+	/* no remixing, and a plain format conversion is left to swresample
+	 * rather than running it through the filter */
+	return dst->format == AUDIO_FORMAT_FLOAT_PLANAR &&
+	       src->format != AUDIO_FORMAT_UNKNOWN &&
+	       src->speakers != SPEAKERS_UNKNOWN &&
+	       src->speakers == dst->speakers && src->samples_per_sec &&
+	       dst->samples_per_sec &&
+	       src->samples_per_sec != dst->samples_per_sec;
+}
+
+struct polyphase_resampler *
+polyphase_resampler_create(const struct resample_info *dst,
+			   const struct resample_info *src)
+{
+	struct polyphase_resampler *rs;
+
+	if (!polyphase_resampler_supported(dst, src))
+		return NULL;
+
+	rs = bzalloc(sizeof(*rs));
+	rs->filter = filter_get(src->samples_per_sec, dst->samples_per_sec);
+	rs->kernels = audio_kernels_get();
+	rs->in_format = src->format;
+	rs->channels = get_audio_channels(src->speakers);
+	rs->ideal_incr = (uint64_t)src->samples_per_sec * rs->filter->phases;
+	rs->incr = rs->ideal_incr;
+
+	/* the first output frame is centered on the first input frame */
+	rs->buf_count = FILTER_CENTER;
+	rs->buf_capacity = FILTER_CENTER;
+	for (uint32_t ch = 0; ch < rs->channels; ch++)
+		rs->buf[ch] = bzalloc(sizeof(float) * FILTER_CENTER);
+
+	return rs;
+}
+
+void polyphase_resampler_destroy(struct polyphase_resampler *rs)
+{
+	if (!rs)
+		return;
+
+	for (uint32_t ch = 0; ch < rs->channels; ch++) {
+		bfree(rs->buf[ch]);
+		bfree(rs->out[ch]);
+	}
+
+	filter_release(rs->filter);
+	bfree(rs);
+}
+
+void polyphase_resampler_set_compensation(struct polyphase_resampler *rs,
+					  int sample_delta, int distance)
+{
+	if (!rs)
+		return;
+
+	if (sample_delta == 0 || distance <= 0) {
+		rs->incr = rs->ideal_incr;
+		rs->comp_left = 0;
+		return;
+	}
+
+	/* sample_delta more (or fewer) output frames over distance frames */
+	int64_t adjust = (int64_t)rs->ideal_incr * sample_delta / distance;
+	rs->incr = (uint64_t)((int64_t)rs->ideal_incr - adjust);
+	rs->comp_left = (uint64_t)distance;
+}
+
+static inline void ensure_capacity(float **bufs, uint32_t channels,
+				   size_t *capacity, size_t needed)
+{
+	if (needed <= *capacity)
+		return;
+
+	for (uint32_t ch = 0; ch < channels; ch++)
+		bufs[ch] = brealloc(bufs[ch], sizeof(float) * needed);
+	*capacity = needed;
+}
+
+#define CONVERT_INPUT(type, expr)                                       \
+	do {                                                            \
+		for (uint32_t i = 0; i < frames; i++) {                 \
+			type val = *(const type *)(src + i * stride);   \
+			dst[i] = (expr);                                \
+		}                                                       \
+	} while (false)
+
+static void convert_input(struct polyphase_resampler *rs,
+			  const uint8_t *const input[], uint32_t frames)
+{
+	size_t bytes = get_audio_bytes_per_channel(rs->in_format);
+	bool planar = is_audio_planar(rs->in_format);
+	size_t stride = planar ? bytes : bytes * rs->channels;
+
+	for (uint32_t ch = 0; ch < rs->channels; ch++) {
+		const uint8_t *src = planar ? input[ch] : input[0] + ch * bytes;
+		float *dst = rs->buf[ch] + rs->buf_count;
+
+		switch (rs->in_format) {
+		case AUDIO_FORMAT_U8BIT:
+		case AUDIO_FORMAT_U8BIT_PLANAR:
+			CONVERT_INPUT(uint8_t,
+				      ((float)val - 128.0f) * (1.0f / 128.0f));
+			break;
+		case AUDIO_FORMAT_16BIT:
+		case AUDIO_FORMAT_16BIT_PLANAR:
+			CONVERT_INPUT(int16_t, (float)val * (1.0f / 32768.0f));
+			break;
+		case AUDIO_FORMAT_32BIT:
+		case AUDIO_FORMAT_32BIT_PLANAR:
+			CONVERT_INPUT(int32_t,
+				      (float)val * (1.0f / 2147483648.0f));
+			break;
+		case AUDIO_FORMAT_FLOAT_PLANAR:
+			memcpy(dst, src, sizeof(float) * frames);
+			break;
+		case AUDIO_FORMAT_FLOAT:
+			CONVERT_INPUT(float, val);
+			break;
+		case AUDIO_FORMAT_UNKNOWN:
+			break;
+		}
+	}
+
+	rs->buf_count += frames;
+}
+
+/* input frames (in 1 / phases units) that have not been output yet */
+static inline uint64_t buffered_phases(const struct polyphase_resampler *rs)
+{
+	uint64_t end = (uint64_t)rs->buf_count * rs->filter->phases;
+	uint64_t pos = ((uint64_t)rs->ipos + FILTER_CENTER) *
+			       rs->filter->phases +
+		       rs->phase;
+
+	return end > pos ? end - pos : 0;
+}
+
+bool polyphase_resampler_resample(struct polyphase_resampler *rs,
+				  uint8_t *output[], uint32_t *out_frames,
+				  uint64_t *ts_offset,
+				  const uint8_t *const input[],
+				  uint32_t in_frames)
+{
+	const struct polyphase_filter *filter = rs->filter;
+	const uint64_t phases = filter->phases;
+	const uint64_t out_rate = filter->out_rate;
+	float *out[MAX_AUDIO_CHANNELS];
+	size_t frames = 0;
+
+	*ts_offset = util_mul_div64(buffered_phases(rs), 1000000000ULL,
+				    (uint64_t)filter->in_rate * phases);
+
+	ensure_capacity(rs->buf, rs->channels, &rs->buf_capacity,
+			rs->buf_count + in_frames);
+	convert_input(rs, input, in_frames);
+
+	/* upper bound of output frames, the step is never below half of
+	 * the ideal one as compensation is limited far below that */
+	if (rs->buf_count >= rs->ipos + FILTER_TAPS) {
+		uint64_t avail = rs->buf_count - rs->ipos - FILTER_TAPS + 1;
+		size_t max_frames = (size_t)util_mul_div64(
+			avail * phases, out_rate * 2, rs->ideal_incr) + 2;
+
+		ensure_capacity(rs->out, rs->channels, &rs->out_capacity,
+				max_frames);
+	}
+
+	for (uint32_t ch = 0; ch < rs->channels; ch++)
+		out[ch] = rs->out[ch];
+
+	while (rs->ipos + FILTER_TAPS <= rs->buf_count &&
+	       frames < rs->out_capacity) {
+		const float *coeffs =
+			filter->coeffs + (size_t)rs->phase * FILTER_TAPS;
+
+		for (uint32_t ch = 0; ch < rs->channels; ch++)
+			out[ch][frames] = rs->kernels->dot(
+				rs->buf[ch] + rs->ipos, coeffs, FILTER_TAPS);
+		frames++;
+
+		uint64_t step = rs->phase + rs->incr / out_rate;
+		rs->frac += rs->incr % out_rate;
+		if (rs->frac >= out_rate) {
+			rs->frac -= out_rate;
+			step++;
+		}
+
+		rs->ipos += (size_t)(step / phases);
+		rs->phase = (uint32_t)(step % phases);
+
+		if (rs->comp_left && --rs->comp_left == 0)
+			rs->incr = rs->ideal_incr;
+	}
+
+	/* drop the input that no output frame needs anymore */
+	size_t drop = rs->ipos < rs->buf_count ? rs->ipos : rs->buf_count;
+	if (drop) {
+		for (uint32_t ch = 0; ch < rs->channels; ch++)
+			memmove(rs->buf[ch], rs->buf[ch] + drop,
+				sizeof(float) * (rs->buf_count - drop));
+		rs->buf_count -= drop;
+		rs->ipos -= drop;
+	}
+
+	for (uint32_t ch = 0; ch < rs->channels; ch++)
+		output[ch] = (uint8_t *)rs->out[ch];
+
+	*out_frames = (uint32_t)frames;
+	return true;
+}
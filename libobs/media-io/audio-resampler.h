@@ -33,9 +33,24 @@ struct resample_info {
 	enum speaker_layout speakers;
 };
 
+enum audio_resampler_type {
+	/* polyphase where supported, swresample otherwise.  used by source
+	 * and audio output resampling */
+	AUDIO_RESAMPLER_AUTO,
+	/* what audio_resampler_create uses, for plugins */
+	AUDIO_RESAMPLER_SWR,
+	/* float planar output with unchanged speakers and sample rates that
+	 * differ, filter tables are shared by all resamplers of a rate pair */
+	AUDIO_RESAMPLER_POLYPHASE,
+};
+
 EXPORT audio_resampler_t *
 audio_resampler_create(const struct resample_info *dst,
 		       const struct resample_info *src);
+EXPORT audio_resampler_t *
+audio_resampler_create2(const struct resample_info *dst,
+			const struct resample_info *src,
+			enum audio_resampler_type type);
 EXPORT void audio_resampler_destroy(audio_resampler_t *resampler);
 
 EXPORT bool audio_resampler_resample(audio_resampler_t *resampler,
@@ -44,6 +59,14 @@ EXPORT bool audio_resampler_resample(audio_resampler_t *resampler,
 				     const uint8_t *const input[],
 				     uint32_t in_frames);
 
+/**
+ * Slightly stretches (positive sample_delta) or shrinks (negative) the
+ * output, spreading sample_delta frames over the next distance output frames.
+ * Used to correct clock drift, a sample_delta of 0 stops compensating.
+ */
+EXPORT bool audio_resampler_set_compensation(audio_resampler_t *resampler,
+					     int sample_delta, int distance);
+
 #ifdef __cplusplus
 }
 #endif
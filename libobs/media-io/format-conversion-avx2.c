@@ -0,0 +1,259 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "../util/avx2-intrin.h"
+#include "format-conversion-internal.h"
+
+/* AVX2 conversions, 8 pixels at a time */
+
+#ifdef HAVE_AVX2_INTRIN
+/* picks one byte out of every UYVX pixel and stores the 8 of them */
+AVX2_FUNC static inline void store_component_avx2(uint8_t *dst, __m256i line,
+						  __m256i shuffle)
+{
+	const __m256i gather = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+	__m256i val = _mm256_shuffle_epi8(line, shuffle);
+
+	val = _mm256_permutevar8x32_epi32(val, gather);
+	_mm_storel_epi64((__m128i *)dst, _mm256_castsi256_si128(val));
+}
+
+#define COMPONENT_SHUFFLE(c)                                                 \
+	_mm256_setr_epi8(c, c + 4, c + 8, c + 12, -1, -1, -1, -1, -1, -1, -1, \
+			 -1, -1, -1, -1, -1, c, c + 4, c + 8, c + 12, -1, -1, \
+			 -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)
+
+/* averages the chroma of 2x2 pixels, returns u0 v0 u1 v1 u2 v2 u3 v3 in the
+ * low 8 bytes */
+AVX2_FUNC static inline __m128i average_chroma_avx2(__m256i line0,
+						    __m256i line1)
+{
+	const __m256i uv_mask = _mm256_set1_epi16(0x00FF);
+	const __m256i gather = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+	__m256i sum = _mm256_add_epi16(_mm256_and_si256(line0, uv_mask),
+				       _mm256_and_si256(line1, uv_mask));
+
+	sum = _mm256_add_epi16(sum, _mm256_srli_epi64(sum, 32));
+	sum = _mm256_srli_epi16(sum, 2);
+	sum = _mm256_permutevar8x32_epi32(sum, gather);
+
+	__m128i uv = _mm256_castsi256_si128(sum);
+	return _mm_packus_epi16(uv, uv);
+}
+
+AVX2_FUNC static void uyvx_to_i420_row_avx2(const uint8_t *line0,
+					    const uint8_t *line1, uint8_t *lum0,
+					    uint8_t *lum1, uint8_t *u,
+					    uint8_t *v, uint32_t width)
+{
+	const __m256i lum_shuffle = COMPONENT_SHUFFLE(1);
+	const __m128i split = _mm_setr_epi8(0, 2, 4, 6, 1, 3, 5, 7, -1, -1,
+					    -1, -1, -1, -1, -1, -1);
+	uint32_t x;
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		__m256i l0 =
+			_mm256_loadu_si256((const __m256i *)(line0 + x * 4));
+		__m256i l1 =
+			_mm256_loadu_si256((const __m256i *)(line1 + x * 4));
+
+		store_component_avx2(lum0 + x, l0, lum_shuffle);
+		store_component_avx2(lum1 + x, l1, lum_shuffle);
+
+		__m128i uv = _mm_shuffle_epi8(average_chroma_avx2(l0, l1),
+					      split);
+		*(uint32_t *)(u + (x >> 1)) = (uint32_t)_mm_cvtsi128_si32(uv);
+		*(uint32_t *)(v + (x >> 1)) =
+			(uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+	}
+
+	uyvx_to_i420_row_scalar(line0 + x * 4, line1 + x * 4, lum0 + x,
+				lum1 + x, u + (x >> 1), v + (x >> 1),
+				width - x);
+}
+
+AVX2_FUNC static void uyvx_to_nv12_row_avx2(const uint8_t *line0,
+					    const uint8_t *line1, uint8_t *lum0,
+					    uint8_t *lum1, uint8_t *uv,
+					    uint8_t *unused, uint32_t width)
+{
+	const __m256i lum_shuffle = COMPONENT_SHUFFLE(1);
+	uint32_t x;
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		__m256i l0 =
+			_mm256_loadu_si256((const __m256i *)(line0 + x * 4));
+		__m256i l1 =
+			_mm256_loadu_si256((const __m256i *)(line1 + x * 4));
+
+		store_component_avx2(lum0 + x, l0, lum_shuffle);
+		store_component_avx2(lum1 + x, l1, lum_shuffle);
+		_mm_storel_epi64((__m128i *)(uv + x),
+				 average_chroma_avx2(l0, l1));
+	}
+
+	uyvx_to_nv12_row_scalar(line0 + x * 4, line1 + x * 4, lum0 + x,
+				lum1 + x, uv + x, unused, width - x);
+}
+
+AVX2_FUNC static void uyvx_to_i444_row_avx2(const uint8_t *line, uint8_t *lum,
+					    uint8_t *u, uint8_t *v,
+					    uint32_t width)
+{
+	const __m256i u_shuffle = COMPONENT_SHUFFLE(0);
+	const __m256i lum_shuffle = COMPONENT_SHUFFLE(1);
+	const __m256i v_shuffle = COMPONENT_SHUFFLE(2);
+	uint32_t x;
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		__m256i l = _mm256_loadu_si256((const __m256i *)(line + x * 4));
+
+		store_component_avx2(u + x, l, u_shuffle);
+		store_component_avx2(lum + x, l, lum_shuffle);
+		store_component_avx2(v + x, l, v_shuffle);
+	}
+
+	uyvx_to_i444_row_scalar(line + x * 4, lum + x, u + x, v + x,
+				width - x);
+}
+
+/* stores 16 pixels of lo | (hi << 16), where both hold pixels 0-7 in their
+ * low half and 8-15 in their high half */
+AVX2_FUNC static inline void store_interleaved_avx2(uint32_t *dst, __m256i lo,
+						    __m256i hi)
+{
+	__m256i a = _mm256_unpacklo_epi16(lo, hi);
+	__m256i b = _mm256_unpackhi_epi16(lo, hi);
+
+	_mm256_storeu_si256((__m256i *)dst,
+			    _mm256_permute2x128_si256(a, b, 0x20));
+	_mm256_storeu_si256((__m256i *)dst + 1,
+			    _mm256_permute2x128_si256(a, b, 0x31));
+}
+
+AVX2_FUNC static void decompress_420_row_avx2(const uint8_t *lum0,
+					      const uint8_t *lum1,
+					      const uint8_t *chroma0,
+					      const uint8_t *chroma1,
+					      uint32_t *output0,
+					      uint32_t *output1,
+					      uint32_t width_d2)
+{
+	uint32_t x;
+
+	for (x = 0; x + 8 <= width_d2; x += 8) {
+		__m128i u = _mm_loadl_epi64((const __m128i *)(chroma0 + x));
+		__m128i v = _mm_loadl_epi64((const __m128i *)(chroma1 + x));
+		__m256i y0 = _mm256_cvtepu8_epi16(
+			_mm_loadu_si128((const __m128i *)(lum0 + x * 2)));
+		__m256i y1 = _mm256_cvtepu8_epi16(
+			_mm_loadu_si128((const __m128i *)(lum1 + x * 2)));
+
+		/* (u << 8) | v, once for each of the two pixels, with pixels
+		 * 0-7 in the low half and 8-15 in the high half like y */
+		__m128i uv = _mm_unpacklo_epi8(v, u);
+		__m256i uv2 = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_unpacklo_epi16(uv, uv)),
+			_mm_unpackhi_epi16(uv, uv), 1);
+
+		store_interleaved_avx2(output0 + x * 2, uv2, y0);
+		store_interleaved_avx2(output1 + x * 2, uv2, y1);
+	}
+
+	decompress_420_row_scalar(lum0 + x * 2, lum1 + x * 2, chroma0 + x,
+				  chroma1 + x, output0 + x * 2,
+				  output1 + x * 2, width_d2 - x);
+}
+
+AVX2_FUNC static void decompress_nv12_row_avx2(const uint8_t *lum0,
+					       const uint8_t *lum1,
+					       const uint16_t *chroma,
+					       uint32_t *output0,
+					       uint32_t *output1,
+					       uint32_t width_d2)
+{
+	uint32_t x;
+
+	for (x = 0; x + 4 <= width_d2; x += 4) {
+		__m128i uv = _mm_loadl_epi64((const __m128i *)(chroma + x));
+		__m128i y0 = _mm_loadl_epi64((const __m128i *)(lum0 + x * 2));
+		__m128i y1 = _mm_loadl_epi64((const __m128i *)(lum1 + x * 2));
+
+		__m256i uv32 = _mm256_slli_epi32(
+			_mm256_cvtepu16_epi32(_mm_unpacklo_epi16(uv, uv)), 8);
+
+		__m256i out0 =
+			_mm256_or_si256(_mm256_cvtepu8_epi32(y0), uv32);
+		__m256i out1 =
+			_mm256_or_si256(_mm256_cvtepu8_epi32(y1), uv32);
+
+		_mm256_storeu_si256((__m256i *)(output0 + x * 2), out0);
+		_mm256_storeu_si256((__m256i *)(output1 + x * 2), out1);
+	}
+
+	decompress_nv12_row_scalar(lum0 + x * 2, lum1 + x * 2, chroma + x,
+				   output0 + x * 2, output1 + x * 2,
+				   width_d2 - x);
+}
+
+AVX2_FUNC static void decompress_422_row_avx2(const uint32_t *input32,
+					      uint32_t *output32,
+					      uint32_t width_d2,
+					      bool leading_lum)
+{
+	const __m256i keep = _mm256_set1_epi32(leading_lum ? 0xFFFFFF00
+							   : 0xFFFF00FF);
+	const __m256i move = _mm256_set1_epi32(leading_lum ? 0x000000FF
+							   : 0x0000FF00);
+	uint32_t x;
+
+	for (x = 0; x + 8 <= width_d2; x += 8) {
+		__m256i dw = _mm256_loadu_si256((const __m256i *)(input32 + x));
+		__m256i dw2 = _mm256_or_si256(
+			_mm256_and_si256(dw, keep),
+			_mm256_and_si256(_mm256_srli_epi32(dw, 16), move));
+
+		/* the unpacks work within each 128 bit half */
+		__m256i lo = _mm256_unpacklo_epi32(dw, dw2);
+		__m256i hi = _mm256_unpackhi_epi32(dw, dw2);
+
+		__m256i *out = (__m256i *)(output32 + x * 2);
+		_mm256_storeu_si256(out,
+				    _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256(out + 1,
+				    _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+
+	decompress_422_row_scalar(input32 + x, output32 + x * 2, width_d2 - x,
+				  leading_lum);
+}
+
+DEFINE_CONVERSIONS(avx2, AVX2_FUNC) = {
+	.type = FORMAT_CONVERSION_AVX2,
+	.name = "AVX2",
+	CONVERSION_FUNCS(avx2),
+};
+#endif
+
+const struct format_conversion_funcs *format_conversion_get_avx2(void)
+{
+#ifdef HAVE_AVX2_INTRIN
+	return cpu_has_avx2() ? &conversions_avx2 : NULL;
+#else
+	return NULL;
+#endif
+}
@@ -0,0 +1,349 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "format-conversion.h"
+
+/*
+ * Every kernel set converts a pair of lines (or a single line) at a time and
+ * leaves whatever doesn't fill a whole vector to the scalar row functions,
+ * so the widths and strides don't need to be multiples of anything and the
+ * buffers don't need to be aligned.
+ */
+
+static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
+{
+	return a < b ? a : b;
+}
+
+/* ------------------------------------------------------------------------- */
+/* scalar                                                                    */
+
+static inline uint8_t avg4(const uint8_t *p0, const uint8_t *p1, size_t off)
+{
+	return (uint8_t)((p0[off] + p0[off + 4] + p1[off] + p1[off + 4]) >> 2);
+}
+
+static inline void uyvx_to_i420_row_scalar(const uint8_t *line0,
+					   const uint8_t *line1, uint8_t *lum0,
+					   uint8_t *lum1, uint8_t *u,
+					   uint8_t *v, uint32_t width)
+{
+	for (uint32_t x = 0; x < width; x += 2) {
+		const uint8_t *p0 = line0 + x * 4;
+		const uint8_t *p1 = line1 + x * 4;
+
+		lum0[x] = p0[1];
+		lum1[x] = p1[1];
+
+		if (x + 1 < width) {
+			lum0[x + 1] = p0[5];
+			lum1[x + 1] = p1[5];
+			u[x >> 1] = avg4(p0, p1, 0);
+			v[x >> 1] = avg4(p0, p1, 2);
+		} else {
+			u[x >> 1] = (uint8_t)((p0[0] + p1[0]) >> 1);
+			v[x >> 1] = (uint8_t)((p0[2] + p1[2]) >> 1);
+		}
+	}
+}
+
+static inline void uyvx_to_nv12_row_scalar(const uint8_t *line0,
+					   const uint8_t *line1, uint8_t *lum0,
+					   uint8_t *lum1, uint8_t *uv,
+					   uint8_t *unused, uint32_t width)
+{
+	UNUSED_PARAMETER(unused);
+
+	for (uint32_t x = 0; x < width; x += 2) {
+		const uint8_t *p0 = line0 + x * 4;
+		const uint8_t *p1 = line1 + x * 4;
+
+		lum0[x] = p0[1];
+		lum1[x] = p1[1];
+
+		if (x + 1 < width) {
+			lum0[x + 1] = p0[5];
+			lum1[x + 1] = p1[5];
+			uv[x] = avg4(p0, p1, 0);
+			uv[x + 1] = avg4(p0, p1, 2);
+		} else {
+			uv[x] = (uint8_t)((p0[0] + p1[0]) >> 1);
+			uv[x + 1] = (uint8_t)((p0[2] + p1[2]) >> 1);
+		}
+	}
+}
+
+static inline void uyvx_to_i444_row_scalar(const uint8_t *line, uint8_t *lum,
+					   uint8_t *u, uint8_t *v,
+					   uint32_t width)
+{
+	for (uint32_t x = 0; x < width; x++) {
+		const uint8_t *p = line + x * 4;
+
+		u[x] = p[0];
+		lum[x] = p[1];
+		v[x] = p[2];
+	}
+}
+
+static inline void decompress_420_row_scalar(const uint8_t *lum0,
+					     const uint8_t *lum1,
+					     const uint8_t *chroma0,
+					     const uint8_t *chroma1,
+					     uint32_t *output0,
+					     uint32_t *output1,
+					     uint32_t width_d2)
+{
+	for (uint32_t x = 0; x < width_d2; x++) {
+		uint32_t out;
+		out = (*(chroma0++) << 8) | *(chroma1++);
+
+		*(output0++) = (*(lum0++) << 16) | out;
+		*(output0++) = (*(lum0++) << 16) | out;
+
+		*(output1++) = (*(lum1++) << 16) | out;
+		*(output1++) = (*(lum1++) << 16) | out;
+	}
+}
+
+static inline void decompress_nv12_row_scalar(const uint8_t *lum0,
+					      const uint8_t *lum1,
+					      const uint16_t *chroma,
+					      uint32_t *output0,
+					      uint32_t *output1,
+					      uint32_t width_d2)
+{
+	for (uint32_t x = 0; x < width_d2; x++) {
+		uint32_t out = *(chroma++) << 8;
+
+		*(output0++) = *(lum0++) | out;
+		*(output0++) = *(lum0++) | out;
+
+		*(output1++) = *(lum1++) | out;
+		*(output1++) = *(lum1++) | out;
+	}
+}
+
+static inline void decompress_422_row_scalar(const uint32_t *input32,
+					     uint32_t *output32,
+					     uint32_t width_d2,
+					     bool leading_lum)
+{
+	const uint32_t *input32_end = input32 + width_d2;
+
+	if (leading_lum) {
+		while (input32 < input32_end) {
+			uint32_t dw = *input32;
+
+			output32[0] = dw;
+			dw &= 0xFFFFFF00;
+			dw |= (uint8_t)(dw >> 16);
+			output32[1] = dw;
+
+			output32 += 2;
+			input32++;
+		}
+	} else {
+		while (input32 < input32_end) {
+			uint32_t dw = *input32;
+
+			output32[0] = dw;
+			dw &= 0xFFFF00FF;
+			dw |= (dw >> 16) & 0xFF00;
+			output32[1] = dw;
+
+			output32 += 2;
+			input32++;
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* frame loops shared by every kernel set                                    */
+
+typedef void (*uyvx_to_420_row_t)(const uint8_t *line0, const uint8_t *line1,
+				  uint8_t *lum0, uint8_t *lum1, uint8_t *c0,
+				  uint8_t *c1, uint32_t width);
+typedef void (*uyvx_to_i444_row_t)(const uint8_t *line, uint8_t *lum,
+				   uint8_t *u, uint8_t *v, uint32_t width);
+typedef void (*decompress_420_row_t)(const uint8_t *lum0, const uint8_t *lum1,
+				     const uint8_t *chroma0,
+				     const uint8_t *chroma1, uint32_t *output0,
+				     uint32_t *output1, uint32_t width_d2);
+typedef void (*decompress_nv12_row_t)(const uint8_t *lum0, const uint8_t *lum1,
+				      const uint16_t *chroma, uint32_t *output0,
+				      uint32_t *output1, uint32_t width_d2);
+typedef void (*decompress_422_row_t)(const uint32_t *input32,
+				     uint32_t *output32, uint32_t width_d2,
+				     bool leading_lum);
+
+static FORCE_INLINE void
+uyvx_to_420(const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+	    uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[],
+	    bool nv12, uyvx_to_420_row_t row)
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		const uint8_t *line0 = input + y * in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *c0 = output[1] + (y >> 1) * out_linesize[1];
+		uint8_t *c1 = nv12 ? NULL
+				   : output[2] + (y >> 1) * out_linesize[2];
+
+		row(line0, line0 + in_linesize, lum0, lum0 + out_linesize[0],
+		    c0, c1, width);
+	}
+}
+
+static FORCE_INLINE void
+uyvx_to_i444(const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+	     uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[],
+	     uyvx_to_i444_row_t row)
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+
+	for (uint32_t y = start_y; y < end_y; y++) {
+		row(input + y * in_linesize, output[0] + y * out_linesize[0],
+		    output[1] + y * out_linesize[1],
+		    output[2] + y * out_linesize[2], width);
+	}
+}
+
+static FORCE_INLINE void
+decompress_420_frame(const uint8_t *const input[],
+		     const uint32_t in_linesize[], uint32_t start_y,
+		     uint32_t end_y, uint8_t *output, uint32_t out_linesize,
+		     decompress_420_row_t row)
+{
+	uint32_t width_d2 = in_linesize[0] / 2;
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		const uint8_t *lum0 = input[0] + y * 2 * in_linesize[0];
+		uint8_t *output0 = output + y * 2 * out_linesize;
+
+		row(lum0, lum0 + in_linesize[0], input[1] + y * in_linesize[1],
+		    input[2] + y * in_linesize[2], (uint32_t *)output0,
+		    (uint32_t *)(output0 + out_linesize), width_d2);
+	}
+}
+
+static FORCE_INLINE void
+decompress_nv12_frame(const uint8_t *const input[],
+		      const uint32_t in_linesize[], uint32_t start_y,
+		      uint32_t end_y, uint8_t *output, uint32_t out_linesize,
+		      decompress_nv12_row_t row)
+{
+	uint32_t width_d2 = min_uint32(in_linesize[0], out_linesize) / 2;
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		const uint8_t *lum0 = input[0] + y * 2 * in_linesize[0];
+		uint8_t *output0 = output + y * 2 * out_linesize;
+
+		row(lum0, lum0 + in_linesize[0],
+		    (const uint16_t *)(input[1] + y * in_linesize[1]),
+		    (uint32_t *)output0, (uint32_t *)(output0 + out_linesize),
+		    width_d2);
+	}
+}
+
+static FORCE_INLINE void
+decompress_422_frame(const uint8_t *input, uint32_t in_linesize,
+		     uint32_t start_y, uint32_t end_y, uint8_t *output,
+		     uint32_t out_linesize, bool leading_lum,
+		     decompress_422_row_t row)
+{
+	uint32_t width_d2 = min_uint32(in_linesize, out_linesize) / 2;
+
+	for (uint32_t y = start_y; y < end_y; y++) {
+		row((const uint32_t *)(input + y * in_linesize),
+		    (uint32_t *)(output + y * out_linesize), width_d2,
+		    leading_lum);
+	}
+}
+
+/* defines the frame level functions of a kernel set from its rows */
+#define DEFINE_CONVERSIONS(suffix, attr)                                      \
+	attr static void compress_uyvx_to_i420_##suffix(                       \
+		const uint8_t *input, uint32_t in_linesize, uint32_t start_y,  \
+		uint32_t end_y, uint8_t *output[],                             \
+		const uint32_t out_linesize[])                                 \
+	{                                                                      \
+		uyvx_to_420(input, in_linesize, start_y, end_y, output,        \
+			    out_linesize, false, uyvx_to_i420_row_##suffix);   \
+	}                                                                      \
+	attr static void compress_uyvx_to_nv12_##suffix(                       \
+		const uint8_t *input, uint32_t in_linesize, uint32_t start_y,  \
+		uint32_t end_y, uint8_t *output[],                             \
+		const uint32_t out_linesize[])                                 \
+	{                                                                      \
+		uyvx_to_420(input, in_linesize, start_y, end_y, output,        \
+			    out_linesize, true, uyvx_to_nv12_row_##suffix);    \
+	}                                                                      \
+	attr static void convert_uyvx_to_i444_##suffix(                        \
+		const uint8_t *input, uint32_t in_linesize, uint32_t start_y,  \
+		uint32_t end_y, uint8_t *output[],                             \
+		const uint32_t out_linesize[])                                 \
+	{                                                                      \
+		uyvx_to_i444(input, in_linesize, start_y, end_y, output,       \
+			     out_linesize, uyvx_to_i444_row_##suffix);         \
+	}                                                                      \
+	attr static void decompress_420_##suffix(                              \
+		const uint8_t *const input[], const uint32_t in_linesize[],    \
+		uint32_t start_y, uint32_t end_y, uint8_t *output,             \
+		uint32_t out_linesize)                                         \
+	{                                                                      \
+		decompress_420_frame(input, in_linesize, start_y, end_y,       \
+				     output, out_linesize,                     \
+				     decompress_420_row_##suffix);             \
+	}                                                                      \
+	attr static void decompress_nv12_##suffix(                             \
+		const uint8_t *const input[], const uint32_t in_linesize[],    \
+		uint32_t start_y, uint32_t end_y, uint8_t *output,             \
+		uint32_t out_linesize)                                         \
+	{                                                                      \
+		decompress_nv12_frame(input, in_linesize, start_y, end_y,      \
+				      output, out_linesize,                    \
+				      decompress_nv12_row_##suffix);           \
+	}                                                                      \
+	attr static void decompress_422_##suffix(                              \
+		const uint8_t *input, uint32_t in_linesize, uint32_t start_y,  \
+		uint32_t end_y, uint8_t *output, uint32_t out_linesize,        \
+		bool leading_lum)                                              \
+	{                                                                      \
+		decompress_422_frame(input, in_linesize, start_y, end_y,       \
+				     output, out_linesize, leading_lum,        \
+				     decompress_422_row_##suffix);             \
+	}                                                                      \
+	static const struct format_conversion_funcs conversions_##suffix
+
+#define CONVERSION_FUNCS(suffix)                                \
+	.compress_uyvx_to_i420 = compress_uyvx_to_i420_##suffix, \
+	.compress_uyvx_to_nv12 = compress_uyvx_to_nv12_##suffix, \
+	.convert_uyvx_to_i444 = convert_uyvx_to_i444_##suffix,   \
+	.decompress_420 = decompress_420_##suffix,               \
+	.decompress_nv12 = decompress_nv12_##suffix,             \
+	.decompress_422 = decompress_422_##suffix
+
+/*
+ * The AVX2 conversions live in their own translation unit so that the native
+ * intrinsics never meet simde's native aliases.  Returns NULL if the CPU or
+ * build doesn't support them.
+ */
+extern const struct format_conversion_funcs *format_conversion_get_avx2(void);
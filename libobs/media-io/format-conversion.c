@@ -15,39 +15,46 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
-#include "format-conversion.h"
-
 #include "../util/sse-intrin.h"
+#include "../util/threading.h"
+#include "format-conversion-internal.h"
+
+DEFINE_CONVERSIONS(scalar, ) = {
+	.type = FORMAT_CONVERSION_SCALAR,
+	.name = "scalar",
+	CONVERSION_FUNCS(scalar),
+};
 
-/* ...surprisingly, if I don't use a macro to force inlining, it causes the
- * CPU usage to boost by a tremendous amount in debug builds. */
+/* ------------------------------------------------------------------------- */
+/* SSE2 (NEON through simde on non-x86), 4 pixels at a time for UYVX input,  */
+/* 8 pixels at a time for decompression                                      */
 
 #define get_m128_32_0(val) (*((uint32_t *)&val))
 #define get_m128_32_1(val) (*(((uint32_t *)&val) + 1))
 
-#define pack_shift(lum_plane, lum_pos0, lum_pos1, line1, line2, mask, sh)      \
+#define pack_shift(lum_pos0, lum_pos1, line1, line2, mask, sh)                 \
 	do {                                                                   \
 		__m128i pack_val = _mm_packs_epi32(                            \
 			_mm_srli_si128(_mm_and_si128(line1, mask), sh),        \
 			_mm_srli_si128(_mm_and_si128(line2, mask), sh));       \
 		pack_val = _mm_packus_epi16(pack_val, pack_val);               \
                                                                                \
-		*(uint32_t *)(lum_plane + lum_pos0) = get_m128_32_0(pack_val); \
-		*(uint32_t *)(lum_plane + lum_pos1) = get_m128_32_1(pack_val); \
+		*(uint32_t *)(lum_pos0) = get_m128_32_0(pack_val);             \
+		*(uint32_t *)(lum_pos1) = get_m128_32_1(pack_val);             \
 	} while (false)
 
-#define pack_val(lum_plane, lum_pos0, lum_pos1, line1, line2, mask)            \
+#define pack_val(lum_pos0, lum_pos1, line1, line2, mask)                       \
 	do {                                                                   \
 		__m128i pack_val =                                             \
 			_mm_packs_epi32(_mm_and_si128(line1, mask),            \
 					_mm_and_si128(line2, mask));           \
 		pack_val = _mm_packus_epi16(pack_val, pack_val);               \
                                                                                \
-		*(uint32_t *)(lum_plane + lum_pos0) = get_m128_32_0(pack_val); \
-		*(uint32_t *)(lum_plane + lum_pos1) = get_m128_32_1(pack_val); \
+		*(uint32_t *)(lum_pos0) = get_m128_32_0(pack_val);             \
+		*(uint32_t *)(lum_pos1) = get_m128_32_1(pack_val);             \
 	} while (false)
 
-#define pack_ch_1plane(uv_plane, chroma_pos, line1, line2, uv_mask)            \
+#define pack_ch_1plane(uv_pos, line1, line2, uv_mask)                          \
 	do {                                                                   \
 		__m128i add_val =                                              \
 			_mm_add_epi64(_mm_and_si128(line1, uv_mask),           \
@@ -59,10 +66,10 @@
 		avg_val = _mm_shuffle_epi32(avg_val, _MM_SHUFFLE(3, 1, 2, 0)); \
 		avg_val = _mm_packus_epi16(avg_val, avg_val);                  \
                                                                                \
-		*(uint32_t *)(uv_plane + chroma_pos) = get_m128_32_0(avg_val); \
+		*(uint32_t *)(uv_pos) = get_m128_32_0(avg_val);                \
 	} while (false)
 
-#define pack_ch_2plane(u_plane, v_plane, chroma_pos, line1, line2, uv_mask)    \
+#define pack_ch_2plane(u_pos, v_pos, line1, line2, uv_mask)                    \
 	do {                                                                   \
 		uint32_t packed_vals;                                          \
                                                                                \
@@ -80,239 +87,255 @@
                                                                                \
 		packed_vals = get_m128_32_0(avg_val);                          \
                                                                                \
-		*(uint16_t *)(u_plane + chroma_pos) = (uint16_t)(packed_vals); \
-		*(uint16_t *)(v_plane + chroma_pos) =                          \
-			(uint16_t)(packed_vals >> 16);                         \
+		*(uint16_t *)(u_pos) = (uint16_t)(packed_vals);                \
+		*(uint16_t *)(v_pos) = (uint16_t)(packed_vals >> 16);          \
 	} while (false)
 
-static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
+static void uyvx_to_i420_row_sse2(const uint8_t *line0, const uint8_t *line1,
+				  uint8_t *lum0, uint8_t *lum1, uint8_t *u,
+				  uint8_t *v, uint32_t width)
 {
-	return a < b ? a : b;
-}
-
-void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize,
-			   uint32_t start_y, uint32_t end_y, uint8_t *output[],
-			   const uint32_t out_linesize[])
-{
-	uint8_t *lum_plane = output[0];
-	uint8_t *u_plane = output[1];
-	uint8_t *v_plane = output[2];
-	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
-	uint32_t y;
-
 	__m128i lum_mask = _mm_set1_epi32(0x0000FF00);
 	__m128i uv_mask = _mm_set1_epi16(0x00FF);
+	uint32_t x;
 
-	for (y = start_y; y < end_y; y += 2) {
-		uint32_t y_pos = y * in_linesize;
-		uint32_t chroma_y_pos = (y >> 1) * out_linesize[1];
-		uint32_t lum_y_pos = y * out_linesize[0];
-		uint32_t x;
-
-		for (x = 0; x < width; x += 4) {
-			const uint8_t *img = input + y_pos + x * 4;
-			uint32_t lum_pos0 = lum_y_pos + x;
-			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
-
-			__m128i line1 = _mm_load_si128((const __m128i *)img);
-			__m128i line2 = _mm_load_si128(
-				(const __m128i *)(img + in_linesize));
-
-			pack_shift(lum_plane, lum_pos0, lum_pos1, line1, line2,
-				   lum_mask, 1);
-			pack_ch_2plane(u_plane, v_plane,
-				       chroma_y_pos + (x >> 1), line1, line2,
-				       uv_mask);
-		}
+	for (x = 0; x + 4 <= width; x += 4) {
+		__m128i l0 = _mm_loadu_si128((const __m128i *)(line0 + x * 4));
+		__m128i l1 = _mm_loadu_si128((const __m128i *)(line1 + x * 4));
+
+		pack_shift(lum0 + x, lum1 + x, l0, l1, lum_mask, 1);
+		pack_ch_2plane(u + (x >> 1), v + (x >> 1), l0, l1, uv_mask);
 	}
+
+	uyvx_to_i420_row_scalar(line0 + x * 4, line1 + x * 4, lum0 + x,
+				lum1 + x, u + (x >> 1), v + (x >> 1),
+				width - x);
 }
 
-void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize,
-			   uint32_t start_y, uint32_t end_y, uint8_t *output[],
-			   const uint32_t out_linesize[])
+static void uyvx_to_nv12_row_sse2(const uint8_t *line0, const uint8_t *line1,
+				  uint8_t *lum0, uint8_t *lum1, uint8_t *uv,
+				  uint8_t *unused, uint32_t width)
 {
-	uint8_t *lum_plane = output[0];
-	uint8_t *chroma_plane = output[1];
-	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
-	uint32_t y;
-
 	__m128i lum_mask = _mm_set1_epi32(0x0000FF00);
 	__m128i uv_mask = _mm_set1_epi16(0x00FF);
+	uint32_t x;
+
+	for (x = 0; x + 4 <= width; x += 4) {
+		__m128i l0 = _mm_loadu_si128((const __m128i *)(line0 + x * 4));
+		__m128i l1 = _mm_loadu_si128((const __m128i *)(line1 + x * 4));
 
-	for (y = start_y; y < end_y; y += 2) {
-		uint32_t y_pos = y * in_linesize;
-		uint32_t chroma_y_pos = (y >> 1) * out_linesize[1];
-		uint32_t lum_y_pos = y * out_linesize[0];
-		uint32_t x;
-
-		for (x = 0; x < width; x += 4) {
-			const uint8_t *img = input + y_pos + x * 4;
-			uint32_t lum_pos0 = lum_y_pos + x;
-			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
-
-			__m128i line1 = _mm_load_si128((const __m128i *)img);
-			__m128i line2 = _mm_load_si128(
-				(const __m128i *)(img + in_linesize));
-
-			pack_shift(lum_plane, lum_pos0, lum_pos1, line1, line2,
-				   lum_mask, 1);
-			pack_ch_1plane(chroma_plane, chroma_y_pos + x, line1,
-				       line2, uv_mask);
-		}
+		pack_shift(lum0 + x, lum1 + x, l0, l1, lum_mask, 1);
+		pack_ch_1plane(uv + x, l0, l1, uv_mask);
 	}
+
+	uyvx_to_nv12_row_scalar(line0 + x * 4, line1 + x * 4, lum0 + x,
+				lum1 + x, uv + x, unused, width - x);
 }
 
-void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize,
-			  uint32_t start_y, uint32_t end_y, uint8_t *output[],
-			  const uint32_t out_linesize[])
+static void uyvx_to_i444_row_sse2(const uint8_t *line, uint8_t *lum,
+				  uint8_t *u, uint8_t *v, uint32_t width)
 {
-	uint8_t *lum_plane = output[0];
-	uint8_t *u_plane = output[1];
-	uint8_t *v_plane = output[2];
-	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
-	uint32_t y;
-
 	__m128i lum_mask = _mm_set1_epi32(0x0000FF00);
 	__m128i u_mask = _mm_set1_epi32(0x000000FF);
 	__m128i v_mask = _mm_set1_epi32(0x00FF0000);
+	uint32_t x;
+
+	/* the pack macros write two lines at once, so do 8 pixels of the
+	 * same line as two halves */
+	for (x = 0; x + 8 <= width; x += 8) {
+		__m128i l0 = _mm_loadu_si128((const __m128i *)(line + x * 4));
+		__m128i l1 =
+			_mm_loadu_si128((const __m128i *)(line + x * 4 + 16));
+
+		pack_shift(lum + x, lum + x + 4, l0, l1, lum_mask, 1);
+		pack_val(u + x, u + x + 4, l0, l1, u_mask);
+		pack_shift(v + x, v + x + 4, l0, l1, v_mask, 2);
+	}
+
+	uyvx_to_i444_row_scalar(line + x * 4, lum + x, u + x, v + x,
+				width - x);
+}
+
+static void decompress_420_row_sse2(const uint8_t *lum0, const uint8_t *lum1,
+				    const uint8_t *chroma0,
+				    const uint8_t *chroma1, uint32_t *output0,
+				    uint32_t *output1, uint32_t width_d2)
+{
+	const __m128i zero = _mm_setzero_si128();
+	uint32_t x;
+
+	for (x = 0; x + 4 <= width_d2; x += 4) {
+		__m128i u = _mm_cvtsi32_si128(*(const int *)(chroma0 + x));
+		__m128i v = _mm_cvtsi32_si128(*(const int *)(chroma1 + x));
+		__m128i y0 = _mm_loadl_epi64((const __m128i *)(lum0 + x * 2));
+		__m128i y1 = _mm_loadl_epi64((const __m128i *)(lum1 + x * 2));
+
+		/* (u << 8) | v, once for each of the two pixels */
+		__m128i uv = _mm_unpacklo_epi8(v, u);
+		uv = _mm_unpacklo_epi16(uv, uv);
+
+		y0 = _mm_unpacklo_epi8(y0, zero);
+		y1 = _mm_unpacklo_epi8(y1, zero);
+
+		__m128i *out0 = (__m128i *)(output0 + x * 2);
+		__m128i *out1 = (__m128i *)(output1 + x * 2);
+		_mm_storeu_si128(out0, _mm_unpacklo_epi16(uv, y0));
+		_mm_storeu_si128(out0 + 1, _mm_unpackhi_epi16(uv, y0));
+		_mm_storeu_si128(out1, _mm_unpacklo_epi16(uv, y1));
+		_mm_storeu_si128(out1 + 1, _mm_unpackhi_epi16(uv, y1));
+	}
+
+	decompress_420_row_scalar(lum0 + x * 2, lum1 + x * 2, chroma0 + x,
+				  chroma1 + x, output0 + x * 2,
+				  output1 + x * 2, width_d2 - x);
+}
+
+static void decompress_nv12_row_sse2(const uint8_t *lum0, const uint8_t *lum1,
+				     const uint16_t *chroma, uint32_t *output0,
+				     uint32_t *output1, uint32_t width_d2)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lo_mask = _mm_set1_epi16(0x00FF);
+	uint32_t x;
+
+	for (x = 0; x + 4 <= width_d2; x += 4) {
+		__m128i uv = _mm_loadl_epi64((const __m128i *)(chroma + x));
+		__m128i y0 = _mm_loadl_epi64((const __m128i *)(lum0 + x * 2));
+		__m128i y1 = _mm_loadl_epi64((const __m128i *)(lum1 + x * 2));
+
+		/* y | (u << 8) in the low words, v in the high words */
+		uv = _mm_unpacklo_epi16(uv, uv);
+		__m128i u = _mm_slli_epi16(_mm_and_si128(uv, lo_mask), 8);
+		__m128i v = _mm_srli_epi16(uv, 8);
+
+		y0 = _mm_or_si128(_mm_unpacklo_epi8(y0, zero), u);
+		y1 = _mm_or_si128(_mm_unpacklo_epi8(y1, zero), u);
+
+		__m128i *out0 = (__m128i *)(output0 + x * 2);
+		__m128i *out1 = (__m128i *)(output1 + x * 2);
+		_mm_storeu_si128(out0, _mm_unpacklo_epi16(y0, v));
+		_mm_storeu_si128(out0 + 1, _mm_unpackhi_epi16(y0, v));
+		_mm_storeu_si128(out1, _mm_unpacklo_epi16(y1, v));
+		_mm_storeu_si128(out1 + 1, _mm_unpackhi_epi16(y1, v));
+	}
+
+	decompress_nv12_row_scalar(lum0 + x * 2, lum1 + x * 2, chroma + x,
+				   output0 + x * 2, output1 + x * 2,
+				   width_d2 - x);
+}
+
+static void decompress_422_row_sse2(const uint32_t *input32,
+				    uint32_t *output32, uint32_t width_d2,
+				    bool leading_lum)
+{
+	/* replaces the first luma sample with the second one */
+	const __m128i keep = _mm_set1_epi32(leading_lum ? 0xFFFFFF00
+							: 0xFFFF00FF);
+	const __m128i move = _mm_set1_epi32(leading_lum ? 0x000000FF
+							: 0x0000FF00);
+	uint32_t x;
+
+	for (x = 0; x + 4 <= width_d2; x += 4) {
+		__m128i dw = _mm_loadu_si128((const __m128i *)(input32 + x));
+		__m128i dw2 = _mm_or_si128(
+			_mm_and_si128(dw, keep),
+			_mm_and_si128(_mm_srli_epi32(dw, 16), move));
+
+		__m128i *out = (__m128i *)(output32 + x * 2);
+		_mm_storeu_si128(out, _mm_unpacklo_epi32(dw, dw2));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi32(dw, dw2));
+	}
+
+	decompress_422_row_scalar(input32 + x, output32 + x * 2, width_d2 - x,
+				  leading_lum);
+}
+
+DEFINE_CONVERSIONS(sse2, ) = {
+	.type = FORMAT_CONVERSION_SSE2,
+	.name = "SSE2",
+	CONVERSION_FUNCS(sse2),
+};
+
+/* ------------------------------------------------------------------------- */
+
+static pthread_once_t conversions_once = PTHREAD_ONCE_INIT;
+static const struct format_conversion_funcs *conversions_active =
+	&conversions_scalar;
+
+static void select_conversions(void)
+{
+	const struct format_conversion_funcs *avx2 =
+		format_conversion_get_avx2();
+
+	conversions_active = avx2 ? avx2 : &conversions_sse2;
+}
 
-	for (y = start_y; y < end_y; y += 2) {
-		uint32_t y_pos = y * in_linesize;
-		uint32_t lum_y_pos = y * out_linesize[0];
-		uint32_t x;
-
-		for (x = 0; x < width; x += 4) {
-			const uint8_t *img = input + y_pos + x * 4;
-			uint32_t lum_pos0 = lum_y_pos + x;
-			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
-
-			__m128i line1 = _mm_load_si128((const __m128i *)img);
-			__m128i line2 = _mm_load_si128(
-				(const __m128i *)(img + in_linesize));
-
-			pack_shift(lum_plane, lum_pos0, lum_pos1, line1, line2,
-				   lum_mask, 1);
-			pack_val(u_plane, lum_pos0, lum_pos1, line1, line2,
-				 u_mask);
-			pack_shift(v_plane, lum_pos0, lum_pos1, line1, line2,
-				   v_mask, 2);
-		}
+const struct format_conversion_funcs *format_conversion_get(void)
+{
+	pthread_once(&conversions_once, select_conversions);
+	return conversions_active;
+}
+
+const struct format_conversion_funcs *
+format_conversion_get_type(enum format_conversion_type type)
+{
+	switch (type) {
+	case FORMAT_CONVERSION_SCALAR:
+		return &conversions_scalar;
+	case FORMAT_CONVERSION_SSE2:
+		return &conversions_sse2;
+	case FORMAT_CONVERSION_AVX2:
+		return format_conversion_get_avx2();
 	}
+
+	return NULL;
+}
+
+void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize,
+			   uint32_t start_y, uint32_t end_y, uint8_t *output[],
+			   const uint32_t out_linesize[])
+{
+	format_conversion_get()->compress_uyvx_to_i420(
+		input, in_linesize, start_y, end_y, output, out_linesize);
+}
+
+void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize,
+			   uint32_t start_y, uint32_t end_y, uint8_t *output[],
+			   const uint32_t out_linesize[])
+{
+	format_conversion_get()->compress_uyvx_to_nv12(
+		input, in_linesize, start_y, end_y, output, out_linesize);
+}
+
+void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize,
+			  uint32_t start_y, uint32_t end_y, uint8_t *output[],
+			  const uint32_t out_linesize[])
+{
+	format_conversion_get()->convert_uyvx_to_i444(
+		input, in_linesize, start_y, end_y, output, out_linesize);
 }
 
 void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
 		    uint32_t start_y, uint32_t end_y, uint8_t *output,
 		    uint32_t out_linesize)
 {
-	uint32_t start_y_d2 = start_y / 2;
-	uint32_t width_d2 = in_linesize[0] / 2;
-	uint32_t height_d2 = end_y / 2;
-	uint32_t y;
-
-	for (y = start_y_d2; y < height_d2; y++) {
-		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
-		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
-		register const uint8_t *lum0, *lum1;
-		register uint32_t *output0, *output1;
-		uint32_t x;
-
-		lum0 = input[0] + y * 2 * in_linesize[0];
-		lum1 = lum0 + in_linesize[0];
-		output0 = (uint32_t *)(output + y * 2 * out_linesize);
-		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
-
-		for (x = 0; x < width_d2; x++) {
-			uint32_t out;
-			out = (*(chroma0++) << 8) | *(chroma1++);
-
-			*(output0++) = (*(lum0++) << 16) | out;
-			*(output0++) = (*(lum0++) << 16) | out;
-
-			*(output1++) = (*(lum1++) << 16) | out;
-			*(output1++) = (*(lum1++) << 16) | out;
-		}
-	}
+	format_conversion_get()->decompress_420(input, in_linesize, start_y,
+						end_y, output, out_linesize);
 }
 
 void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 		     uint32_t start_y, uint32_t end_y, uint8_t *output,
 		     uint32_t out_linesize)
 {
-	uint32_t start_y_d2 = start_y / 2;
-	uint32_t width_d2 = min_uint32(in_linesize[0], out_linesize) / 2;
-	uint32_t height_d2 = end_y / 2;
-	uint32_t y;
-
-	for (y = start_y_d2; y < height_d2; y++) {
-		const uint16_t *chroma;
-		register const uint8_t *lum0, *lum1;
-		register uint32_t *output0, *output1;
-		uint32_t x;
-
-		chroma = (const uint16_t *)(input[1] + y * in_linesize[1]);
-		lum0 = input[0] + y * 2 * in_linesize[0];
-		lum1 = lum0 + in_linesize[0];
-		output0 = (uint32_t *)(output + y * 2 * out_linesize);
-		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
-
-		for (x = 0; x < width_d2; x++) {
-			uint32_t out = *(chroma++) << 8;
-
-			*(output0++) = *(lum0++) | out;
-			*(output0++) = *(lum0++) | out;
-
-			*(output1++) = *(lum1++) | out;
-			*(output1++) = *(lum1++) | out;
-		}
-	}
+	format_conversion_get()->decompress_nv12(input, in_linesize, start_y,
+						 end_y, output, out_linesize);
 }
 
 void decompress_422(const uint8_t *input, uint32_t in_linesize,
 		    uint32_t start_y, uint32_t end_y, uint8_t *output,
 		    uint32_t out_linesize, bool leading_lum)
 {
-	uint32_t width_d2 = min_uint32(in_linesize, out_linesize) / 2;
-	uint32_t y;
-
-	register const uint32_t *input32;
-	register const uint32_t *input32_end;
-	register uint32_t *output32;
-
-	if (leading_lum) {
-		for (y = start_y; y < end_y; y++) {
-			input32 = (const uint32_t *)(input + y * in_linesize);
-			input32_end = input32 + width_d2;
-			output32 = (uint32_t *)(output + y * out_linesize);
-
-			while (input32 < input32_end) {
-				register uint32_t dw = *input32;
-
-				output32[0] = dw;
-				dw &= 0xFFFFFF00;
-				dw |= (uint8_t)(dw >> 16);
-				output32[1] = dw;
-
-				output32 += 2;
-				input32++;
-			}
-		}
-	} else {
-		for (y = start_y; y < end_y; y++) {
-			input32 = (const uint32_t *)(input + y * in_linesize);
-			input32_end = input32 + width_d2;
-			output32 = (uint32_t *)(output + y * out_linesize);
-
-			while (input32 < input32_end) {
-				register uint32_t dw = *input32;
-
-				output32[0] = dw;
-				dw &= 0xFFFF00FF;
-				dw |= (dw >> 16) & 0xFF00;
-				output32[1] = dw;
-
-				output32 += 2;
-				input32++;
-			}
-		}
-	}
+	format_conversion_get()->decompress_422(input, in_linesize, start_y,
+						end_y, output, out_linesize,
+						leading_lum);
 }
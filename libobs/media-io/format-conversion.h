@@ -24,7 +24,9 @@ extern "C" {
 #endif
 
 /*
- * Functions for converting to and from packed 444 YUV
+ * Functions for converting to and from packed 444 YUV.  These use the
+ * fastest kernel set supported by the CPU; every set produces bit-identical
+ * output, and none of them require aligned buffers or strides.
  */
 
 EXPORT void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize,
@@ -56,6 +58,54 @@ EXPORT void decompress_422(const uint8_t *input, uint32_t in_linesize,
 			   uint32_t start_y, uint32_t end_y, uint8_t *output,
 			   uint32_t out_linesize, bool leading_lum);
 
+enum format_conversion_type {
+	FORMAT_CONVERSION_SCALAR,
+	FORMAT_CONVERSION_SSE2, /* NEON on ARM via simde */
+	FORMAT_CONVERSION_AVX2,
+};
+
+#define FORMAT_CONVERSION_COUNT 3
+
+struct format_conversion_funcs {
+	enum format_conversion_type type;
+	const char *name;
+
+	void (*compress_uyvx_to_i420)(const uint8_t *input,
+				      uint32_t in_linesize, uint32_t start_y,
+				      uint32_t end_y, uint8_t *output[],
+				      const uint32_t out_linesize[]);
+	void (*compress_uyvx_to_nv12)(const uint8_t *input,
+				      uint32_t in_linesize, uint32_t start_y,
+				      uint32_t end_y, uint8_t *output[],
+				      const uint32_t out_linesize[]);
+	void (*convert_uyvx_to_i444)(const uint8_t *input,
+				     uint32_t in_linesize, uint32_t start_y,
+				     uint32_t end_y, uint8_t *output[],
+				     const uint32_t out_linesize[]);
+	void (*decompress_nv12)(const uint8_t *const input[],
+				const uint32_t in_linesize[], uint32_t start_y,
+				uint32_t end_y, uint8_t *output,
+				uint32_t out_linesize);
+	void (*decompress_420)(const uint8_t *const input[],
+			       const uint32_t in_linesize[], uint32_t start_y,
+			       uint32_t end_y, uint8_t *output,
+			       uint32_t out_linesize);
+	void (*decompress_422)(const uint8_t *input, uint32_t in_linesize,
+			       uint32_t start_y, uint32_t end_y,
+			       uint8_t *output, uint32_t out_linesize,
+			       bool leading_lum);
+};
+
+/** Returns the kernel set used by the functions above */
+EXPORT const struct format_conversion_funcs *format_conversion_get(void);
+
+/**
+ * Returns a specific kernel set, or NULL if it is not supported by this
+ * CPU or build.  Mostly useful for testing and benchmarking.
+ */
+EXPORT const struct format_conversion_funcs *
+format_conversion_get_type(enum format_conversion_type type);
+
 #ifdef __cplusplus
 }
 #endif
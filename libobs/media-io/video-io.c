@@ -22,6 +22,7 @@
 #include "../util/profiler.h"
 #include "../util/threading.h"
 #include "../util/darray.h"
+#include "../util/task.h"
 #include "../util/util_uint64.h"
 
 #include "format-conversion.h"
@@ -33,6 +34,27 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
 #define MAX_CONVERT_BUFFERS 3
 #define MAX_CACHE_SIZE 16
+#define MAX_SCALE_THREADS 3
+
+/* frames are handed to raw callbacks in ref counted buffers, so consumers
+ * can keep them without copying.  a buffer that is still referenced when
+ * its slot comes up again is swapped for a free one from the pool. */
+struct video_buffer_pool {
+	pthread_mutex_t mutex;
+	volatile long refs;
+	bool closed;
+
+	enum video_format format;
+	uint32_t width;
+	uint32_t height;
+	DARRAY(struct video_frame_buffer *) free;
+};
+
+struct video_frame_buffer {
+	struct video_frame frame;
+	volatile long refs;
+	struct video_buffer_pool *pool;
+};
 
 struct cached_frame_info {
 	struct video_data frame;
@@ -40,11 +62,25 @@ struct cached_frame_info {
 	int count;
 };
 
-struct video_input {
+/* inputs that request the same conversion share one scaler and its output */
+struct video_scale_group {
 	struct video_scale_info conversion;
 	video_scaler_t *scaler;
-	struct video_frame frame[MAX_CONVERT_BUFFERS];
+	struct video_buffer_pool *pool;
+	struct video_frame_buffer *frame[MAX_CONVERT_BUFFERS];
 	int cur_frame;
+	long refs;
+
+	/* per frame, set up and read by the video thread */
+	bool needed;
+	bool success;
+	struct video_data data;
+};
+
+struct video_input {
+	struct video_scale_info conversion;
+	struct video_scale_group *group;
+	bool skip;
 
 	// allow outputting at fractions of main composition FPS,
 	// e.g. 60 FPS with frame_rate_divisor = 1 turns into 30 FPS
@@ -60,11 +96,138 @@ struct video_input {
 	void *param;
 };
 
-static inline void video_input_free(struct video_input *input)
+/* ------------------------------------------------------------------------- */
+
+static struct video_buffer_pool *
+video_buffer_pool_create(enum video_format format, uint32_t width,
+			 uint32_t height)
+{
+	struct video_buffer_pool *pool = bzalloc(sizeof(*pool));
+	pthread_mutex_init(&pool->mutex, NULL);
+	pool->refs = 1;
+	pool->format = format;
+	pool->width = width;
+	pool->height = height;
+	return pool;
+}
+
+static void video_buffer_pool_release(struct video_buffer_pool *pool)
+{
+	if (os_atomic_dec_long(&pool->refs) != 0)
+		return;
+
+	da_free(pool->free);
+	pthread_mutex_destroy(&pool->mutex);
+	bfree(pool);
+}
+
+static inline void video_frame_buffer_free(struct video_frame_buffer *buffer)
+{
+	video_frame_free(&buffer->frame);
+	bfree(buffer);
+}
+
+/* buffers still referenced by consumers are freed once they're released */
+static void video_buffer_pool_close(struct video_buffer_pool *pool)
+{
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->closed = true;
+	for (size_t i = 0; i < pool->free.num; i++)
+		video_frame_buffer_free(pool->free.array[i]);
+	da_free(pool->free);
+	pthread_mutex_unlock(&pool->mutex);
+
+	video_buffer_pool_release(pool);
+}
+
+static struct video_frame_buffer *
+video_buffer_pool_get(struct video_buffer_pool *pool)
+{
+	struct video_frame_buffer *buffer = NULL;
+
+	pthread_mutex_lock(&pool->mutex);
+	if (pool->free.num) {
+		buffer = pool->free.array[pool->free.num - 1];
+		da_pop_back(pool->free);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (!buffer) {
+		buffer = bzalloc(sizeof(*buffer));
+		video_frame_init(&buffer->frame, pool->format, pool->width,
+				 pool->height);
+		buffer->pool = pool;
+	}
+
+	os_atomic_inc_long(&pool->refs);
+	buffer->refs = 1;
+	return buffer;
+}
+
+struct video_frame_buffer *video_data_addref(const struct video_data *frame)
+{
+	if (!frame || !frame->buffer)
+		return NULL;
+
+	os_atomic_inc_long(&frame->buffer->refs);
+	return frame->buffer;
+}
+
+void video_frame_buffer_release(struct video_frame_buffer *buffer)
+{
+	struct video_buffer_pool *pool;
+
+	if (!buffer || os_atomic_dec_long(&buffer->refs) != 0)
+		return;
+
+	pool = buffer->pool;
+
+	pthread_mutex_lock(&pool->mutex);
+	if (pool->closed || pool->free.num >= MAX_CACHE_SIZE)
+		video_frame_buffer_free(buffer);
+	else
+		da_push_back(pool->free, &buffer);
+	pthread_mutex_unlock(&pool->mutex);
+
+	video_buffer_pool_release(pool);
+}
+
+/* returns a buffer that is safe to write to, i.e. one nobody else holds */
+static struct video_frame_buffer *
+video_frame_buffer_unique(struct video_frame_buffer *buffer)
+{
+	struct video_frame_buffer *unique;
+
+	if (os_atomic_load_long(&buffer->refs) == 1)
+		return buffer;
+
+	unique = video_buffer_pool_get(buffer->pool);
+	video_frame_buffer_release(buffer);
+	return unique;
+}
+
+static inline void set_frame_buffer(struct video_data *data,
+				    struct video_frame_buffer *buffer)
+{
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		data->data[i] = buffer->frame.data[i];
+		data->linesize[i] = buffer->frame.linesize[i];
+	}
+	data->buffer = buffer;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void video_scale_group_free(struct video_scale_group *group)
 {
 	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
-	video_scaler_destroy(input->scaler);
+		video_frame_buffer_release(group->frame[i]);
+	video_buffer_pool_close(group->pool);
+	video_scaler_destroy(group->scaler);
+	bfree(group);
 }
 
 struct video_output {
@@ -75,17 +238,22 @@ struct video_output {
 	bool stop;
 
 	os_sem_t *update_semaphore;
+	os_event_t *available_event;
 	uint64_t frame_time;
 	volatile long skipped_frames;
 	volatile long total_frames;
 
 	pthread_mutex_t input_mutex;
 	DARRAY(struct video_input) inputs;
+	DARRAY(struct video_scale_group *) scale_groups;
+	DARRAY(struct video_scale_group *) scale_jobs;
+	os_thread_pool_t *scale_pool;
 
 	size_t available_frames;
 	size_t first_added;
 	size_t last_added;
 	struct cached_frame_info cache[MAX_CACHE_SIZE];
+	struct video_buffer_pool *cache_pool;
 
 	struct video_output *parent;
 
@@ -95,35 +263,62 @@ struct video_output {
 
 /* ------------------------------------------------------------------------- */
 
-static inline bool scale_video_output(struct video_input *input,
-				      struct video_data *data)
+static void scale_video_output(struct video_scale_group *group,
+			       const struct video_data *input)
 {
-	bool success = true;
+	struct video_frame_buffer *buffer;
 
-	if (input->scaler) {
-		struct video_frame *frame;
+	if (++group->cur_frame == MAX_CONVERT_BUFFERS)
+		group->cur_frame = 0;
 
-		if (++input->cur_frame == MAX_CONVERT_BUFFERS)
-			input->cur_frame = 0;
+	buffer = video_frame_buffer_unique(group->frame[group->cur_frame]);
+	group->frame[group->cur_frame] = buffer;
+	group->data = *input;
 
-		frame = &input->frame[input->cur_frame];
+	group->success = video_scaler_scale(group->scaler, buffer->frame.data,
+					    buffer->frame.linesize,
+					    (const uint8_t *const *)input->data,
+					    input->linesize);
 
-		success = video_scaler_scale(input->scaler, frame->data,
-					     frame->linesize,
-					     (const uint8_t *const *)data->data,
-					     data->linesize);
+	if (group->success) {
+		set_frame_buffer(&group->data, buffer);
+	} else {
+		blog(LOG_WARNING, "video-io: Could not scale frame!");
+	}
+}
 
-		if (success) {
-			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-				data->data[i] = frame->data[i];
-				data->linesize[i] = frame->linesize[i];
-			}
-		} else {
-			blog(LOG_WARNING, "video-io: Could not scale frame!");
-		}
+struct scale_job_info {
+	struct video_output *video;
+	const struct video_data *input;
+};
+
+static void scale_job(void *param, size_t idx)
+{
+	struct scale_job_info *info = param;
+	scale_video_output(info->video->scale_jobs.array[idx], info->input);
+}
+
+/* scales the frame once for every conversion that is needed this frame,
+ * concurrently when there's more than one */
+static void scale_video_inputs(struct video_output *video,
+			       const struct video_data *input)
+{
+	da_resize(video->scale_jobs, 0);
+
+	for (size_t i = 0; i < video->scale_groups.num; i++) {
+		struct video_scale_group *group = video->scale_groups.array[i];
+		if (group->needed)
+			da_push_back(video->scale_jobs, &group);
+		group->needed = false;
 	}
 
-	return success;
+	if (video->scale_pool && video->scale_jobs.num > 1) {
+		struct scale_job_info info = {video, input};
+		os_thread_pool_parallel_for(video->scale_pool, scale_job, &info,
+					    video->scale_jobs.num);
+	} else if (video->scale_jobs.num) {
+		scale_video_output(video->scale_jobs.array[0], input);
+	}
 }
 
 static inline bool video_output_cur_frame(struct video_output *video)
@@ -146,21 +341,35 @@ static inline bool video_output_cur_frame(struct video_output *video)
 
 	for (size_t i = 0; i < video->inputs.num; i++) {
 		struct video_input *input = video->inputs.array + i;
-		struct video_data frame = frame_info->frame;
 
 		// an explicit counter is used instead of remainder calculation
 		// to allow multiple encoders started at the same time to start on
 		// the same frame
-		uint32_t skip = input->frame_rate_divisor_counter++;
+		input->skip = input->frame_rate_divisor_counter++ != 0;
 		if (input->frame_rate_divisor_counter ==
 		    input->frame_rate_divisor)
 			input->frame_rate_divisor_counter = 0;
 
-		if (skip)
+		if (!input->skip && input->group)
+			input->group->needed = true;
+	}
+
+	scale_video_inputs(video, &frame_info->frame);
+
+	for (size_t i = 0; i < video->inputs.num; i++) {
+		struct video_input *input = video->inputs.array + i;
+		struct video_data frame = frame_info->frame;
+
+		if (input->skip)
 			continue;
 
-		if (scale_video_output(input, &frame))
-			input->callback(input->param, &frame);
+		if (input->group) {
+			if (!input->group->success)
+				continue;
+			frame = input->group->data;
+		}
+
+		input->callback(input->param, &frame);
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
@@ -179,6 +388,8 @@ static inline bool video_output_cur_frame(struct video_output *video)
 
 		if (++video->available_frames == video->info.cache_size)
 			video->last_added = video->first_added;
+
+		os_event_signal(video->available_event);
 	} else if (skipped) {
 		--frame_info->skipped;
 		os_atomic_inc_long(&video->skipped_frames);
@@ -232,13 +443,12 @@ static inline void init_cache(struct video_output *video)
 	if (video->info.cache_size > MAX_CACHE_SIZE)
 		video->info.cache_size = MAX_CACHE_SIZE;
 
-	for (size_t i = 0; i < video->info.cache_size; i++) {
-		struct video_frame *frame;
-		frame = (struct video_frame *)&video->cache[i];
+	video->cache_pool = video_buffer_pool_create(
+		video->info.format, video->info.width, video->info.height);
 
-		video_frame_init(frame, video->info.format, video->info.width,
-				 video->info.height);
-	}
+	for (size_t i = 0; i < video->info.cache_size; i++)
+		set_frame_buffer(&video->cache[i].frame,
+				 video_buffer_pool_get(video->cache_pool));
 
 	video->available_frames = video->info.cache_size;
 }
@@ -264,14 +474,18 @@ int video_output_open(video_t **video, struct video_output_info *info)
 		goto fail1;
 	if (os_sem_init(&out->update_semaphore, 0) != 0)
 		goto fail2;
-	if (pthread_create(&out->thread, NULL, video_thread, out) != 0)
+	if (os_event_init(&out->available_event, OS_EVENT_TYPE_AUTO) != 0)
 		goto fail3;
+	if (pthread_create(&out->thread, NULL, video_thread, out) != 0)
+		goto fail4;
 
 	init_cache(out);
 
 	*video = out;
 	return VIDEO_OUTPUT_SUCCESS;
 
+fail4:
+	os_event_destroy(out->available_event);
 fail3:
 	os_sem_destroy(out->update_semaphore);
 fail2:
@@ -292,15 +506,20 @@ void video_output_close(video_t *video)
 
 	pthread_mutex_lock(&video->input_mutex);
 
-	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
+	for (size_t i = 0; i < video->scale_groups.num; i++)
+		video_scale_group_free(video->scale_groups.array[i]);
+	da_free(video->scale_groups);
+	da_free(video->scale_jobs);
 	da_free(video->inputs);
+	os_thread_pool_destroy(video->scale_pool);
 
 	for (size_t i = 0; i < video->info.cache_size; i++)
-		video_frame_free((struct video_frame *)&video->cache[i]);
+		video_frame_buffer_release(video->cache[i].frame.buffer);
+	video_buffer_pool_close(video->cache_pool);
 
 	pthread_mutex_unlock(&video->input_mutex);
 	os_sem_destroy(video->update_semaphore);
+	os_event_destroy(video->available_event);
 	pthread_mutex_destroy(&video->data_mutex);
 	pthread_mutex_destroy(&video->input_mutex);
 
@@ -348,6 +567,82 @@ static bool match_space(enum video_colorspace a, enum video_colorspace b)
 	       (collapse_space(a) == collapse_space(b));
 }
 
+static inline bool scale_info_equal(const struct video_scale_info *a,
+				    const struct video_scale_info *b)
+{
+	return a->format == b->format && a->width == b->width &&
+	       a->height == b->height && a->range == b->range &&
+	       a->colorspace == b->colorspace;
+}
+
+static struct video_scale_group *
+video_scale_group_get(struct video_output *video,
+		      const struct video_scale_info *conversion)
+{
+	struct video_scale_group *group;
+
+	for (size_t i = 0; i < video->scale_groups.num; i++) {
+		group = video->scale_groups.array[i];
+		if (scale_info_equal(&group->conversion, conversion)) {
+			group->refs++;
+			return group;
+		}
+	}
+
+	struct video_scale_info from = {.format = video->info.format,
+					.width = video->info.width,
+					.height = video->info.height,
+					.range = video->info.range,
+					.colorspace = video->info.colorspace};
+
+	group = bzalloc(sizeof(*group));
+	group->conversion = *conversion;
+	group->refs = 1;
+	group->pool = video_buffer_pool_create(
+		conversion->format, conversion->width, conversion->height);
+
+	int ret = video_scaler_create(&group->scaler, conversion, &from,
+				      VIDEO_SCALE_FAST_BILINEAR);
+	if (ret != VIDEO_SCALER_SUCCESS) {
+		if (ret == VIDEO_SCALER_BAD_CONVERSION)
+			blog(LOG_ERROR, "video_input_init: Bad "
+					"scale conversion type");
+		else
+			blog(LOG_ERROR, "video_input_init: Failed to "
+					"create scaler");
+
+		video_scale_group_free(group);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
+		group->frame[i] = video_buffer_pool_get(group->pool);
+
+	da_push_back(video->scale_groups, &group);
+
+	/* independent conversions are scaled concurrently */
+	if (video->scale_groups.num > 1 && !video->scale_pool) {
+		int threads = os_get_logical_cores() - 1;
+		if (threads > MAX_SCALE_THREADS)
+			threads = MAX_SCALE_THREADS;
+		if (threads > 0)
+			video->scale_pool = os_thread_pool_create(
+				"video-io: scaling", (size_t)threads);
+	}
+
+	return group;
+}
+
+static void video_scale_group_release(struct video_output *video,
+				      struct video_scale_group *group)
+{
+	if (!group || --group->refs > 0)
+		return;
+
+	da_erase_item(video->scale_groups, &group);
+	video_scale_group_free(group);
+}
+
 static inline bool video_input_init(struct video_input *input,
 				    struct video_output *video)
 {
@@ -357,32 +652,9 @@ static inline bool video_input_init(struct video_input *input,
 	    !match_range(input->conversion.range, video->info.range) ||
 	    !match_space(input->conversion.colorspace,
 			 video->info.colorspace)) {
-		struct video_scale_info from = {.format = video->info.format,
-						.width = video->info.width,
-						.height = video->info.height,
-						.range = video->info.range,
-						.colorspace =
-							video->info.colorspace};
-
-		int ret = video_scaler_create(&input->scaler,
-					      &input->conversion, &from,
-					      VIDEO_SCALE_FAST_BILINEAR);
-		if (ret != VIDEO_SCALER_SUCCESS) {
-			if (ret == VIDEO_SCALER_BAD_CONVERSION)
-				blog(LOG_ERROR, "video_input_init: Bad "
-						"scale conversion type");
-			else
-				blog(LOG_ERROR, "video_input_init: Failed to "
-						"create scaler");
-
+		input->group = video_scale_group_get(video, &input->conversion);
+		if (!input->group)
 			return false;
-		}
-
-		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-			video_frame_init(&input->frame[i],
-					 input->conversion.format,
-					 input->conversion.width,
-					 input->conversion.height);
 	}
 
 	return true;
@@ -501,7 +773,9 @@ void video_output_disconnect(video_t *video,
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array + idx);
+		struct video_input *input = video->inputs.array + idx;
+
+		video_scale_group_release(video, input->group);
 		da_erase(video->inputs, idx);
 
 		if (video->inputs.num == 0) {
@@ -556,7 +830,9 @@ bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 		cfi->count = count;
 		cfi->skipped = 0;
 
-		memcpy(frame, &cfi->frame, sizeof(*frame));
+		set_frame_buffer(&cfi->frame, video_frame_buffer_unique(
+						      cfi->frame.buffer));
+		*frame = cfi->frame.buffer->frame;
 
 		locked = true;
 	}
@@ -581,6 +857,25 @@ void video_output_unlock_frame(video_t *video)
 	pthread_mutex_unlock(&video->data_mutex);
 }
 
+void video_output_wait_available(video_t *video)
+{
+	bool available = false;
+
+	if (!video)
+		return;
+
+	video = get_root(video);
+
+	while (!available) {
+		pthread_mutex_lock(&video->data_mutex);
+		available = video->available_frames > 0 || video->stop;
+		pthread_mutex_unlock(&video->data_mutex);
+
+		if (!available)
+			os_event_timedwait(video->available_event, 10);
+	}
+}
+
 uint64_t video_output_get_frame_time(const video_t *video)
 {
 	return video ? video->frame_time : 0;
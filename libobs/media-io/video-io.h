@@ -118,10 +118,15 @@ enum video_range_type {
 	VIDEO_RANGE_FULL,
 };
 
+/* shared, read-only storage backing a frame, see video_data_addref */
+struct video_frame_buffer;
+
 struct video_data {
 	uint8_t *data[MAX_AV_PLANES];
 	uint32_t linesize[MAX_AV_PLANES];
 	uint64_t timestamp;
+
+	struct video_frame_buffer *buffer;
 };
 
 struct video_output_info {
@@ -320,6 +325,16 @@ EXPORT void video_output_disconnect(video_t *video,
 
 EXPORT bool video_output_active(const video_t *video);
 
+/**
+ * Takes a reference to the storage of a frame passed to a raw video
+ * callback.  The frame data stays valid and unchanged until the reference
+ * is released, so consumers can hold on to it instead of copying it.
+ * Returns NULL if the frame has no shared storage.
+ */
+EXPORT struct video_frame_buffer *
+video_data_addref(const struct video_data *frame);
+EXPORT void video_frame_buffer_release(struct video_frame_buffer *buffer);
+
 EXPORT const struct video_output_info *
 video_output_get_info(const video_t *video);
 EXPORT bool video_output_lock_frame(video_t *video, struct video_frame *frame,
@@ -337,6 +352,9 @@ EXPORT double video_output_get_frame_rate(const video_t *video);
 EXPORT uint32_t video_output_get_skipped_frames(const video_t *video);
 EXPORT uint32_t video_output_get_total_frames(const video_t *video);
 
+/* blocks until a frame can be locked without skipping one */
+extern void video_output_wait_available(video_t *video);
+
 extern void video_output_inc_texture_encoders(video_t *video);
 extern void video_output_dec_texture_encoders(video_t *video);
 extern void video_output_inc_texture_frames(video_t *video);
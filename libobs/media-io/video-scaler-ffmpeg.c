@@ -16,18 +16,44 @@
 ******************************************************************************/
 
 #include "../util/bmem.h"
+#include "../util/task.h"
+#include "../util/threading.h"
 #include "video-scaler.h"
 
 #include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
 #include <libswscale/swscale.h>
 
+/* a horizontal band of the output scaled by its own swscale context.  the
+ * band is scaled with a few extra rows of overlap on each side so that the
+ * filter sees the same neighbors it would when scaling the whole frame, and
+ * those rows are then dropped */
+struct scaler_slice {
+	struct SwsContext *swscale;
+	int src_y;
+	int src_h;
+	int dst_y;
+	int dst_h;
+	int skip;
+	uint8_t *dst_pointers[4];
+	int dst_linesizes[4];
+};
+
 struct video_scaler {
 	struct SwsContext *swscale;
 	int src_height;
+	int dst_height;
 	int dst_heights[4];
 	uint8_t *dst_pointers[4];
 	int dst_linesizes[4];
+
+	/* vertical subsampling of each plane, -1 for missing planes */
+	int src_shifts[4];
+	int dst_shifts[4];
+
+	struct scaler_slice *slices;
+	size_t num_slices;
+	os_thread_pool_t *pool;
 };
 
 static inline enum AVPixelFormat
@@ -145,10 +171,33 @@ static inline int get_ffmpeg_range_type(enum video_range_type type)
 
 #define FIXED_1_0 (1 << 16)
 
-int video_scaler_create(video_scaler_t **scaler_out,
-			const struct video_scale_info *dst,
-			const struct video_scale_info *src,
-			enum video_scale_type type)
+/* rows are only split where both the source and destination row are a
+ * multiple of this, which keeps chroma rows and the 8 row dither patterns
+ * of the destination lined up with a whole frame scale */
+#define SLICE_ALIGN 8
+
+static void get_plane_shifts(int shifts[4], enum AVPixelFormat format)
+{
+	const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+	bool has_plane[4] = {0};
+
+	for (size_t i = 0; i < desc->nb_components; i++)
+		has_plane[desc->comp[i].plane] = true;
+
+	for (size_t i = 0; i < 4; i++) {
+		if (!has_plane[i])
+			shifts[i] = -1;
+		else if (i == 1 || i == 2)
+			shifts[i] = desc->log2_chroma_h;
+		else
+			shifts[i] = 0;
+	}
+}
+
+static struct SwsContext *create_swscale(const struct video_scale_info *dst,
+					 const struct video_scale_info *src,
+					 int dst_height, int src_height,
+					 enum video_scale_type type)
 {
 	enum AVPixelFormat format_src = get_ffmpeg_video_format(src->format);
 	enum AVPixelFormat format_dst = get_ffmpeg_video_format(dst->format);
@@ -157,6 +206,164 @@ int video_scaler_create(video_scaler_t **scaler_out,
 	const int *coeff_dst = get_ffmpeg_coeffs(dst->colorspace);
 	int range_src = get_ffmpeg_range_type(src->range);
 	int range_dst = get_ffmpeg_range_type(dst->range);
+	struct SwsContext *swscale;
+	int ret;
+
+	swscale = sws_alloc_context();
+	if (!swscale) {
+		blog(LOG_ERROR, "video_scaler_create: Could not create "
+				"swscale");
+		return NULL;
+	}
+
+	av_opt_set_int(swscale, "sws_flags", scale_type, 0);
+	av_opt_set_int(swscale, "srcw", src->width, 0);
+	av_opt_set_int(swscale, "srch", src_height, 0);
+	av_opt_set_int(swscale, "dstw", dst->width, 0);
+	av_opt_set_int(swscale, "dsth", dst_height, 0);
+	av_opt_set_int(swscale, "src_format", format_src, 0);
+	av_opt_set_int(swscale, "dst_format", format_dst, 0);
+	av_opt_set_int(swscale, "src_range", range_src, 0);
+	av_opt_set_int(swscale, "dst_range", range_dst, 0);
+	if (sws_init_context(swscale, NULL, NULL) < 0) {
+		blog(LOG_ERROR, "video_scaler_create: sws_init_context failed");
+		sws_freeContext(swscale);
+		return NULL;
+	}
+
+	ret = sws_setColorspaceDetails(swscale, coeff_src, range_src, coeff_dst,
+				       range_dst, 0, FIXED_1_0, FIXED_1_0);
+	if (ret < 0) {
+		blog(LOG_DEBUG, "video_scaler_create: "
+				"sws_setColorspaceDetails failed, ignoring");
+	}
+
+	return swscale;
+}
+
+static int gcd(int a, int b)
+{
+	while (b) {
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* splits the output into at most 'threads' bands.  each band (including its
+ * overlap) has exactly the same source/destination height ratio as the whole
+ * frame, so swscale places every filter tap where it would for the whole
+ * frame.  returns false if the frame can't be split without changing the
+ * output. */
+static bool create_slices(struct video_scaler *scaler,
+			  const struct video_scale_info *dst,
+			  const struct video_scale_info *src,
+			  enum video_scale_type type, uint32_t threads)
+{
+	enum AVPixelFormat format_dst = get_ffmpeg_video_format(dst->format);
+	int div = gcd(src->height, dst->height);
+	int step_src = src->height / div;
+	int step_dst = dst->height / div;
+	int unit_dst = step_dst * SLICE_ALIGN / gcd(step_dst, SLICE_ALIGN);
+	int unit_src = unit_dst / step_dst * step_src;
+	int units, margin;
+	size_t count;
+
+	/* swscale steps through the source in 16.16 fixed point, which is
+	 * only exact (and so the same for every band) when the reduced
+	 * destination height is a power of two, as with 2:1 or 3:2 */
+	if ((step_dst & (step_dst - 1)) != 0 || step_dst > FIXED_1_0)
+		return false;
+	if ((src->height | dst->height) & 1)
+		return false;
+
+	if (unit_src % 2) {
+		unit_dst *= 2;
+		unit_src *= 2;
+	}
+
+	units = dst->height / unit_dst;
+	count = (size_t)threads;
+	if ((size_t)units < count)
+		count = (size_t)units;
+	if (count < 2)
+		return false;
+
+	/* the overlap has to cover the vertical filter radius, a couple of
+	 * source rows times the downscale factor (chroma included) */
+	margin = unit_src >= SLICE_ALIGN ? unit_dst : unit_dst * 2;
+
+	scaler->slices = bzalloc(sizeof(struct scaler_slice) * count);
+	scaler->num_slices = count;
+
+	for (size_t i = 0; i < count; i++) {
+		struct scaler_slice *slice = &scaler->slices[i];
+		bool last = i == count - 1;
+		int start = (int)(units * i / count) * unit_dst;
+		int end = last ? dst->height
+			       : (int)(units * (i + 1) / count) * unit_dst;
+		int top = start < margin ? start : margin;
+		int bottom = dst->height - end;
+		int band_y, band_h, ret;
+
+		if (bottom > margin)
+			bottom = margin;
+
+		band_y = start - top;
+		band_h = end + bottom - band_y;
+
+		slice->dst_y = start;
+		slice->dst_h = end - start;
+		slice->skip = top;
+		slice->src_y = band_y / step_dst * step_src;
+		slice->src_h = band_h / step_dst * step_src;
+		if (end + bottom == dst->height)
+			slice->src_h = src->height - slice->src_y;
+
+		ret = av_image_alloc(slice->dst_pointers, slice->dst_linesizes,
+				     dst->width, band_h, format_dst, 32);
+		if (ret < 0) {
+			blog(LOG_WARNING,
+			     "video_scaler_create: av_image_alloc failed: %d",
+			     ret);
+			return false;
+		}
+
+		slice->swscale = create_swscale(dst, src, band_h,
+						slice->src_h, type);
+		if (!slice->swscale)
+			return false;
+	}
+
+	scaler->pool = os_thread_pool_create("video scaler", count - 1);
+	return true;
+}
+
+static void free_slices(struct video_scaler *scaler)
+{
+	for (size_t i = 0; i < scaler->num_slices; i++) {
+		struct scaler_slice *slice = &scaler->slices[i];
+
+		sws_freeContext(slice->swscale);
+		if (slice->dst_pointers[0])
+			av_freep(slice->dst_pointers);
+	}
+
+	os_thread_pool_destroy(scaler->pool);
+	bfree(scaler->slices);
+	scaler->pool = NULL;
+	scaler->slices = NULL;
+	scaler->num_slices = 0;
+}
+
+int video_scaler_create2(video_scaler_t **scaler_out,
+			 const struct video_scale_info *dst,
+			 const struct video_scale_info *src,
+			 enum video_scale_type type, uint32_t threads)
+{
+	enum AVPixelFormat format_src = get_ffmpeg_video_format(src->format);
+	enum AVPixelFormat format_dst = get_ffmpeg_video_format(dst->format);
 	struct video_scaler *scaler;
 	int ret;
 
@@ -168,19 +375,23 @@ int video_scaler_create(video_scaler_t **scaler_out,
 
 	scaler = bzalloc(sizeof(struct video_scaler));
 	scaler->src_height = src->height;
+	scaler->dst_height = dst->height;
 
-	const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format_dst);
-	bool has_plane[4] = {0};
-	for (size_t i = 0; i < 4; i++)
-		has_plane[desc->comp[i].plane] = 1;
-
-	scaler->dst_heights[0] = dst->height;
-	for (size_t i = 1; i < 4; ++i) {
-		if (has_plane[i]) {
-			const int s = (i == 1 || i == 2) ? desc->log2_chroma_h
-							 : 0;
-			scaler->dst_heights[i] = dst->height >> s;
-		}
+	get_plane_shifts(scaler->src_shifts, format_src);
+	get_plane_shifts(scaler->dst_shifts, format_dst);
+
+	for (size_t i = 0; i < 4; ++i) {
+		if (scaler->dst_shifts[i] >= 0)
+			scaler->dst_heights[i] =
+				dst->height >> scaler->dst_shifts[i];
+	}
+
+	if (threads > 1) {
+		if (create_slices(scaler, dst, src, type, threads))
+			goto success;
+
+		/* fall back to scaling the whole frame at once */
+		free_slices(scaler);
 	}
 
 	ret = av_image_alloc(scaler->dst_pointers, scaler->dst_linesizes,
@@ -191,35 +402,12 @@ int video_scaler_create(video_scaler_t **scaler_out,
 		goto fail;
 	}
 
-	scaler->swscale = sws_alloc_context();
-	if (!scaler->swscale) {
-		blog(LOG_ERROR, "video_scaler_create: Could not create "
-				"swscale");
-		goto fail;
-	}
-
-	av_opt_set_int(scaler->swscale, "sws_flags", scale_type, 0);
-	av_opt_set_int(scaler->swscale, "srcw", src->width, 0);
-	av_opt_set_int(scaler->swscale, "srch", src->height, 0);
-	av_opt_set_int(scaler->swscale, "dstw", dst->width, 0);
-	av_opt_set_int(scaler->swscale, "dsth", dst->height, 0);
-	av_opt_set_int(scaler->swscale, "src_format", format_src, 0);
-	av_opt_set_int(scaler->swscale, "dst_format", format_dst, 0);
-	av_opt_set_int(scaler->swscale, "src_range", range_src, 0);
-	av_opt_set_int(scaler->swscale, "dst_range", range_dst, 0);
-	if (sws_init_context(scaler->swscale, NULL, NULL) < 0) {
-		blog(LOG_ERROR, "video_scaler_create: sws_init_context failed");
+	scaler->swscale =
+		create_swscale(dst, src, dst->height, src->height, type);
+	if (!scaler->swscale)
 		goto fail;
-	}
-
-	ret = sws_setColorspaceDetails(scaler->swscale, coeff_src, range_src,
-				       coeff_dst, range_dst, 0, FIXED_1_0,
-				       FIXED_1_0);
-	if (ret < 0) {
-		blog(LOG_DEBUG, "video_scaler_create: "
-				"sws_setColorspaceDetails failed, ignoring");
-	}
 
+success:
 	*scaler_out = scaler;
 	return VIDEO_SCALER_SUCCESS;
 
@@ -228,9 +416,18 @@ fail:
 	return VIDEO_SCALER_FAILED;
 }
 
+int video_scaler_create(video_scaler_t **scaler_out,
+			const struct video_scale_info *dst,
+			const struct video_scale_info *src,
+			enum video_scale_type type)
+{
+	return video_scaler_create2(scaler_out, dst, src, type, 1);
+}
+
 void video_scaler_destroy(video_scaler_t *scaler)
 {
 	if (scaler) {
+		free_slices(scaler);
 		sws_freeContext(scaler->swscale);
 
 		if (scaler->dst_pointers[0])
@@ -240,6 +437,85 @@ void video_scaler_destroy(video_scaler_t *scaler)
 	}
 }
 
+uint32_t video_scaler_get_threads(const video_scaler_t *scaler)
+{
+	return (scaler && scaler->num_slices) ? (uint32_t)scaler->num_slices
+					      : 1;
+}
+
+static void copy_rows(uint8_t *dst, size_t dst_linesize, const uint8_t *src,
+		      size_t src_linesize, size_t height)
+{
+	if (src_linesize == dst_linesize) {
+		memcpy(dst, src, src_linesize * height);
+	} else {
+		size_t linesize = src_linesize;
+		if (linesize > dst_linesize)
+			linesize = dst_linesize;
+
+		for (size_t y = 0; y < height; y++) {
+			memcpy(dst, src, linesize);
+			dst += dst_linesize;
+			src += src_linesize;
+		}
+	}
+}
+
+struct slice_job {
+	struct video_scaler *scaler;
+	uint8_t **output;
+	const uint32_t *out_linesize;
+	const uint8_t *const *input;
+	const uint32_t *in_linesize;
+	volatile long failures;
+};
+
+static void scale_slice(void *param, size_t idx)
+{
+	struct slice_job *job = param;
+	struct video_scaler *scaler = job->scaler;
+	struct scaler_slice *slice = &scaler->slices[idx];
+	const uint8_t *input[4] = {0};
+
+	for (size_t plane = 0; plane < 4; plane++) {
+		int shift = scaler->src_shifts[plane];
+		if (shift >= 0)
+			input[plane] = job->input[plane] +
+				       (size_t)(slice->src_y >> shift) *
+					       job->in_linesize[plane];
+	}
+
+	int ret = sws_scale(slice->swscale, input,
+			    (const int *)job->in_linesize, 0, slice->src_h,
+			    slice->dst_pointers, slice->dst_linesizes);
+	if (ret <= 0) {
+		blog(LOG_ERROR, "video_scaler_scale: sws_scale failed: %d",
+		     ret);
+		os_atomic_inc_long(&job->failures);
+		return;
+	}
+
+	bool last = slice->dst_y + slice->dst_h == scaler->dst_height;
+
+	for (size_t plane = 0; plane < 4; ++plane) {
+		if (!slice->dst_pointers[plane])
+			continue;
+
+		const int shift = scaler->dst_shifts[plane];
+		const size_t scaled_linesize = slice->dst_linesizes[plane];
+		const size_t plane_linesize = job->out_linesize[plane];
+		const int end_y = slice->dst_y + slice->dst_h;
+		const size_t first = slice->dst_y >> shift;
+		const size_t end = last ? scaler->dst_heights[plane]
+					: end_y >> shift;
+		const uint8_t *src = slice->dst_pointers[plane] +
+				     (slice->skip >> shift) * scaled_linesize;
+
+		copy_rows(job->output[plane] + first * plane_linesize,
+			  plane_linesize, src, scaled_linesize, end - first);
+	}
+}
+
 bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[],
 			const uint32_t out_linesize[],
 			const uint8_t *const input[],
@@ -248,6 +524,14 @@ bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[],
 	if (!scaler)
 		return false;
 
+	if (scaler->num_slices) {
+		struct slice_job job = {scaler, output, out_linesize, input,
+					in_linesize, 0};
+		os_thread_pool_parallel_for(scaler->pool, scale_slice, &job,
+					    scaler->num_slices);
+		return job.failures == 0;
+	}
+
 	int ret = sws_scale(scaler->swscale, input, (const int *)in_linesize, 0,
 			    scaler->src_height, scaler->dst_pointers,
 			    scaler->dst_linesizes);
@@ -261,24 +545,10 @@ bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[],
 		if (!scaler->dst_pointers[plane])
 			continue;
 
-		const size_t scaled_linesize = scaler->dst_linesizes[plane];
-		const size_t plane_linesize = out_linesize[plane];
-		uint8_t *dst = output[plane];
-		const uint8_t *src = scaler->dst_pointers[plane];
-		const size_t height = scaler->dst_heights[plane];
-		if (scaled_linesize == plane_linesize) {
-			memcpy(dst, src, scaled_linesize * height);
-		} else {
-			size_t linesize = scaled_linesize;
-			if (linesize > plane_linesize)
-				linesize = plane_linesize;
-
-			for (size_t y = 0; y < height; y++) {
-				memcpy(dst, src, linesize);
-				dst += plane_linesize;
-				src += scaled_linesize;
-			}
-		}
+		copy_rows(output[plane], out_linesize[plane],
+			  scaler->dst_pointers[plane],
+			  scaler->dst_linesizes[plane],
+			  scaler->dst_heights[plane]);
 	}
 
 	return true;
@@ -35,8 +35,23 @@ EXPORT int video_scaler_create(video_scaler_t **scaler,
 			       const struct video_scale_info *dst,
 			       const struct video_scale_info *src,
 			       enum video_scale_type type);
+
+/**
+ * Creates a scaler that splits every frame into up to 'threads' horizontal
+ * bands and scales them concurrently.  Bands overlap by enough rows for the
+ * filter, so the output is the same as scaling the whole frame at once.
+ * Frames that can't be split that many ways use fewer threads, 0 or 1
+ * threads is the same as video_scaler_create.
+ */
+EXPORT int video_scaler_create2(video_scaler_t **scaler,
+				const struct video_scale_info *dst,
+				const struct video_scale_info *src,
+				enum video_scale_type type, uint32_t threads);
 EXPORT void video_scaler_destroy(video_scaler_t *scaler);
 
+/** Returns the number of bands each frame is scaled in */
+EXPORT uint32_t video_scaler_get_threads(const video_scaler_t *scaler);
+
 EXPORT bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[],
 			       const uint32_t out_linesize[],
 			       const uint8_t *const input[],
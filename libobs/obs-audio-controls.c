@@ -21,6 +21,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "util/threading.h"
 #include "util/bmem.h"
+#include "util/deque.h"
+#include "util/platform.h"
 #include "media-io/audio-math.h"
 #include "obs.h"
 #include "obs-internal.h"
@@ -36,6 +38,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define CLAMP(x, min, max) ((x) < min ? min : ((x) > max ? max : (x)))
 
+/* roughly one audio tick, which is how often meters used to update */
+#define VOLMETER_DEFAULT_UPDATE_MS 20
+#define VOLMETER_MAX_WAIT_MS 100
+/* audio kept for a meter if its updates fall behind */
+#define VOLMETER_MAX_BUFFER_MS 1000
+
 typedef float (*obs_fader_conversion_t)(const float val);
 
 struct fader_cb {
@@ -74,12 +82,43 @@ struct obs_volmeter {
 
 	enum obs_peak_meter_type peak_meter_type;
 	unsigned int update_ms;
+
+	/* filled on the audio thread, drained by the metering thread */
+	struct deque ring[MAX_AUDIO_CHANNELS];
+	int ring_channels;
+	bool muted;
+
+	/* only used by the metering thread */
+	uint64_t next_update_ts;
 	float prev_samples[MAX_AUDIO_CHANNELS][4];
 
 	float magnitude[MAX_AUDIO_CHANNELS];
 	float peak[MAX_AUDIO_CHANNELS];
 };
 
+/* All volume meters are processed by a single thread, so the audio thread
+ * only has to copy their audio.  It runs while any volume meter exists. */
+struct volmeter_engine {
+	DARRAY(struct obs_volmeter *) meters;
+	os_event_t *stop_event;
+	pthread_t thread;
+	bool active;
+};
+
+/* levels computed under the engine mutex, emitted after it is released */
+struct volmeter_levels {
+	struct obs_volmeter *volmeter;
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float peak[MAX_AUDIO_CHANNELS];
+	float input_peak[MAX_AUDIO_CHANNELS];
+};
+
+static pthread_mutex_t engine_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* held by the metering thread while it calls the callbacks of a volume
+ * meter, always taken before the engine mutex */
+static pthread_mutex_t engine_signal_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct volmeter_engine engine;
+
 static float cubic_def_to_db(const float def)
 {
 	if (def == 1.0f)
@@ -519,38 +558,278 @@ static void volmeter_process_audio_data(obs_volmeter_t *volmeter,
 	volmeter_process_magnitude(volmeter, data, nr_channels);
 }
 
+static inline void volmeter_clear_ring(struct obs_volmeter *volmeter)
+{
+	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		deque_free(&volmeter->ring[i]);
+	volmeter->ring_channels = 0;
+}
+
 static void volmeter_source_data_received(void *vptr, obs_source_t *source,
 					  const struct audio_data *data,
 					  bool muted)
 {
 	struct obs_volmeter *volmeter = (struct obs_volmeter *)vptr;
+	int nr_channels = get_nr_channels_from_audio_data(data);
+	size_t size = data->frames * sizeof(float);
+	size_t max_size = sizeof(float) * VOLMETER_MAX_BUFFER_MS *
+			  audio_output_get_sample_rate(obs_get_audio()) / 1000;
+
+	muted = muted && !obs_source_muted(source);
+
+	pthread_mutex_lock(&volmeter->mutex);
+
+	if (volmeter->ring_channels != nr_channels) {
+		volmeter_clear_ring(volmeter);
+		volmeter->ring_channels = nr_channels;
+	}
+
+	int channel_nr = 0;
+	for (int plane_nr = 0; channel_nr < nr_channels; plane_nr++) {
+		struct deque *ring = &volmeter->ring[channel_nr];
+		if (!data->data[plane_nr])
+			continue;
+
+		deque_push_back(ring, data->data[plane_nr], size);
+		if (ring->size > max_size)
+			deque_pop_front(ring, NULL, ring->size - max_size);
+
+		channel_nr++;
+	}
+
+	volmeter->muted = muted;
+
+	pthread_mutex_unlock(&volmeter->mutex);
+}
+
+/* Processes the audio a volume meter received since its last update and
+ * computes its levels, *updated is set if there were any.  Returns the
+ * update interval of the volume meter. */
+static unsigned int volmeter_update(struct obs_volmeter *volmeter,
+				    struct volmeter_levels *levels,
+				    bool *updated,
+				    float *scratch[MAX_AUDIO_CHANNELS],
+				    size_t *scratch_frames)
+{
+	struct audio_data data = {0};
+	unsigned int update_ms;
 	float mul;
-	float magnitude[MAX_AUDIO_CHANNELS];
-	float peak[MAX_AUDIO_CHANNELS];
-	float input_peak[MAX_AUDIO_CHANNELS];
+
+	*updated = false;
 
 	pthread_mutex_lock(&volmeter->mutex);
 
-	volmeter_process_audio_data(volmeter, data);
+	update_ms = volmeter->update_ms ? volmeter->update_ms
+					: VOLMETER_DEFAULT_UPDATE_MS;
+
+	/* peaks are measured in sets of 4 samples, the rest is left for the
+	 * next update */
+	size_t frames = volmeter->ring[0].size / sizeof(float) & ~(size_t)3;
+	if (!volmeter->ring_channels || !frames) {
+		pthread_mutex_unlock(&volmeter->mutex);
+		return update_ms;
+	}
+
+	if (frames > *scratch_frames) {
+		for (int i = 0; i < MAX_AUDIO_CHANNELS; i++)
+			scratch[i] = brealloc(scratch[i],
+					      frames * sizeof(float));
+		*scratch_frames = frames;
+	}
+
+	for (int i = 0; i < volmeter->ring_channels; i++) {
+		deque_pop_front(&volmeter->ring[i], scratch[i],
+				frames * sizeof(float));
+		data.data[i] = (uint8_t *)scratch[i];
+	}
+	data.frames = (uint32_t)frames;
 
 	// Adjust magnitude/peak based on the volume level set by the user.
 	// And convert to dB.
-	mul = muted && !obs_source_muted(source) ? 0.0f
-						 : db_to_mul(volmeter->cur_db);
+	mul = volmeter->muted ? 0.0f : db_to_mul(volmeter->cur_db);
+
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	volmeter_process_audio_data(volmeter, &data);
+
+	levels->volmeter = volmeter;
+
 	for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS;
 	     channel_nr++) {
-		magnitude[channel_nr] =
+		levels->magnitude[channel_nr] =
 			mul_to_db(volmeter->magnitude[channel_nr] * mul);
-		peak[channel_nr] = mul_to_db(volmeter->peak[channel_nr] * mul);
+		levels->peak[channel_nr] =
+			mul_to_db(volmeter->peak[channel_nr] * mul);
 
 		/* The input-peak is NOT adjusted with volume, so that the user
 		 * can check the input-gain. */
-		input_peak[channel_nr] = mul_to_db(volmeter->peak[channel_nr]);
+		levels->input_peak[channel_nr] =
+			mul_to_db(volmeter->peak[channel_nr]);
 	}
 
-	pthread_mutex_unlock(&volmeter->mutex);
+	*updated = true;
+	return update_ms;
+}
+
+/* Calls the callbacks without holding the engine mutex, so callbacks can't
+ * stall the other volume meters or volume meter creation/destruction.  A
+ * volume meter removed in the meantime is skipped, removal waits for the
+ * signal mutex so a volume meter is never destroyed while signalled. */
+static void volmeter_signal_levels(const struct volmeter_levels *levels)
+{
+	bool valid;
+
+	pthread_mutex_lock(&engine_signal_mutex);
+
+	pthread_mutex_lock(&engine_mutex);
+	valid = da_find(engine.meters, &levels->volmeter, 0) !=
+		DARRAY_INVALID;
+	pthread_mutex_unlock(&engine_mutex);
+
+	if (valid)
+		signal_levels_updated(levels->volmeter, levels->magnitude,
+				      levels->peak, levels->input_peak);
+
+	pthread_mutex_unlock(&engine_signal_mutex);
+}
+
+static void *volmeter_thread(void *param)
+{
+	os_event_t *stop_event = param;
+	float *scratch[MAX_AUDIO_CHANNELS] = {0};
+	size_t scratch_frames = 0;
+	unsigned long wait_ms = VOLMETER_DEFAULT_UPDATE_MS;
+	DARRAY(struct volmeter_levels) levels;
+
+	da_init(levels);
+
+	os_set_thread_name("libobs: volume meters");
+	/* metering is for display only, it must never compete with the
+	 * audio/video/output threads */
+	os_set_thread_priority(OS_THREAD_PRIORITY_BELOW_NORMAL);
+
+	while (os_event_timedwait(stop_event, wait_ms) == ETIMEDOUT) {
+		uint64_t now = os_gettime_ns();
+		uint64_t next = now + VOLMETER_MAX_WAIT_MS * 1000000ULL;
+
+		pthread_mutex_lock(&engine_mutex);
+
+		da_resize(levels, engine.meters.num);
+		size_t num_levels = 0;
+
+		for (size_t i = 0; i < engine.meters.num; i++) {
+			struct obs_volmeter *volmeter = engine.meters.array[i];
+
+			if (now >= volmeter->next_update_ts) {
+				bool updated;
+				unsigned int ms = volmeter_update(
+					volmeter, &levels.array[num_levels],
+					&updated, scratch, &scratch_frames);
+				volmeter->next_update_ts =
+					now + ms * 1000000ULL;
+				if (updated)
+					num_levels++;
+			}
+
+			if (volmeter->next_update_ts < next)
+				next = volmeter->next_update_ts;
+		}
+
+		pthread_mutex_unlock(&engine_mutex);
+
+		for (size_t i = 0; i < num_levels; i++)
+			volmeter_signal_levels(&levels.array[i]);
+
+		now = os_gettime_ns();
+		wait_ms = next > now ? (unsigned long)((next - now) / 1000000)
+				     : 0;
+		if (!wait_ms)
+			wait_ms = 1;
+	}
+
+	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		bfree(scratch[i]);
+	da_free(levels);
+
+	/* the thread owns its stop event, it may have been detached */
+	os_event_destroy(stop_event);
+	return NULL;
+}
+
+static bool volmeter_engine_add(struct obs_volmeter *volmeter)
+{
+	bool success = true;
+
+	pthread_mutex_lock(&engine_mutex);
 
-	signal_levels_updated(volmeter, magnitude, peak, input_peak);
+	if (!engine.active) {
+		if (os_event_init(&engine.stop_event, OS_EVENT_TYPE_MANUAL) !=
+		    0) {
+			success = false;
+			goto unlock;
+		}
+		if (pthread_create(&engine.thread, NULL, volmeter_thread,
+				   engine.stop_event) != 0) {
+			os_event_destroy(engine.stop_event);
+			success = false;
+			goto unlock;
+		}
+		engine.active = true;
+	}
+
+	da_push_back(engine.meters, &volmeter);
+
+unlock:
+	pthread_mutex_unlock(&engine_mutex);
+	return success;
+}
+
+static void volmeter_engine_remove(struct obs_volmeter *volmeter)
+{
+	os_event_t *stop_event = NULL;
+	pthread_t thread;
+	bool engine_thread;
+
+	/* once this returns the metering thread no longer uses the volume
+	 * meter, it holds the engine mutex while processing and the signal
+	 * mutex while calling its callbacks */
+	pthread_mutex_lock(&engine_mutex);
+
+	size_t idx = da_find(engine.meters, &volmeter, 0);
+	if (idx == DARRAY_INVALID) {
+		pthread_mutex_unlock(&engine_mutex);
+		return;
+	}
+
+	engine_thread = pthread_equal(engine.thread, pthread_self());
+
+	da_erase(engine.meters, idx);
+
+	if (!engine.meters.num) {
+		da_free(engine.meters);
+		stop_event = engine.stop_event;
+		thread = engine.thread;
+		engine.stop_event = NULL;
+		engine.active = false;
+	}
+
+	pthread_mutex_unlock(&engine_mutex);
+
+	/* a callback removing a volume meter already holds the signal mutex */
+	if (!engine_thread) {
+		pthread_mutex_lock(&engine_signal_mutex);
+		pthread_mutex_unlock(&engine_signal_mutex);
+	}
+
+	/* the metering thread can't join itself when a callback removes the
+	 * last volume meter, it exits once the callback returns */
+	if (stop_event) {
+		os_event_signal(stop_event);
+		if (engine_thread)
+			pthread_detach(thread);
+		else
+			pthread_join(thread, NULL);
+	}
 }
 
 obs_fader_t *obs_fader_create(enum obs_fader_type type)
@@ -782,6 +1061,9 @@ obs_volmeter_t *obs_volmeter_create(enum obs_fader_type type)
 
 	volmeter->type = type;
 
+	if (!volmeter_engine_add(volmeter))
+		goto fail;
+
 	return volmeter;
 fail:
 	obs_volmeter_destroy(volmeter);
@@ -794,6 +1076,8 @@ void obs_volmeter_destroy(obs_volmeter_t *volmeter)
 		return;
 
 	obs_volmeter_detach_source(volmeter);
+	volmeter_engine_remove(volmeter);
+	volmeter_clear_ring(volmeter);
 	da_free(volmeter->callbacks);
 	pthread_mutex_destroy(&volmeter->callback_mutex);
 	pthread_mutex_destroy(&volmeter->mutex);
@@ -853,6 +1137,10 @@ void obs_volmeter_detach_source(obs_volmeter_t *volmeter)
 				  volmeter);
 	obs_source_remove_audio_capture_callback(
 		source, volmeter_source_data_received, volmeter);
+
+	pthread_mutex_lock(&volmeter->mutex);
+	volmeter_clear_ring(volmeter);
+	pthread_mutex_unlock(&volmeter->mutex);
 }
 
 void obs_volmeter_set_peak_meter_type(obs_volmeter_t *volmeter,
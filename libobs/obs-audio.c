@@ -37,7 +37,16 @@ static void push_audio_tree(obs_source_t *parent, obs_source_t *source, void *p)
 			da_push_back(audio->render_order, &s);
 	}
 
-	UNUSED_PARAMETER(parent);
+	/* the tree is enumerated children first, so the level of the child
+	 * is already final here.  parents always render after children. */
+	if (parent) {
+		int level = source->audio_render_level + 1;
+
+		if (parent->audio_render_level < level)
+			parent->audio_render_level = level;
+		if (audio->max_render_level < level)
+			audio->max_render_level = level;
+	}
 }
 
 static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
@@ -46,10 +55,11 @@ static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
 }
 
 static inline void mix_audio(struct audio_output_data *mixes,
-			     obs_source_t *source, size_t channels,
-			     size_t sample_rate, struct ts_info *ts)
+			     obs_source_t *source, uint32_t mixers,
+			     size_t channels, size_t sample_rate,
+			     struct ts_info *ts)
 {
-	size_t total_floats = AUDIO_OUTPUT_FRAMES;
+	size_t total_floats = obs->audio.frames_per_tick;
 	size_t start_point = 0;
 
 	if (source->audio_ts < ts->start || ts->end <= source->audio_ts)
@@ -58,24 +68,29 @@ static inline void mix_audio(struct audio_output_data *mixes,
 	if (source->audio_ts != ts->start) {
 		start_point = convert_time_to_frames(
 			sample_rate, source->audio_ts - ts->start);
-		if (start_point == AUDIO_OUTPUT_FRAMES)
+		if (start_point == obs->audio.frames_per_tick)
 			return;
 
 		total_floats -= start_point;
 	}
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		for (size_t ch = 0; ch < channels; ch++) {
-			register float *mix = mixes[mix_idx].data[ch];
-			register float *aud =
-				source->audio_output_buf[mix_idx][ch];
-			register float *end;
+		/* no outputs on this mix, nothing to mix into */
+		if ((mixers & (1 << mix_idx)) == 0)
+			continue;
 
-			mix += start_point;
-			end = aud + total_floats;
+		if ((source->audio_silent_mixes & (1 << mix_idx)) != 0) {
+			obs->audio.silent_blocks_skipped++;
+			continue;
+		}
+
+		mixes[mix_idx].silent = false;
 
-			while (aud < end)
-				*(mix++) += *(aud++);
+		for (size_t ch = 0; ch < channels; ch++) {
+			float *mix = mixes[mix_idx].data[ch] + start_point;
+			float *aud = source->audio_output_buf[mix_idx][ch];
+
+			obs->audio.kernels->mix(mix, aud, total_floats);
 		}
 	}
 }
@@ -192,16 +207,12 @@ static bool discard_if_stopped(obs_source_t *source, size_t channels)
 	}
 }
 
-#define MAX_AUDIO_SIZE (AUDIO_OUTPUT_FRAMES * sizeof(float))
-
 static inline void discard_audio(struct obs_core_audio *audio,
 				 obs_source_t *source, size_t channels,
 				 size_t sample_rate, struct ts_info *ts)
 {
-	size_t total_floats = AUDIO_OUTPUT_FRAMES;
+	size_t total_floats = audio->frames_per_tick;
 	size_t size;
-	/* debug assert only */
-	UNUSED_PARAMETER(audio);
 
 #if DEBUG_AUDIO == 1
 	bool is_audio_source = source->info.output_flags & OBS_SOURCE_AUDIO;
@@ -225,7 +236,8 @@ static inline void discard_audio(struct obs_core_audio *audio,
 
 	if (source->audio_ts < (ts->start - 1)) {
 		if (source->audio_pending &&
-		    source->audio_input_buf[0].size < MAX_AUDIO_SIZE &&
+		    source->audio_input_buf[0].size <
+			    audio->frames_per_tick * sizeof(float) &&
 		    discard_if_stopped(source, channels))
 			return;
 
@@ -252,7 +264,7 @@ static inline void discard_audio(struct obs_core_audio *audio,
 	    source->audio_ts != (ts->start - 1)) {
 		size_t start_point = convert_time_to_frames(
 			sample_rate, source->audio_ts - ts->start);
-		if (start_point == AUDIO_OUTPUT_FRAMES) {
+		if (start_point == audio->frames_per_tick) {
 #if DEBUG_AUDIO == 1
 			if (is_audio_source)
 				blog(LOG_DEBUG, "can't discard, start point is "
@@ -313,8 +325,8 @@ static void set_fixed_audio_buffering(struct obs_core_audio *audio,
 	ticks = audio->max_buffering_ticks - audio->total_buffering_ticks;
 	audio->total_buffering_ticks += ticks;
 
-	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 /
-		   sample_rate;
+	total_ms = audio->total_buffering_ticks * audio->frames_per_tick *
+		   1000 / sample_rate;
 
 	blog(LOG_INFO,
 	     "Enabling fixed audio buffering, total "
@@ -324,7 +336,7 @@ static void set_fixed_audio_buffering(struct obs_core_audio *audio,
 	new_ts.start =
 		audio->buffered_ts -
 		audio_frames_to_ns(sample_rate, audio->buffering_wait_ticks *
-							AUDIO_OUTPUT_FRAMES);
+							audio->frames_per_tick);
 
 	while (ticks--) {
 		const uint64_t cur_ticks = ++audio->buffering_wait_ticks;
@@ -333,7 +345,7 @@ static void set_fixed_audio_buffering(struct obs_core_audio *audio,
 		new_ts.start =
 			audio->buffered_ts -
 			audio_frames_to_ns(sample_rate,
-					   cur_ticks * AUDIO_OUTPUT_FRAMES);
+					   cur_ticks * audio->frames_per_tick);
 
 #if DEBUG_AUDIO == 1
 		blog(LOG_DEBUG, "add buffered ts: %" PRIu64 "-%" PRIu64,
@@ -347,9 +359,22 @@ static void set_fixed_audio_buffering(struct obs_core_audio *audio,
 	*ts = new_ts;
 }
 
+static void signal_audio_buffering(obs_source_t *source, size_t ms,
+				   size_t total_ms)
+{
+	struct calldata data;
+	uint8_t stack[128];
+
+	calldata_init_fixed(&data, stack, sizeof(stack));
+	calldata_set_ptr(&data, "source", source);
+	calldata_set_int(&data, "added_ms", (long long)ms);
+	calldata_set_int(&data, "total_ms", (long long)total_ms);
+	signal_handler_signal(obs->signals, "audio_buffering", &data);
+}
+
 static void add_audio_buffering(struct obs_core_audio *audio,
 				size_t sample_rate, struct ts_info *ts,
-				uint64_t min_ts, const char *buffering_name)
+				uint64_t min_ts, obs_source_t *buffering_source)
 {
 	struct ts_info new_ts;
 	uint64_t offset;
@@ -366,7 +391,8 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 
 	offset = ts->start - min_ts;
 	frames = ns_to_audio_frames(sample_rate, offset);
-	ticks = (int)((frames + AUDIO_OUTPUT_FRAMES - 1) / AUDIO_OUTPUT_FRAMES);
+	ticks = (int)((frames + audio->frames_per_tick - 1) /
+		      audio->frames_per_tick);
 
 	audio->total_buffering_ticks += ticks;
 
@@ -377,15 +403,24 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 		blog(LOG_WARNING, "Max audio buffering reached!");
 	}
 
-	ms = ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
-	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 /
-		   sample_rate;
+	ms = ticks * audio->frames_per_tick * 1000 / sample_rate;
+	total_ms = audio->total_buffering_ticks * audio->frames_per_tick *
+		   1000 / sample_rate;
+
+	audio->buffering_increases++;
+	if (buffering_source) {
+		buffering_source->audio_buffering_increases++;
+		buffering_source->audio_buffering_added += audio_frames_to_ns(
+			sample_rate, (uint64_t)ticks * audio->frames_per_tick);
+	}
 
 	blog(LOG_INFO,
 	     "adding %d milliseconds of audio buffering, total "
 	     "audio buffering is now %d milliseconds"
 	     " (source: %s)\n",
-	     (int)ms, (int)total_ms, buffering_name);
+	     (int)ms, (int)total_ms,
+	     buffering_source ? buffering_source->context.name : NULL);
+	signal_audio_buffering(buffering_source, ms, total_ms);
 #if DEBUG_AUDIO == 1
 	blog(LOG_DEBUG,
 	     "min_ts (%" PRIu64 ") < start timestamp "
@@ -398,7 +433,7 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 	new_ts.start =
 		audio->buffered_ts -
 		audio_frames_to_ns(sample_rate, audio->buffering_wait_ticks *
-							AUDIO_OUTPUT_FRAMES);
+							audio->frames_per_tick);
 
 	while (ticks--) {
 		const uint64_t cur_ticks = ++audio->buffering_wait_ticks;
@@ -407,7 +442,7 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 		new_ts.start =
 			audio->buffered_ts -
 			audio_frames_to_ns(sample_rate,
-					   cur_ticks * AUDIO_OUTPUT_FRAMES);
+					   cur_ticks * audio->frames_per_tick);
 
 #if DEBUG_AUDIO == 1
 		blog(LOG_DEBUG, "add buffered ts: %" PRIu64 "-%" PRIu64,
@@ -424,7 +459,7 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 static bool audio_buffer_insufficient(struct obs_source *source,
 				      size_t sample_rate, uint64_t min_ts)
 {
-	size_t total_floats = AUDIO_OUTPUT_FRAMES;
+	size_t total_floats = obs->audio.frames_per_tick;
 	size_t size;
 
 	if (source->info.audio_render || source->audio_pending ||
@@ -435,7 +470,7 @@ static bool audio_buffer_insufficient(struct obs_source *source,
 	if (source->audio_ts != min_ts && source->audio_ts != (min_ts - 1)) {
 		size_t start_point = convert_time_to_frames(
 			sample_rate, source->audio_ts - min_ts);
-		if (start_point >= AUDIO_OUTPUT_FRAMES)
+		if (start_point >= obs->audio.frames_per_tick)
 			return false;
 
 		total_floats -= start_point;
@@ -451,51 +486,211 @@ static bool audio_buffer_insufficient(struct obs_source *source,
 	return false;
 }
 
-static inline const char *find_min_ts(struct obs_core_data *data,
-				      uint64_t *min_ts)
+static inline obs_source_t *find_min_ts(struct obs_core_audio *audio,
+					uint64_t *min_ts)
 {
 	obs_source_t *buffering_source = NULL;
-	struct obs_source *source = data->first_audio_source;
-	while (source) {
+	for (size_t i = 0; i < audio->audio_sources.num; i++) {
+		struct obs_source *source = audio->audio_sources.array[i];
+
+		/* late jitter buffered sources grow their own delay instead */
+		if (source->jitter_max)
+			continue;
+
 		if (!source->audio_pending && source->audio_ts &&
 		    source->audio_ts < *min_ts) {
 			*min_ts = source->audio_ts;
 			buffering_source = source;
 		}
-
-		source = (struct obs_source *)source->next_audio_source;
 	}
-	return buffering_source ? obs_source_get_name(buffering_source) : NULL;
+	return buffering_source;
 }
 
-static inline bool mark_invalid_sources(struct obs_core_data *data,
+static inline bool mark_invalid_sources(struct obs_core_audio *audio,
 					size_t sample_rate, uint64_t min_ts)
 {
 	bool recalculate = false;
 
-	struct obs_source *source = data->first_audio_source;
-	while (source) {
+	for (size_t i = 0; i < audio->audio_sources.num; i++) {
+		struct obs_source *source = audio->audio_sources.array[i];
 		recalculate |=
 			audio_buffer_insufficient(source, sample_rate, min_ts);
-		source = (struct obs_source *)source->next_audio_source;
 	}
 
 	return recalculate;
 }
 
-static inline const char *calc_min_ts(struct obs_core_data *data,
-				      size_t sample_rate, uint64_t *min_ts)
+static inline obs_source_t *calc_min_ts(struct obs_core_audio *audio,
+					size_t sample_rate, uint64_t *min_ts)
+{
+	obs_source_t *buffering_source = find_min_ts(audio, min_ts);
+	if (mark_invalid_sources(audio, sample_rate, *min_ts))
+		buffering_source = find_min_ts(audio, min_ts);
+	return buffering_source;
+}
+
+void audio_source_snapshot_free(struct audio_source_snapshot *snapshot)
+{
+	if (!snapshot)
+		return;
+
+	for (size_t i = 0; i < snapshot->sources.num; i++)
+		obs_weak_source_release(snapshot->sources.array[i]);
+	da_free(snapshot->sources);
+	bfree(snapshot);
+}
+
+/* only flags the audio source list as changed, the audio thread rebuilds
+ * its snapshot at most once per tick no matter how many sources were added
+ * or removed in the meantime */
+void obs_audio_sources_changed(void)
+{
+	os_atomic_set_bool(&obs->data.audio_sources_changed, true);
+}
+
+static struct audio_source_snapshot *
+create_audio_source_snapshot(struct obs_core_data *data)
+{
+	struct audio_source_snapshot *snapshot;
+	struct obs_source *source;
+
+	snapshot = bzalloc(sizeof(*snapshot));
+
+	source = data->first_audio_source;
+	while (source) {
+		obs_weak_source_t *weak = obs_source_get_weak_source(source);
+		da_push_back(snapshot->sources, &weak);
+		source = (struct obs_source *)source->next_audio_source;
+	}
+
+	return snapshot;
+}
+
+/* rebuilds the snapshot if the audio source list changed, without ever
+ * blocking on the threads that add or remove sources (if the list is busy
+ * the previous snapshot is used for one more tick), then references its
+ * sources for this tick.  sources that are already being destroyed are
+ * skipped. */
+static void get_audio_sources(struct obs_core_audio *audio)
 {
-	const char *buffering_name = find_min_ts(data, min_ts);
-	if (mark_invalid_sources(data, sample_rate, *min_ts))
-		buffering_name = find_min_ts(data, min_ts);
-	return buffering_name;
+	struct obs_core_data *data = &obs->data;
+	struct audio_source_snapshot *snapshot;
+
+	if (os_atomic_load_bool(&data->audio_sources_changed) &&
+	    pthread_mutex_trylock(&data->audio_sources_mutex) == 0) {
+		os_atomic_set_bool(&data->audio_sources_changed, false);
+		snapshot = create_audio_source_snapshot(data);
+		pthread_mutex_unlock(&data->audio_sources_mutex);
+
+		audio_source_snapshot_free(audio->source_snapshot);
+		audio->source_snapshot = snapshot;
+	}
+
+	da_resize(audio->audio_sources, 0);
+
+	snapshot = audio->source_snapshot;
+	if (!snapshot)
+		return;
+
+	for (size_t i = 0; i < snapshot->sources.num; i++) {
+		obs_source_t *source =
+			obs_weak_source_get_source(snapshot->sources.array[i]);
+		if (source)
+			da_push_back(audio->audio_sources, &source);
+	}
 }
 
 static inline void release_audio_sources(struct obs_core_audio *audio)
 {
-	for (size_t i = 0; i < audio->render_order.num; i++)
-		obs_source_release(audio->render_order.array[i]);
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+		source->audio_render_level = 0;
+		obs_source_release(source);
+	}
+
+	for (size_t i = 0; i < audio->audio_sources.num; i++)
+		obs_source_release(audio->audio_sources.array[i]);
+}
+
+struct audio_render_info {
+	struct obs_core_audio *audio;
+	obs_source_t **sources;
+	uint32_t mixers;
+	size_t channels;
+	size_t sample_rate;
+	size_t audio_size;
+	uint64_t start_ts;
+};
+
+static void render_audio_source(struct audio_render_info *info,
+				obs_source_t *source)
+{
+	obs_source_audio_render(source, info->mixers, info->channels,
+				info->sample_rate, info->audio_size);
+
+	/* if a source has gone backward in time and we can no
+	 * longer buffer (or it has its own jitter buffer), drop some or all
+	 * of its audio */
+	if ((audio_buffering_maxed(info->audio) || source->jitter_max) &&
+	    source->audio_ts != 0 && source->audio_ts < info->start_ts) {
+		if (source->info.audio_render) {
+			blog(LOG_DEBUG,
+			     "render audio source %s timestamp has "
+			     "gone backwards",
+			     obs_source_get_name(source));
+
+			/* just avoid further damage */
+			source->audio_pending = true;
+#if DEBUG_AUDIO == 1
+			/* this should really be fixed */
+			assert(false);
+#endif
+		} else {
+			pthread_mutex_lock(&source->audio_buf_mutex);
+			bool rerender =
+				ignore_audio(source, info->channels,
+					     info->sample_rate, info->start_ts);
+			pthread_mutex_unlock(&source->audio_buf_mutex);
+
+			/* if we (potentially) recovered, re-render */
+			if (rerender)
+				obs_source_audio_render(source, info->mixers,
+							info->channels,
+							info->sample_rate,
+							info->audio_size);
+		}
+	}
+}
+
+static void render_audio_batch_job(void *param, size_t idx)
+{
+	struct audio_render_info *info = param;
+	render_audio_source(info, info->sources[idx]);
+}
+
+static void render_audio_sources(struct obs_core_audio *audio,
+				 struct audio_render_info *info)
+{
+	if (!audio->render_pool || audio->render_order.num < 2) {
+		for (size_t i = 0; i < audio->render_order.num; i++)
+			render_audio_source(info, audio->render_order.array[i]);
+		return;
+	}
+
+	for (int level = 0; level <= audio->max_render_level; level++) {
+		da_resize(audio->render_batch, 0);
+
+		for (size_t i = 0; i < audio->render_order.num; i++) {
+			obs_source_t *source = audio->render_order.array[i];
+			if (source->audio_render_level == level)
+				da_push_back(audio->render_batch, &source);
+		}
+
+		info->sources = audio->render_batch.array;
+		os_thread_pool_parallel_for(audio->render_pool,
+					    render_audio_batch_job, info,
+					    audio->render_batch.num);
+	}
 }
 
 static inline void execute_audio_tasks(void)
@@ -515,13 +710,16 @@ static inline void execute_audio_tasks(void)
 	}
 }
 
+static const char *render_audio_sources_name = "render_audio_sources";
+static const char *add_audio_buffering_name = "add_audio_buffering";
+static const char *mix_audio_name = "mix_audio";
+static const char *discard_audio_name = "discard_audio";
+
 bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 		    uint64_t *out_ts, uint32_t mixers,
 		    struct audio_output_data *mixes)
 {
-	struct obs_core_data *data = &obs->data;
 	struct obs_core_audio *audio = &obs->audio;
-	struct obs_source *source;
 	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
 	size_t channels = audio_output_get_channels(audio->audio);
 	struct ts_info ts = {start_ts_in, end_ts_in};
@@ -530,12 +728,13 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 
 	da_resize(audio->render_order, 0);
 	da_resize(audio->root_nodes, 0);
+	audio->max_render_level = 0;
 
 	deque_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
 	deque_peek_front(&audio->buffered_timestamps, &ts, sizeof(ts));
 	min_ts = ts.start;
 
-	audio_size = AUDIO_OUTPUT_FRAMES * sizeof(float);
+	audio_size = audio->frames_per_tick * sizeof(float);
 
 #if DEBUG_AUDIO == 1
 	blog(LOG_DEBUG, "ts %llu-%llu", ts.start, ts.end);
@@ -571,61 +770,29 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	}
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 
-	pthread_mutex_lock(&data->audio_sources_mutex);
-
-	source = data->first_audio_source;
-	while (source) {
-		push_audio_tree(NULL, source, audio);
-		source = (struct obs_source *)source->next_audio_source;
-	}
+	get_audio_sources(audio);
 
-	pthread_mutex_unlock(&data->audio_sources_mutex);
+	for (size_t i = 0; i < audio->audio_sources.num; i++)
+		push_audio_tree(NULL, audio->audio_sources.array[i], audio);
 
 	/* ------------------------------------------------ */
 	/* render audio data */
-	for (size_t i = 0; i < audio->render_order.num; i++) {
-		obs_source_t *source = audio->render_order.array[i];
-		obs_source_audio_render(source, mixers, channels, sample_rate,
-					audio_size);
-
-		/* if a source has gone backward in time and we can no
-		 * longer buffer, drop some or all of its audio */
-		if (audio_buffering_maxed(audio) && source->audio_ts != 0 &&
-		    source->audio_ts < ts.start) {
-			if (source->info.audio_render) {
-				blog(LOG_DEBUG,
-				     "render audio source %s timestamp has "
-				     "gone backwards",
-				     obs_source_get_name(source));
-
-				/* just avoid further damage */
-				source->audio_pending = true;
-#if DEBUG_AUDIO == 1
-				/* this should really be fixed */
-				assert(false);
-#endif
-			} else {
-				pthread_mutex_lock(&source->audio_buf_mutex);
-				bool rerender = ignore_audio(source, channels,
-							     sample_rate,
-							     ts.start);
-				pthread_mutex_unlock(&source->audio_buf_mutex);
-
-				/* if we (potentially) recovered, re-render */
-				if (rerender)
-					obs_source_audio_render(source, mixers,
-								channels,
-								sample_rate,
-								audio_size);
-			}
-		}
-	}
+	struct audio_render_info render_info = {
+		.audio = audio,
+		.mixers = mixers,
+		.channels = channels,
+		.sample_rate = sample_rate,
+		.audio_size = audio_size,
+		.start_ts = ts.start,
+	};
+	profile_start(render_audio_sources_name);
+	render_audio_sources(audio, &render_info);
+	profile_end(render_audio_sources_name);
 
 	/* ------------------------------------------------ */
 	/* get minimum audio timestamp */
-	pthread_mutex_lock(&data->audio_sources_mutex);
-	const char *buffering_name = calc_min_ts(data, sample_rate, &min_ts);
-	pthread_mutex_unlock(&data->audio_sources_mutex);
+	obs_source_t *buffering_source =
+		calc_min_ts(audio, sample_rate, &min_ts);
 
 	/* ------------------------------------------------ */
 	/* if a source has gone backward in time, buffer    */
@@ -634,12 +801,17 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 			set_fixed_audio_buffering(audio, sample_rate, &ts);
 		}
 	} else if (min_ts < ts.start) {
+		/* only entered when buffering increases, so its call count in
+		 * the profiler is the number of increases */
+		profile_start(add_audio_buffering_name);
 		add_audio_buffering(audio, sample_rate, &ts, min_ts,
-				    buffering_name);
+				    buffering_source);
+		profile_end(add_audio_buffering_name);
 	}
 
 	/* ------------------------------------------------ */
 	/* mix audio */
+	profile_start(mix_audio_name);
 	if (!audio->buffering_wait_ticks) {
 		for (size_t i = 0; i < audio->root_nodes.num; i++) {
 			obs_source_t *source = audio->root_nodes.array[i];
@@ -650,27 +822,25 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 			pthread_mutex_lock(&source->audio_buf_mutex);
 
 			if (source->audio_output_buf[0][0] && source->audio_ts)
-				mix_audio(mixes, source, channels, sample_rate,
-					  &ts);
+				mix_audio(mixes, source, mixers, channels,
+					  sample_rate, &ts);
 
 			pthread_mutex_unlock(&source->audio_buf_mutex);
 		}
 	}
+	profile_end(mix_audio_name);
 
 	/* ------------------------------------------------ */
 	/* discard audio */
-	pthread_mutex_lock(&data->audio_sources_mutex);
+	profile_start(discard_audio_name);
+	for (size_t i = 0; i < audio->audio_sources.num; i++) {
+		obs_source_t *source = audio->audio_sources.array[i];
 
-	source = data->first_audio_source;
-	while (source) {
 		pthread_mutex_lock(&source->audio_buf_mutex);
 		discard_audio(audio, source, channels, sample_rate, &ts);
 		pthread_mutex_unlock(&source->audio_buf_mutex);
-
-		source = (struct obs_source *)source->next_audio_source;
 	}
-
-	pthread_mutex_unlock(&data->audio_sources_mutex);
+	profile_end(discard_audio_name);
 
 	/* ------------------------------------------------ */
 	/* release audio sources */
@@ -18,6 +18,7 @@
 #include "obs.h"
 #include "obs-internal.h"
 #include "util/util_uint64.h"
+#include "media-io/video-frame.h"
 
 #define encoder_active(encoder) os_atomic_load_bool(&encoder->active)
 #define set_encoder_active(encoder, val) \
@@ -53,6 +54,7 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name,
 	pthread_mutex_init_value(&encoder->outputs_mutex);
 	pthread_mutex_init_value(&encoder->pause.mutex);
 	pthread_mutex_init_value(&encoder->roi_mutex);
+	pthread_mutex_init_value(&encoder->encode_queue_mutex);
 
 	if (!obs_context_data_init(&encoder->context, OBS_OBJ_TYPE_ENCODER,
 				   settings, name, NULL, hotkey_data, false))
@@ -67,6 +69,8 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name,
 		return false;
 	if (pthread_mutex_init(&encoder->roi_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&encoder->encode_queue_mutex, NULL) != 0)
+		return false;
 
 	if (encoder->orig_info.get_defaults) {
 		encoder->orig_info.get_defaults(encoder->context.settings);
@@ -147,6 +151,10 @@ obs_encoder_t *obs_audio_encoder_create(const char *id, const char *name,
 
 static void receive_video(void *param, struct video_data *frame);
 static void receive_audio(void *param, size_t mix_idx, struct audio_data *data);
+static void start_encode_thread(struct obs_encoder *encoder,
+				const struct video_scale_info *info);
+static void stop_encode_thread(struct obs_encoder *encoder);
+static void free_encode_thread(struct obs_encoder *encoder);
 
 static inline void get_audio_info(const struct obs_encoder *encoder,
 				  struct audio_convert_info *info)
@@ -309,6 +317,9 @@ static void add_connection(struct obs_encoder *encoder)
 		struct audio_convert_info audio_info = {0};
 		get_audio_info(encoder, &audio_info);
 
+		/* encoders of different tracks don't share any state */
+		audio_info.parallel = true;
+
 		audio_output_connect(encoder->media, encoder->mixer_idx,
 				     &audio_info, receive_audio, encoder);
 	} else {
@@ -318,6 +329,8 @@ static void add_connection(struct obs_encoder *encoder)
 		if (gpu_encode_available(encoder)) {
 			start_gpu_encode(encoder);
 		} else {
+			if (encoder->encode_queue_depth)
+				start_encode_thread(encoder, &info);
 			start_raw_video(encoder->media, &info,
 					encoder->frame_rate_divisor,
 					receive_video, encoder);
@@ -336,7 +349,9 @@ static void remove_connection(struct obs_encoder *encoder, bool shutdown)
 		if (gpu_encode_available(encoder)) {
 			stop_gpu_encode(encoder);
 		} else {
+			stop_encode_thread(encoder);
 			stop_raw_video(encoder->media, receive_video, encoder);
+			free_encode_thread(encoder);
 		}
 	}
 
@@ -376,6 +391,7 @@ static void obs_encoder_actually_destroy(obs_encoder_t *encoder)
 		     encoder->context.name);
 
 		free_audio_buffers(encoder);
+		free_encode_thread(encoder);
 
 		if (encoder->context.data)
 			encoder->info.destroy(encoder->context.data);
@@ -386,6 +402,7 @@ static void obs_encoder_actually_destroy(obs_encoder_t *encoder)
 		pthread_mutex_destroy(&encoder->outputs_mutex);
 		pthread_mutex_destroy(&encoder->pause.mutex);
 		pthread_mutex_destroy(&encoder->roi_mutex);
+		pthread_mutex_destroy(&encoder->encode_queue_mutex);
 		obs_context_data_free(&encoder->context);
 		if (encoder->owns_info_id)
 			bfree((void *)encoder->info.id);
@@ -776,14 +793,24 @@ static inline bool obs_encoder_stop_internal(
 
 	idx = get_callback_idx(encoder, new_packet, param);
 	if (idx != DARRAY_INVALID) {
-		da_erase(encoder->callbacks, idx);
-		last = (encoder->callbacks.num == 0);
+		last = (encoder->callbacks.num == 1);
+		if (!last)
+			da_erase(encoder->callbacks, idx);
 	}
 
 	pthread_mutex_unlock(&encoder->callbacks_mutex);
 
 	if (last) {
+		/* the last callback is removed after disconnecting, so it
+		 * still gets the packets of frames left in the encode queue */
 		remove_connection(encoder, true);
+
+		pthread_mutex_lock(&encoder->callbacks_mutex);
+		idx = get_callback_idx(encoder, new_packet, param);
+		if (idx != DARRAY_INVALID)
+			da_erase(encoder->callbacks, idx);
+		pthread_mutex_unlock(&encoder->callbacks_mutex);
+
 		encoder->initialized = false;
 
 		if (encoder->destroy_on_stop) {
@@ -1059,6 +1086,38 @@ uint32_t obs_encoder_get_frame_rate_divisor(const obs_encoder_t *encoder)
 	return encoder->frame_rate_divisor;
 }
 
+bool obs_encoder_set_encode_queue_depth(obs_encoder_t *encoder, size_t depth)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_set_encode_queue_depth"))
+		return false;
+
+	if (encoder->info.type != OBS_ENCODER_VIDEO) {
+		blog(LOG_WARNING,
+		     "obs_encoder_set_encode_queue_depth: "
+		     "encoder '%s' is not a video encoder",
+		     obs_encoder_get_name(encoder));
+		return false;
+	}
+
+	if (encoder_active(encoder)) {
+		blog(LOG_WARNING,
+		     "encoder '%s': Cannot set encode queue depth "
+		     "while the encoder is active",
+		     obs_encoder_get_name(encoder));
+		return false;
+	}
+
+	encoder->encode_queue_depth = depth;
+	return true;
+}
+
+size_t obs_encoder_get_encode_queue_depth(const obs_encoder_t *encoder)
+{
+	return obs_encoder_valid(encoder, "obs_encoder_get_encode_queue_depth")
+		       ? encoder->encode_queue_depth
+		       : 0;
+}
+
 uint32_t obs_encoder_get_sample_rate(const obs_encoder_t *encoder)
 {
 	if (!obs_encoder_valid(encoder, "obs_encoder_get_sample_rate"))
@@ -1226,12 +1285,27 @@ static inline bool get_sei(const struct obs_encoder *encoder, uint8_t **sei,
 	return false;
 }
 
+/* same layout as obs_encoder_packet_create_instance, with the SEI in front */
+static void create_instance_with_sei(struct encoder_packet *dst,
+				     const struct encoder_packet *src,
+				     const uint8_t *sei, size_t sei_size)
+{
+	long *p_refs;
+
+	*dst = *src;
+	dst->size = sei_size + src->size;
+	p_refs = bmalloc(dst->size + sizeof(long));
+	dst->data = (void *)(p_refs + 1);
+	*p_refs = 1;
+	memcpy(dst->data, sei, sei_size);
+	memcpy(dst->data + sei_size, src->data, src->size);
+}
+
 static void send_first_video_packet(struct obs_encoder *encoder,
 				    struct encoder_callback *cb,
 				    struct encoder_packet *packet)
 {
 	struct encoder_packet first_packet;
-	DARRAY(uint8_t) data;
 	uint8_t *sei;
 	size_t size;
 
@@ -1239,25 +1313,19 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 	if (!packet->keyframe)
 		return;
 
-	da_init(data);
-
 	if (!get_sei(encoder, &sei, &size) || !sei || !size) {
 		cb->new_packet(cb->param, packet);
 		cb->sent_first_packet = true;
 		return;
 	}
 
-	da_push_back_array(data, sei, size);
-	da_push_back_array(data, packet->data, packet->size);
-
-	first_packet = *packet;
-	first_packet.data = data.array;
-	first_packet.size = data.num;
+	create_instance_with_sei(&first_packet, packet, sei, size);
+	encoder->stats.bytes_copied += first_packet.size;
 
 	cb->new_packet(cb->param, &first_packet);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&first_packet);
 }
 
 static const char *send_packet_name = "send_packet";
@@ -1274,6 +1342,15 @@ static inline void send_packet(struct obs_encoder *encoder,
 	profile_end(send_packet_name);
 }
 
+/* the encode thread is encoding the frames left in its queue for a stopping
+ * encoder, the connection is already being removed by whoever stopped it */
+static inline bool encode_thread_draining(struct obs_encoder *encoder)
+{
+	return encoder->encode_thread_initialized &&
+	       pthread_equal(pthread_self(), encoder->encode_thread) &&
+	       os_atomic_load_bool(&encoder->encode_thread_stop);
+}
+
 void full_stop(struct obs_encoder *encoder)
 {
 	if (encoder) {
@@ -1292,7 +1369,8 @@ void full_stop(struct obs_encoder *encoder)
 		da_free(encoder->callbacks);
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
 
-		remove_connection(encoder, false);
+		if (!encode_thread_draining(encoder))
+			remove_connection(encoder, false);
 		encoder->initialized = false;
 	}
 }
@@ -1325,12 +1403,26 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
 
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
-		for (size_t i = encoder->callbacks.num; i > 0; i--) {
-			struct encoder_callback *cb;
-			cb = encoder->callbacks.array + (i - 1);
-			send_packet(encoder, cb, pkt);
+		if (encoder->callbacks.num) {
+			struct encoder_packet shared;
+
+			/* the encoder reuses its buffer, so copy it once and
+			 * let every callback take a reference to that copy */
+			obs_encoder_packet_create_instance(&shared, pkt);
+			encoder->stats.bytes_copied += pkt->size;
+
+			for (size_t i = encoder->callbacks.num; i > 0; i--) {
+				struct encoder_callback *cb;
+				cb = encoder->callbacks.array + (i - 1);
+				send_packet(encoder, cb, &shared);
+			}
+
+			obs_encoder_packet_release(&shared);
 		}
 
+		encoder->stats.packets++;
+		encoder->stats.bytes += pkt->size;
+
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
 	}
 }
@@ -1399,6 +1491,223 @@ bool video_pause_check(struct pause_data *pause, uint64_t timestamp)
 	return ignore_frame;
 }
 
+struct queued_video_frame {
+	struct encoder_frame frame;
+	struct video_frame_buffer *buffer;
+	struct video_frame copy;
+	uint64_t queued_ts;
+};
+
+static inline void free_queued_frame(struct queued_video_frame *qf)
+{
+	video_frame_buffer_release(qf->buffer);
+	video_frame_free(&qf->copy);
+}
+
+static inline size_t encode_queue_num(const struct obs_encoder *encoder)
+{
+	return encoder->encode_queue.size / sizeof(struct queued_video_frame);
+}
+
+static const char *encode_thread_frame_name = "encode_thread_frame";
+static void *encode_thread(void *data)
+{
+	struct obs_encoder *encoder = data;
+	uint64_t interval = video_output_get_frame_time(encoder->media) *
+			    encoder->frame_rate_divisor;
+
+	os_set_thread_name("libobs: encode thread");
+	const char *encode_thread_name =
+		profile_store_name(obs_get_profiler_name_store(),
+				   "obs_encode_thread(%s)",
+				   encoder->context.name);
+	profile_register_root(encode_thread_name, interval);
+
+	while (os_sem_wait(encoder->encode_queue_sem) == 0) {
+		struct queued_video_frame qf;
+		bool queued;
+		bool success;
+		uint64_t lag;
+
+		/* frames queued before the thread was stopped are still
+		 * encoded, it only exits once the queue is empty */
+		pthread_mutex_lock(&encoder->encode_queue_mutex);
+		queued = encoder->encode_queue.size != 0;
+		if (queued)
+			deque_pop_front(&encoder->encode_queue, &qf,
+					sizeof(qf));
+		pthread_mutex_unlock(&encoder->encode_queue_mutex);
+
+		if (!queued) {
+			if (os_atomic_load_bool(&encoder->encode_thread_stop))
+				break;
+			continue;
+		}
+
+		os_event_signal(encoder->encode_queue_space);
+
+		profile_start(encode_thread_name);
+
+		profile_start(encode_thread_frame_name);
+		qf.frame.pts = encoder->cur_pts;
+		success = do_encode(encoder, &qf.frame);
+		if (success)
+			encoder->cur_pts += encoder->timebase_num *
+					    encoder->frame_rate_divisor;
+		profile_end(encode_thread_frame_name);
+
+		lag = os_gettime_ns() - qf.queued_ts;
+		free_queued_frame(&qf);
+
+		pthread_mutex_lock(&encoder->encode_queue_mutex);
+		encoder->encode_lag_ns = lag;
+		pthread_mutex_unlock(&encoder->encode_queue_mutex);
+
+		profile_end(encode_thread_name);
+		profile_reenable_thread();
+
+		/* an encoding error fully stopped the encoder, the frames left
+		 * are freed when the thread is joined */
+		if (!success)
+			break;
+	}
+
+	return NULL;
+}
+
+static void start_encode_thread(struct obs_encoder *encoder,
+				const struct video_scale_info *info)
+{
+	/* a thread stopped by an encoding error still has to be joined */
+	free_encode_thread(encoder);
+
+	encoder->encode_queue_info = *info;
+	encoder->encode_lag_ns = 0;
+	encoder->encode_queue_stalls = 0;
+	os_atomic_set_bool(&encoder->encode_thread_stop, false);
+
+	if (os_sem_init(&encoder->encode_queue_sem, 0) != 0)
+		goto fail;
+	if (os_event_init(&encoder->encode_queue_space, OS_EVENT_TYPE_AUTO) !=
+	    0)
+		goto fail;
+	if (pthread_create(&encoder->encode_thread, NULL, encode_thread,
+			   encoder) != 0)
+		goto fail;
+
+	encoder->encode_thread_initialized = true;
+	return;
+
+fail:
+	blog(LOG_WARNING,
+	     "encoder '%s': Failed to create encode thread, "
+	     "encoding on the video thread instead",
+	     encoder->context.name);
+	os_sem_destroy(encoder->encode_queue_sem);
+	os_event_destroy(encoder->encode_queue_space);
+	encoder->encode_queue_sem = NULL;
+	encoder->encode_queue_space = NULL;
+}
+
+/* wakes up the encode thread and the video thread if it's waiting for room
+ * in the queue.  frames received after this are discarded, the encode thread
+ * encodes the frames already queued and then exits */
+static void stop_encode_thread(struct obs_encoder *encoder)
+{
+	if (!encoder->encode_thread_initialized)
+		return;
+
+	os_atomic_set_bool(&encoder->encode_thread_stop, true);
+	os_sem_post(encoder->encode_queue_sem);
+	os_event_signal(encoder->encode_queue_space);
+}
+
+static void free_encode_thread(struct obs_encoder *encoder)
+{
+	struct queued_video_frame qf;
+
+	if (!encoder->encode_thread_initialized)
+		return;
+
+	/* encoding errors stop the encoder from its encode thread, in which
+	 * case it's joined when the encoder is started or destroyed again */
+	if (pthread_equal(pthread_self(), encoder->encode_thread))
+		return;
+
+	stop_encode_thread(encoder);
+	pthread_join(encoder->encode_thread, NULL);
+	encoder->encode_thread_initialized = false;
+
+	while (encoder->encode_queue.size) {
+		deque_pop_front(&encoder->encode_queue, &qf, sizeof(qf));
+		free_queued_frame(&qf);
+	}
+	deque_free(&encoder->encode_queue);
+
+	os_sem_destroy(encoder->encode_queue_sem);
+	os_event_destroy(encoder->encode_queue_space);
+	encoder->encode_queue_sem = NULL;
+	encoder->encode_queue_space = NULL;
+}
+
+/* holds on to the frame (or a copy of it) until the encode thread gets to
+ * it.  if the queue is full, this waits for the encode thread, just like the
+ * video thread would otherwise wait for the encoder itself */
+static void queue_video_frame(struct obs_encoder *encoder,
+			      const struct video_data *frame,
+			      const struct encoder_frame *enc_frame)
+{
+	const struct video_scale_info *info = &encoder->encode_queue_info;
+	struct queued_video_frame qf = {0};
+	bool stalled = false;
+	bool stopped;
+
+	qf.frame = *enc_frame;
+	qf.queued_ts = os_gettime_ns();
+	qf.buffer = video_data_addref(frame);
+
+	if (!qf.buffer) {
+		struct video_frame src;
+
+		memcpy(src.data, frame->data, sizeof(src.data));
+		memcpy(src.linesize, frame->linesize, sizeof(src.linesize));
+
+		video_frame_init(&qf.copy, info->format, info->width,
+				 info->height);
+		video_frame_copy(&qf.copy, &src, info->format, info->height);
+
+		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+			qf.frame.data[i] = qf.copy.data[i];
+			qf.frame.linesize[i] = qf.copy.linesize[i];
+		}
+	}
+
+	pthread_mutex_lock(&encoder->encode_queue_mutex);
+
+	while (!os_atomic_load_bool(&encoder->encode_thread_stop) &&
+	       encode_queue_num(encoder) >= encoder->encode_queue_depth) {
+		if (!stalled) {
+			encoder->encode_queue_stalls++;
+			stalled = true;
+		}
+
+		pthread_mutex_unlock(&encoder->encode_queue_mutex);
+		os_event_wait(encoder->encode_queue_space);
+		pthread_mutex_lock(&encoder->encode_queue_mutex);
+	}
+
+	stopped = os_atomic_load_bool(&encoder->encode_thread_stop);
+	if (!stopped)
+		deque_push_back(&encoder->encode_queue, &qf, sizeof(qf));
+
+	pthread_mutex_unlock(&encoder->encode_queue_mutex);
+
+	if (stopped)
+		free_queued_frame(&qf);
+	else
+		os_sem_post(encoder->encode_queue_sem);
+}
+
 static const char *receive_video_name = "receive_video";
 static void receive_video(void *param, struct video_data *frame)
 {
@@ -1431,6 +1740,12 @@ static void receive_video(void *param, struct video_data *frame)
 		encoder->start_ts = frame->timestamp;
 
 	enc_frame.frames = 1;
+
+	if (encoder->encode_thread_initialized) {
+		queue_video_frame(encoder, frame, &enc_frame);
+		goto wait_for_audio;
+	}
+
 	enc_frame.pts = encoder->cur_pts;
 
 	if (do_encode(encoder, &enc_frame))
@@ -1456,6 +1771,14 @@ static inline void push_back_audio(struct obs_encoder *encoder,
 
 	size -= offset_size;
 
+	/* silent blocks don't need to be copied from the mix */
+	if (data->silent) {
+		for (size_t i = 0; i < encoder->planes; i++)
+			deque_push_back_zero(&encoder->audio_input_buffer[i],
+					     size);
+		return;
+	}
+
 	/* push in to the circular buffer */
 	for (size_t i = 0; i < encoder->planes; i++)
 		deque_push_back(&encoder->audio_input_buffer[i],
@@ -1909,6 +2232,24 @@ uint64_t obs_encoder_get_pause_offset(const obs_encoder_t *encoder)
 	return encoder ? encoder->pause.ts_offset : 0;
 }
 
+bool obs_encoder_get_stats(obs_encoder_t *encoder,
+			   struct obs_encoder_stats *stats)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_stats"))
+		return false;
+
+	pthread_mutex_lock(&encoder->callbacks_mutex);
+	*stats = encoder->stats;
+	pthread_mutex_unlock(&encoder->callbacks_mutex);
+
+	pthread_mutex_lock(&encoder->encode_queue_mutex);
+	stats->queued_frames = encode_queue_num(encoder);
+	stats->lag_ns = encoder->encode_lag_ns;
+	stats->queue_stalls = encoder->encode_queue_stalls;
+	pthread_mutex_unlock(&encoder->encode_queue_mutex);
+	return true;
+}
+
 bool obs_encoder_has_roi(const obs_encoder_t *encoder)
 {
 	return encoder->roi.num > 0;
@@ -0,0 +1,224 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+
+/*
+ * Process-wide pool of idle async source frames.  Frames are matched by
+ * size and by layout class (formats that allocate identical planes share a
+ * class), so a frame released by one source can be reused by any other
+ * source outputting the same kind of video.  Idle frames are kept oldest
+ * first; the oldest ones are freed once they've been idle for a while or
+ * when the pool holds more than its limit.
+ */
+
+#define DEFAULT_POOL_LIMIT (256ULL * 1024 * 1024)
+#define MAX_IDLE_NS 5000000000ULL
+
+struct pooled_frame {
+	struct obs_source_frame *frame;
+	enum video_format layout;
+	uint64_t size;
+	uint64_t release_ts;
+};
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct pooled_frame) pool_frames;
+static uint64_t pool_limit = DEFAULT_POOL_LIMIT;
+static uint64_t pool_bytes = 0;
+static uint64_t pool_hits = 0;
+static uint64_t pool_misses = 0;
+static uint64_t pool_trimmed = 0;
+
+static enum video_format get_layout_class(enum video_format format)
+{
+	switch (format) {
+	case VIDEO_FORMAT_YVYU:
+	case VIDEO_FORMAT_UYVY:
+		return VIDEO_FORMAT_YUY2;
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_AYUV:
+		return VIDEO_FORMAT_BGRA;
+	default:
+		return format;
+	}
+}
+
+/* close enough for accounting, alignment padding is ignored */
+static uint64_t get_frame_size(const struct obs_source_frame *frame)
+{
+	const uint64_t half_height = (frame->height + 1) / 2;
+	uint64_t size = 0;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		uint64_t rows = frame->height;
+
+		if (!frame->data[i])
+			break;
+
+		switch (frame->format) {
+		case VIDEO_FORMAT_I420:
+		case VIDEO_FORMAT_I010:
+		case VIDEO_FORMAT_I40A:
+		case VIDEO_FORMAT_NV12:
+		case VIDEO_FORMAT_P010:
+			if (i == 1 || i == 2)
+				rows = half_height;
+			break;
+		default:
+			break;
+		}
+
+		size += rows * frame->linesize[i];
+	}
+
+	return size;
+}
+
+static void remove_pooled_frame(size_t idx)
+{
+	struct pooled_frame *pf = &pool_frames.array[idx];
+
+	pool_bytes -= pf->size;
+	obs_source_frame_destroy(pf->frame);
+	da_erase(pool_frames, idx);
+	pool_trimmed++;
+}
+
+/* frees the least recently used frames until the pool is under 'limit' and
+ * nothing has been idle for too long */
+static void trim_pool(uint64_t limit, uint64_t now)
+{
+	while (pool_frames.num) {
+		struct pooled_frame *pf = &pool_frames.array[0];
+
+		if (pool_bytes <= limit && now - pf->release_ts < MAX_IDLE_NS)
+			break;
+
+		remove_pooled_frame(0);
+	}
+}
+
+struct obs_source_frame *obs_frame_pool_acquire(enum video_format format,
+						uint32_t width,
+						uint32_t height)
+{
+	enum video_format layout = get_layout_class(format);
+	struct obs_source_frame *frame = NULL;
+
+	pthread_mutex_lock(&pool_mutex);
+
+	/* most recently released first, its memory is the most likely to
+	 * still be in the cache */
+	for (size_t i = pool_frames.num; i > 0; i--) {
+		struct pooled_frame *pf = &pool_frames.array[i - 1];
+
+		if (pf->layout == layout && pf->frame->width == width &&
+		    pf->frame->height == height) {
+			frame = pf->frame;
+			pool_bytes -= pf->size;
+			da_erase(pool_frames, i - 1);
+			break;
+		}
+	}
+
+	if (frame)
+		pool_hits++;
+	else
+		pool_misses++;
+
+	trim_pool(pool_limit, os_gettime_ns());
+
+	pthread_mutex_unlock(&pool_mutex);
+
+	if (!frame)
+		frame = obs_source_frame_create(format, width, height);
+
+	frame->format = format;
+	frame->prev_frame = false;
+	frame->refs = 1;
+	return frame;
+}
+
+void obs_frame_pool_release(struct obs_source_frame *frame)
+{
+	struct pooled_frame pf;
+
+	if (!frame)
+		return;
+
+	pf.frame = frame;
+	pf.layout = get_layout_class(frame->format);
+	pf.size = get_frame_size(frame);
+	pf.release_ts = os_gettime_ns();
+
+	pthread_mutex_lock(&pool_mutex);
+
+	if (!obs || pf.size > pool_limit) {
+		pthread_mutex_unlock(&pool_mutex);
+		obs_source_frame_destroy(frame);
+		return;
+	}
+
+	trim_pool(pool_limit - pf.size, pf.release_ts);
+
+	da_push_back(pool_frames, &pf);
+	pool_bytes += pf.size;
+
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void obs_frame_pool_trim(void)
+{
+	pthread_mutex_lock(&pool_mutex);
+	trim_pool(pool_limit, os_gettime_ns());
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void obs_frame_pool_free(void)
+{
+	pthread_mutex_lock(&pool_mutex);
+	for (size_t i = 0; i < pool_frames.num; i++)
+		obs_source_frame_destroy(pool_frames.array[i].frame);
+	da_free(pool_frames);
+	pool_bytes = 0;
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void obs_set_frame_pool_limit(uint64_t bytes)
+{
+	pthread_mutex_lock(&pool_mutex);
+	pool_limit = bytes;
+	trim_pool(pool_limit, os_gettime_ns());
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void obs_get_frame_pool_stats(struct obs_frame_pool_stats *stats)
+{
+	if (!obs_ptr_valid(stats, "obs_get_frame_pool_stats"))
+		return;
+
+	pthread_mutex_lock(&pool_mutex);
+	stats->hits = pool_hits;
+	stats->misses = pool_misses;
+	stats->trimmed = pool_trimmed;
+	stats->bytes_held = pool_bytes;
+	stats->bytes_limit = pool_limit;
+	stats->frames_held = (uint32_t)pool_frames.num;
+	pthread_mutex_unlock(&pool_mutex);
+}
@@ -0,0 +1,312 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "util/darray.h"
+#include "util/deque.h"
+#include "obs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Interleave buffer for encoded packets.  Each video/audio track gets its own
+ * FIFO queue, and a min-heap of the non-empty queues (ordered by their first
+ * packet) gives the next packet to send out.  Encoders output their packets
+ * in DTS order, so each queue stays sorted without any searching.
+ *
+ * Packets are ordered by dts_usec.  On equal dts_usec, video comes before
+ * audio and tracks of the same type are ordered by track index (audio
+ * tracks may be encoded in parallel, so the order they were pushed in
+ * depends on thread timing).  Packets of the same track keep the order
+ * they were pushed in.
+ */
+
+#define INTERLEAVE_QUEUES \
+	(MAX_OUTPUT_VIDEO_ENCODERS + MAX_OUTPUT_AUDIO_ENCODERS)
+
+struct interleaved_packet {
+	struct encoder_packet packet;
+	uint64_t seq;
+};
+
+struct packet_interleaver {
+	struct deque queues[INTERLEAVE_QUEUES];
+	size_t heap[INTERLEAVE_QUEUES];
+	size_t heap_size;
+	size_t num;
+	uint64_t next_seq;
+};
+
+static inline size_t interleave_queue_idx(enum obs_encoder_type type,
+					  size_t track_idx)
+{
+	return type == OBS_ENCODER_VIDEO
+		       ? track_idx
+		       : MAX_OUTPUT_VIDEO_ENCODERS + track_idx;
+}
+
+static inline size_t interleave_queue_size(const struct packet_interleaver *il,
+					   size_t queue)
+{
+	return il->queues[queue].size / sizeof(struct interleaved_packet);
+}
+
+static inline struct interleaved_packet *
+interleave_get(struct packet_interleaver *il, size_t queue, size_t idx)
+{
+	return (struct interleaved_packet *)deque_data(
+		&il->queues[queue], idx * sizeof(struct interleaved_packet));
+}
+
+static inline bool interleaved_packet_before(const struct interleaved_packet *a,
+					     const struct interleaved_packet *b)
+{
+	const struct encoder_packet *pa = &a->packet;
+	const struct encoder_packet *pb = &b->packet;
+
+	if (pa->dts_usec != pb->dts_usec)
+		return pa->dts_usec < pb->dts_usec;
+	if (pa->type != pb->type)
+		return pa->type == OBS_ENCODER_VIDEO;
+	if (pa->track_idx != pb->track_idx)
+		return pa->track_idx < pb->track_idx;
+	return a->seq < b->seq;
+}
+
+static inline bool interleave_heap_less(struct packet_interleaver *il,
+					size_t i, size_t j)
+{
+	return interleaved_packet_before(interleave_get(il, il->heap[i], 0),
+					 interleave_get(il, il->heap[j], 0));
+}
+
+static inline void interleave_heap_swap(struct packet_interleaver *il,
+					size_t i, size_t j)
+{
+	size_t tmp = il->heap[i];
+	il->heap[i] = il->heap[j];
+	il->heap[j] = tmp;
+}
+
+static inline void interleave_sift_up(struct packet_interleaver *il, size_t i)
+{
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (!interleave_heap_less(il, i, parent))
+			break;
+
+		interleave_heap_swap(il, i, parent);
+		i = parent;
+	}
+}
+
+static inline void interleave_sift_down(struct packet_interleaver *il,
+					size_t i)
+{
+	for (;;) {
+		size_t left = i * 2 + 1;
+		size_t right = left + 1;
+		size_t min = i;
+
+		if (left < il->heap_size && interleave_heap_less(il, left, min))
+			min = left;
+		if (right < il->heap_size &&
+		    interleave_heap_less(il, right, min))
+			min = right;
+		if (min == i)
+			break;
+
+		interleave_heap_swap(il, i, min);
+		i = min;
+	}
+}
+
+/* rebuilds the heap after the timestamps of queued packets were changed */
+static inline void interleave_reheap(struct packet_interleaver *il)
+{
+	il->heap_size = 0;
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		if (il->queues[i].size)
+			il->heap[il->heap_size++] = i;
+	}
+
+	for (size_t i = il->heap_size / 2; i > 0; i--)
+		interleave_sift_down(il, i - 1);
+}
+
+/* takes ownership of the packet */
+static inline void interleave_push(struct packet_interleaver *il,
+				   const struct encoder_packet *packet)
+{
+	struct interleaved_packet ip = {*packet, il->next_seq++};
+	size_t queue = interleave_queue_idx(packet->type, packet->track_idx);
+	bool was_empty = !il->queues[queue].size;
+
+	deque_push_back(&il->queues[queue], &ip, sizeof(ip));
+	il->num++;
+
+	if (was_empty) {
+		il->heap[il->heap_size] = queue;
+		interleave_sift_up(il, il->heap_size++);
+	}
+}
+
+static inline struct encoder_packet *
+interleave_peek(struct packet_interleaver *il)
+{
+	if (!il->heap_size)
+		return NULL;
+	return &interleave_get(il, il->heap[0], 0)->packet;
+}
+
+/* gives up ownership of the packet */
+static inline bool interleave_pop(struct packet_interleaver *il,
+				  struct encoder_packet *packet)
+{
+	struct interleaved_packet ip;
+	struct deque *dq;
+
+	if (!il->heap_size)
+		return false;
+
+	dq = &il->queues[il->heap[0]];
+	deque_pop_front(dq, &ip, sizeof(ip));
+	il->num--;
+
+	if (!dq->size)
+		il->heap[0] = il->heap[--il->heap_size];
+	if (il->heap_size)
+		interleave_sift_down(il, 0);
+
+	*packet = ip.packet;
+	return true;
+}
+
+static inline struct encoder_packet *
+interleave_first(struct packet_interleaver *il, enum obs_encoder_type type,
+		 size_t track_idx)
+{
+	size_t queue = interleave_queue_idx(type, track_idx);
+
+	if (!il->queues[queue].size)
+		return NULL;
+	return &interleave_get(il, queue, 0)->packet;
+}
+
+static inline struct encoder_packet *
+interleave_last(struct packet_interleaver *il, enum obs_encoder_type type,
+		size_t track_idx)
+{
+	size_t queue = interleave_queue_idx(type, track_idx);
+	size_t size = interleave_queue_size(il, queue);
+
+	if (!size)
+		return NULL;
+	return &interleave_get(il, queue, size - 1)->packet;
+}
+
+/* position of a queued packet in the order packets are sent out in */
+static inline size_t interleave_rank(struct packet_interleaver *il,
+				     size_t queue, size_t idx)
+{
+	struct interleaved_packet *target = interleave_get(il, queue, idx);
+	size_t rank = idx;
+
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		size_t lo = 0;
+		size_t hi = interleave_queue_size(il, i);
+
+		if (i == queue)
+			continue;
+
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			struct interleaved_packet *cur =
+				interleave_get(il, i, mid);
+
+			if (interleaved_packet_before(cur, target))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		rank += lo;
+	}
+
+	return rank;
+}
+
+/* re-pushes every packet in its current order, so that ties between audio
+ * packets stay resolved that way after their timestamps change */
+static inline void interleave_renumber(struct packet_interleaver *il)
+{
+	DARRAY(struct encoder_packet) packets;
+	struct encoder_packet packet;
+
+	da_init(packets);
+	da_reserve(packets, il->num);
+
+	while (interleave_pop(il, &packet))
+		da_push_back(packets, &packet);
+
+	il->next_seq = 0;
+	for (size_t i = 0; i < packets.num; i++)
+		interleave_push(il, packets.array + i);
+
+	da_free(packets);
+}
+
+static inline void interleave_discard(struct packet_interleaver *il,
+				      size_t count)
+{
+	struct encoder_packet packet;
+
+	while (count-- && interleave_pop(il, &packet))
+		obs_encoder_packet_release(&packet);
+}
+
+static inline void interleave_discard_before(struct packet_interleaver *il,
+					     int64_t dts_usec)
+{
+	struct encoder_packet *next;
+	struct encoder_packet packet;
+
+	while ((next = interleave_peek(il)) && next->dts_usec < dts_usec) {
+		interleave_pop(il, &packet);
+		obs_encoder_packet_release(&packet);
+	}
+}
+
+static inline void interleave_free(struct packet_interleaver *il)
+{
+	struct encoder_packet packet;
+
+	while (interleave_pop(il, &packet))
+		obs_encoder_packet_release(&packet);
+
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++)
+		deque_free(&il->queues[i]);
+
+	memset(il, 0, sizeof(*il));
+}
+
+#ifdef __cplusplus
+}
+#endif
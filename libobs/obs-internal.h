@@ -26,6 +26,7 @@
 #include "util/profiler.h"
 #include "util/task.h"
 #include "util/uthash.h"
+#include "util/virtual-clock.h"
 #include "callback/signal.h"
 #include "callback/proc.h"
 
@@ -35,8 +36,10 @@
 #include "media-io/audio-resampler.h"
 #include "media-io/video-io.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-kernels.h"
 
 #include "obs.h"
+#include "obs-interleave.h"
 
 #include <obsversion.h>
 #include <caption/caption.h>
@@ -335,6 +338,7 @@ struct obs_core_video {
 	gs_samplerstate_t *point_sampler;
 
 	uint64_t video_time;
+	size_t video_clock_id;
 	uint64_t video_frame_interval_ns;
 	uint64_t video_half_frame_interval_ns;
 	uint64_t video_avg_frame_time_ns;
@@ -364,16 +368,45 @@ struct obs_core_video {
 	pthread_mutex_t mixes_mutex;
 	DARRAY(struct obs_core_video_mix *) mixes;
 	struct obs_core_video_mix *main_mix;
+
+	/* runs the video_tick callbacks of sources that have the
+	 * OBS_SOURCE_PARALLEL_TICK flag */
+	os_thread_pool_t *tick_pool;
 };
 
 struct audio_monitor;
 
+/* copy of the audio source list, owned by the audio thread and rebuilt
+ * when the list changes */
+struct audio_source_snapshot {
+	DARRAY(obs_weak_source_t *) sources;
+};
+
 struct obs_core_audio {
 	audio_t *audio;
+	const struct audio_kernels *kernels;
+	uint32_t frames_per_tick;
+
+	/* audio thread only: the current snapshot, and the sources from it
+	 * that could be referenced for the current tick */
+	struct audio_source_snapshot *source_snapshot;
+	DARRAY(struct obs_source *) audio_sources;
 
 	DARRAY(struct obs_source *) render_order;
 	DARRAY(struct obs_source *) root_nodes;
 
+	/* parallel render mode: sources of the same level in the render
+	 * tree don't depend on each other and are rendered concurrently */
+	os_thread_pool_t *render_pool;
+	DARRAY(struct obs_source *) render_batch;
+	int max_render_level;
+
+	/* runs audio encoders of all mixes concurrently each tick */
+	os_thread_pool_t *encode_pool;
+
+	uint64_t silent_blocks_skipped;
+	uint32_t buffering_increases;
+
 	uint64_t buffered_ts;
 	struct deque buffered_timestamps;
 	uint64_t buffering_wait_ticks;
@@ -409,6 +442,7 @@ struct obs_core_data {
 	pthread_mutex_t encoders_mutex;
 	pthread_mutex_t services_mutex;
 	pthread_mutex_t audio_sources_mutex;
+	volatile bool audio_sources_changed;
 	pthread_mutex_t draw_callbacks_mutex;
 	DARRAY(struct draw_callback) draw_callbacks;
 	DARRAY(struct rendered_callback) rendered_callbacks;
@@ -423,7 +457,14 @@ struct obs_core_data {
 	volatile bool valid;
 
 	DARRAY(char *) protocols;
+	/* sources that need to be ticked each frame, sources are added with
+	 * obs_source_request_tick and pruned by the graphics thread once they
+	 * settle, see obs_source_needs_tick */
+	pthread_mutex_t tick_list_mutex;
+	DARRAY(obs_source_t *) tick_list;
+
 	DARRAY(obs_source_t *) sources_to_tick;
+	DARRAY(obs_source_t *) sources_to_tick_parallel;
 };
 
 /* user hotkeys */
@@ -491,6 +532,9 @@ struct obs_core {
 	struct obs_core_data data;
 	struct obs_core_hotkeys hotkeys;
 
+	/* drives video and audio instead of the system clock when set */
+	virtual_clock_t *virtual_clock;
+
 	os_task_queue_t *destruction_task_thread;
 
 	obs_task_handler_t ui_task_handler;
@@ -520,6 +564,8 @@ extern gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file);
 extern bool audio_callback(void *param, uint64_t start_ts_in,
 			   uint64_t end_ts_in, uint64_t *out_ts,
 			   uint32_t mixers, struct audio_output_data *mixes);
+extern void obs_audio_sources_changed(void);
+extern void audio_source_snapshot_free(struct audio_source_snapshot *snapshot);
 
 extern struct obs_core_video_mix *get_mix_for_video(video_t *video);
 
@@ -655,6 +701,15 @@ struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
 	bool used;
+	bool lent;
+};
+
+/* frame whose data was lent by the source with obs_source_output_video_ref,
+ * release(param) is called once the frame is freed */
+struct lent_frame {
+	struct obs_source_frame *frame;
+	obs_source_frame_release_t release;
+	void *param;
 };
 
 enum audio_action_type {
@@ -721,6 +776,15 @@ struct obs_source {
 	/* signals to call the source update in the video thread */
 	long defer_update_count;
 
+	/* profiler name of the video_tick callback */
+	const char *profile_tick_name;
+
+	/* in obs->data.tick_list, protected by tick_list_mutex */
+	bool in_tick_list;
+
+	/* already in sources_to_tick this frame, graphics thread only */
+	bool tick_collected;
+
 	/* ensures show/hide are only called once */
 	volatile long show_refs;
 
@@ -768,10 +832,14 @@ struct obs_source {
 	struct obs_source *next_audio_source;
 	struct obs_source **prev_next_audio_source;
 	uint64_t audio_ts;
+	int audio_render_level;
+	uint32_t audio_silent_mixes;
 	struct deque audio_input_buf[MAX_AUDIO_CHANNELS];
 	size_t last_audio_input_buf_size;
 	DARRAY(struct audio_action) audio_actions;
 	float *audio_output_buf[MAX_AUDIO_MIXES][MAX_AUDIO_CHANNELS];
+	uint32_t audio_buf_mixers;
+	uint32_t audio_render_mixers;
 	float *audio_mix_buf[MAX_AUDIO_CHANNELS];
 	struct resample_info sample_info;
 	audio_resampler_t *resampler;
@@ -789,6 +857,27 @@ struct obs_source {
 	int64_t last_sync_offset;
 	float balance;
 
+	/* optional per-source jitter buffer: late delivery is absorbed by
+	 * delaying just this source, and clock drift is corrected by
+	 * resampling instead of raising the global audio buffering */
+	uint64_t jitter_max;
+	uint64_t jitter_delay;
+	uint64_t last_jitter_delay;
+	bool jitter_init;
+	double jitter_mean;
+	double jitter_base;
+	double jitter_settle;
+	double jitter_peak;
+	double jitter_comp;
+	double jitter_comp_frac;
+	volatile bool jitter_reset;
+
+	/* audio telemetry, see obs_source_get_audio_stats() */
+	int64_t audio_lateness;
+	int64_t audio_max_lateness;
+	uint32_t audio_buffering_increases;
+	uint64_t audio_buffering_added;
+
 	/* async video data */
 	gs_texture_t *async_textures[MAX_AV_PLANES];
 	gs_texrender_t *async_texrender;
@@ -812,6 +901,7 @@ struct obs_source {
 	struct obs_source_frame *async_preload_frame;
 	DARRAY(struct async_frame) async_cache;
 	DARRAY(struct obs_source_frame *) async_frames;
+	DARRAY(struct lent_frame) async_lent_frames;
 	pthread_mutex_t async_mutex;
 	uint32_t async_width;
 	uint32_t async_height;
@@ -1017,6 +1107,10 @@ extern void obs_source_set_texcoords_centered(obs_source_t *source,
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
+extern bool obs_source_video_tick_prepare(obs_source_t *source, float seconds);
+extern void obs_source_request_tick(obs_source_t *source);
+extern bool obs_source_needs_tick(obs_source_t *source);
+extern void obs_source_video_tick_call(obs_source_t *source, float seconds);
 extern float obs_source_get_target_volume(obs_source_t *source,
 					  obs_source_t *target);
 
@@ -1040,6 +1134,14 @@ extern bool set_async_texture_size(struct obs_source *source,
 extern void remove_async_frame(obs_source_t *source,
 			       struct obs_source_frame *frame);
 
+/* process-wide pool of async frames, see obs-frame-pool.c */
+extern struct obs_source_frame *obs_frame_pool_acquire(enum video_format format,
+						       uint32_t width,
+						       uint32_t height);
+extern void obs_frame_pool_release(struct obs_source_frame *frame);
+extern void obs_frame_pool_trim(void);
+extern void obs_frame_pool_free(void);
+
 extern void set_deinterlace_texture_size(obs_source_t *source);
 extern void deinterlace_process_last_frame(obs_source_t *source,
 					   uint64_t sys_time);
@@ -1059,6 +1161,19 @@ struct delay_data {
 	enum delay_msg msg;
 	uint64_t ts;
 	struct encoder_packet packet;
+	bool spilled; /* packet data is in the spill file */
+};
+
+/* ring buffer of delayed packet data in a file mapped into memory, packets
+ * are read back in the same order they were written in */
+struct delay_spill {
+	os_mapped_file_t *file;
+	uint8_t *data;
+	size_t size;
+	size_t read_pos;
+	size_t used;
+	uint64_t ram_window;
+	bool full_logged;
 };
 
 typedef void (*encoded_callback_t)(void *data, struct encoder_packet *packet);
@@ -1107,7 +1222,7 @@ struct obs_output {
 	pthread_t end_data_capture_thread;
 	os_event_t *stopping_event;
 	pthread_mutex_t interleaved_mutex;
-	DARRAY(struct encoder_packet) interleaved_packets;
+	struct packet_interleaver interleaved_packets;
 	int stop_code;
 
 	int reconnect_retry_sec;
@@ -1172,6 +1287,12 @@ struct obs_output {
 	volatile bool delay_active;
 	volatile bool delay_capturing;
 
+	char *delay_spill_dir;
+	uint64_t delay_spill_window;
+	uint64_t delay_spill_size;
+	struct delay_spill delay_spill;
+	struct obs_output_delay_stats delay_stats;
+
 	char *last_error_message;
 
 	float audio_data[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
@@ -1188,6 +1309,7 @@ static inline void do_output_signal(struct obs_output *output,
 
 extern void process_delay(void *data, struct encoder_packet *packet);
 extern void obs_output_cleanup_delay(obs_output_t *output);
+extern void obs_output_init_delay_spill(obs_output_t *output);
 extern bool obs_output_delay_start(obs_output_t *output);
 extern void obs_output_delay_stop(obs_output_t *output);
 extern bool obs_output_actual_start(obs_output_t *output);
@@ -1293,6 +1415,23 @@ struct obs_encoder {
 	pthread_mutex_t callbacks_mutex;
 	DARRAY(struct encoder_callback) callbacks;
 
+	/* protected by callbacks_mutex */
+	struct obs_encoder_stats stats;
+
+	/* raw video frames can be queued up and encoded on a thread of the
+	 * encoder's own instead of on the video output thread */
+	size_t encode_queue_depth;
+	pthread_mutex_t encode_queue_mutex;
+	struct deque encode_queue;
+	struct video_scale_info encode_queue_info;
+	os_sem_t *encode_queue_sem;
+	os_event_t *encode_queue_space;
+	pthread_t encode_thread;
+	bool encode_thread_initialized;
+	volatile bool encode_thread_stop;
+	uint64_t encode_lag_ns;
+	uint64_t encode_queue_stalls;
+
 	struct pause_data pause;
 
 	const char *profile_encoder_encode_name;
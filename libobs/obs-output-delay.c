@@ -44,6 +44,100 @@ static inline bool log_flag_encoded(const struct obs_output *output,
 	return ret;
 }
 
+static void spill_write(struct delay_spill *spill, const uint8_t *data,
+			size_t size)
+{
+	size_t pos = (spill->read_pos + spill->used) % spill->size;
+	size_t part = spill->size - pos;
+
+	if (part > size)
+		part = size;
+
+	memcpy(spill->data + pos, data, part);
+	memcpy(spill->data, data + part, size - part);
+	spill->used += size;
+}
+
+static void spill_read(struct delay_spill *spill, uint8_t *data, size_t size)
+{
+	size_t part = spill->size - spill->read_pos;
+
+	if (part > size)
+		part = size;
+
+	memcpy(data, spill->data + spill->read_pos, part);
+	memcpy(data + part, spill->data, size - part);
+	spill->read_pos = (spill->read_pos + size) % spill->size;
+	spill->used -= size;
+}
+
+/* once the packet data held in memory exceeds the window, the data of new
+ * packets goes to the spill file and only the packet info stays queued */
+static bool spill_packet(struct obs_output *output, struct delay_data *dd,
+			 const struct encoder_packet *packet)
+{
+	struct delay_spill *spill = &output->delay_spill;
+	struct obs_output_delay_stats *stats = &output->delay_stats;
+	uint64_t start;
+
+	if (!spill->file)
+		return false;
+	if (stats->ram_bytes + packet->size <= spill->ram_window)
+		return false;
+
+	if (spill->used + packet->size > spill->size) {
+		stats->full_packets++;
+		if (!spill->full_logged) {
+			blog(LOG_WARNING,
+			     "Output '%s': Delay spill file is full, "
+			     "keeping delayed packets in memory",
+			     output->context.name);
+			spill->full_logged = true;
+		}
+		return false;
+	}
+
+	start = os_gettime_ns();
+	spill_write(spill, packet->data, packet->size);
+	stats->write_ns += os_gettime_ns() - start;
+
+	stats->bytes_written += packet->size;
+	stats->disk_bytes += packet->size;
+	stats->spilled_packets++;
+
+	dd->packet = *packet;
+	dd->packet.data = NULL;
+	dd->spilled = true;
+	return true;
+}
+
+/* gives a popped packet its data back */
+static void unspill_packet(struct obs_output *output, struct delay_data *dd)
+{
+	struct obs_output_delay_stats *stats = &output->delay_stats;
+	size_t size = dd->packet.size;
+	uint64_t start;
+	long *p_refs;
+
+	if (!dd->spilled) {
+		stats->ram_bytes -= size;
+		return;
+	}
+
+	/* same layout as obs_encoder_packet_create_instance */
+	p_refs = bmalloc(size + sizeof(long));
+	dd->packet.data = (void *)(p_refs + 1);
+	*p_refs = 1;
+
+	start = os_gettime_ns();
+	spill_read(&output->delay_spill, dd->packet.data, size);
+	stats->read_ns += os_gettime_ns() - start;
+
+	stats->bytes_read += size;
+	stats->disk_bytes -= size;
+	dd->spilled = false;
+}
+
 static inline void push_packet(struct obs_output *output,
 			       struct encoder_packet *packet, uint64_t t)
 {
@@ -51,9 +145,15 @@ static inline void push_packet(struct obs_output *output,
 
 	dd.msg = DELAY_MSG_PACKET;
 	dd.ts = t;
-	obs_encoder_packet_create_instance(&dd.packet, packet);
+	dd.spilled = false;
 
 	pthread_mutex_lock(&output->delay_mutex);
+
+	if (!spill_packet(output, &dd, packet)) {
+		obs_encoder_packet_ref(&dd.packet, packet);
+		output->delay_stats.ram_bytes += packet->size;
+	}
+
 	deque_push_back(&output->delay_data, &dd, sizeof(dd));
 	pthread_mutex_unlock(&output->delay_mutex);
 }
@@ -88,6 +188,11 @@ void obs_output_cleanup_delay(obs_output_t *output)
 		}
 	}
 
+	os_mapped_file_destroy(output->delay_spill.file);
+	memset(&output->delay_spill, 0, sizeof(output->delay_spill));
+	output->delay_stats.ram_bytes = 0;
+	output->delay_stats.disk_bytes = 0;
+
 	output->active_delay_ns = 0;
 	os_atomic_set_long(&output->delay_restart_refs, 0);
 }
@@ -114,6 +219,8 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 
 		} else if (elapsed_time > output->active_delay_ns) {
 			deque_pop_front(&output->delay_data, NULL, sizeof(dd));
+			if (dd.msg == DELAY_MSG_PACKET)
+				unspill_packet(output, &dd);
 			popped = true;
 		}
 	}
@@ -131,7 +238,7 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 void process_delay(void *data, struct encoder_packet *packet)
 {
 	struct obs_output *output = data;
-	uint64_t t = os_gettime_ns();
+	uint64_t t = obs_get_clock_time();
 	push_packet(output, packet, t);
 	while (pop_packet(output, t))
 		;
@@ -152,7 +259,7 @@ bool obs_output_delay_start(obs_output_t *output)
 {
 	struct delay_data dd = {
 		.msg = DELAY_MSG_START,
-		.ts = os_gettime_ns(),
+		.ts = obs_get_clock_time(),
 	};
 
 	if (!delay_active(output)) {
@@ -186,7 +293,7 @@ void obs_output_delay_stop(obs_output_t *output)
 {
 	struct delay_data dd = {
 		.msg = DELAY_MSG_STOP,
-		.ts = os_gettime_ns(),
+		.ts = obs_get_clock_time(),
 	};
 
 	pthread_mutex_lock(&output->delay_mutex);
@@ -221,3 +328,71 @@ uint32_t obs_output_get_active_delay(const obs_output_t *output)
 		       ? (uint32_t)(output->active_delay_ns / 1000000000ULL)
 		       : 0;
 }
+
+void obs_output_init_delay_spill(obs_output_t *output)
+{
+	struct delay_spill *spill = &output->delay_spill;
+	struct dstr path = {0};
+	char *uuid;
+
+	memset(&output->delay_stats, 0, sizeof(output->delay_stats));
+
+	if (!output->delay_spill_dir || spill->file)
+		return;
+
+	os_mkdirs(output->delay_spill_dir);
+
+	uuid = os_generate_uuid();
+	dstr_printf(&path, "%s/obs-delay-%s.tmp", output->delay_spill_dir,
+		    uuid);
+	bfree(uuid);
+
+	spill->file = os_mapped_file_create(path.array,
+					    (size_t)output->delay_spill_size);
+	if (!spill->file) {
+		blog(LOG_WARNING,
+		     "Output '%s': Failed to create delay spill file '%s', "
+		     "keeping delayed packets in memory",
+		     output->context.name, path.array);
+		dstr_free(&path);
+		return;
+	}
+
+	spill->data = os_mapped_file_get_data(spill->file);
+	spill->size = os_mapped_file_get_size(spill->file);
+	spill->ram_window = output->delay_spill_window;
+
+	blog(LOG_INFO,
+	     "Output '%s': Spilling delayed packets past %" PRIu64 " MB "
+	     "of memory to '%s' (%" PRIu64 " MB)",
+	     output->context.name, spill->ram_window / (1024 * 1024),
+	     path.array, (uint64_t)spill->size / (1024 * 1024));
+	dstr_free(&path);
+}
+
+void obs_output_set_delay_spill(obs_output_t *output, const char *dir,
+				uint64_t ram_window, uint64_t file_size)
+{
+	if (!obs_output_valid(output, "obs_output_set_delay_spill"))
+		return;
+	if (!log_flag_encoded(output, __FUNCTION__, false))
+		return;
+
+	bfree(output->delay_spill_dir);
+	output->delay_spill_dir =
+		(dir && *dir && file_size) ? bstrdup(dir) : NULL;
+	output->delay_spill_window = ram_window;
+	output->delay_spill_size = file_size;
+}
+
+bool obs_output_get_delay_stats(obs_output_t *output,
+				struct obs_output_delay_stats *stats)
+{
+	if (!obs_output_valid(output, "obs_output_get_delay_stats"))
+		return false;
+
+	pthread_mutex_lock(&output->delay_mutex);
+	*stats = output->delay_stats;
+	pthread_mutex_unlock(&output->delay_mutex);
+	return true;
+}
@@ -240,10 +240,7 @@ fail:
 
 static inline void free_packets(struct obs_output *output)
 {
-	for (size_t i = 0; i < output->interleaved_packets.num; i++)
-		obs_encoder_packet_release(output->interleaved_packets.array +
-					   i);
-	da_free(output->interleaved_packets);
+	interleave_free(&output->interleaved_packets);
 }
 
 static inline void clear_raw_audio_buffers(obs_output_t *output)
@@ -300,6 +297,8 @@ void obs_output_destroy(obs_output_t *output)
 		os_event_destroy(output->reconnect_stop_event);
 		obs_context_data_free(&output->context);
 		deque_free(&output->delay_data);
+		os_mapped_file_destroy(output->delay_spill.file);
+		bfree(output->delay_spill_dir);
 		deque_free(&output->caption_data);
 		if (output->owns_info_id)
 			bfree((void *)output->info.id);
@@ -494,7 +493,7 @@ void obs_output_stop(obs_output_t *output)
 		obs_output_delay_stop(output);
 	} else if (!stopping(output)) {
 		do_output_signal(output, "stopping");
-		obs_output_actual_stop(output, false, os_gettime_ns());
+		obs_output_actual_stop(output, false, obs_get_clock_time());
 	}
 }
 
@@ -613,7 +612,7 @@ static inline uint64_t get_closest_v_ts(struct pause_data *pause)
 {
 	uint64_t interval = obs->video.video_frame_interval_ns;
 	uint64_t i2 = interval * 2;
-	uint64_t ts = os_gettime_ns();
+	uint64_t ts = obs_get_clock_time();
 
 	return pause->last_video_ts +
 	       ((ts - pause->last_video_ts + i2) / interval) * interval;
@@ -1563,15 +1562,17 @@ double last_caption_timestamp = 0;
 
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
+	struct packet_interleaver *il = &output->interleaved_packets;
+	struct encoder_packet *next = interleave_peek(il);
+	struct encoder_packet out;
 
 	/* do not send an interleaved packet if there's no packet of the
 	 * opposing type of a higher timestamp in the interleave buffer.
 	 * this ensures that the timestamps are monotonic */
-	if (!has_higher_opposing_ts(output, &out))
+	if (!next || !has_higher_opposing_ts(output, next))
 		return;
 
-	da_erase(output->interleaved_packets, 0);
+	interleave_pop(il, &out);
 
 	if (out.type == OBS_ENCODER_VIDEO) {
 		output->total_frames++;
@@ -1623,37 +1624,57 @@ static inline void set_higher_ts(struct obs_output *output,
 	}
 }
 
-static inline struct encoder_packet *
-find_first_packet_type(struct obs_output *output, enum obs_encoder_type type,
-		       size_t audio_idx);
-static int find_first_packet_type_idx(struct obs_output *output,
-				      enum obs_encoder_type type,
-				      size_t audio_idx);
+static inline size_t get_packet_rank(struct obs_output *output,
+				     enum obs_encoder_type type,
+				     size_t track_idx, size_t idx)
+{
+	return interleave_rank(&output->interleaved_packets,
+			       interleave_queue_idx(type, track_idx), idx);
+}
 
 /* gets the point where audio and video are closest together */
 static size_t get_interleaved_start_idx(struct obs_output *output)
 {
+	struct packet_interleaver *il = &output->interleaved_packets;
 	int64_t closest_diff = 0x7FFFFFFFFFFFFFFFLL;
 	struct encoder_packet *first_video =
-		find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
+		interleave_first(il, OBS_ENCODER_VIDEO, 0);
 	size_t video_idx = DARRAY_INVALID;
 	size_t idx = 0;
 
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		int64_t diff;
+	if (first_video)
+		video_idx = get_packet_rank(output, OBS_ENCODER_VIDEO, 0, 0);
 
-		if (packet->type != OBS_ENCODER_AUDIO) {
-			if (packet == first_video)
-				video_idx = i;
-			continue;
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		size_t queue = interleave_queue_idx(OBS_ENCODER_AUDIO, i);
+		size_t num = interleave_queue_size(il, queue);
+		int64_t queue_diff = 0x7FFFFFFFFFFFFFFFLL;
+		size_t queue_idx = 0;
+		size_t rank;
+
+		/* audio packets of a track are in DTS order, so the closest
+		 * one is where the difference stops decreasing */
+		for (size_t j = 0; j < num; j++) {
+			struct encoder_packet *packet =
+				&interleave_get(il, queue, j)->packet;
+			int64_t diff =
+				llabs(packet->dts_usec - first_video->dts_usec);
+
+			if (diff > queue_diff)
+				break;
+			if (diff < queue_diff) {
+				queue_diff = diff;
+				queue_idx = j;
+			}
 		}
 
-		diff = llabs(packet->dts_usec - first_video->dts_usec);
-		if (diff < closest_diff) {
-			closest_diff = diff;
-			idx = i;
+		if (!num || queue_diff > closest_diff)
+			continue;
+
+		rank = interleave_rank(il, queue, queue_idx);
+		if (queue_diff < closest_diff || rank < idx) {
+			closest_diff = queue_diff;
+			idx = rank;
 		}
 	}
 
@@ -1669,38 +1690,37 @@ static int64_t get_encoder_duration(struct obs_encoder *encoder)
 static int prune_premature_packets(struct obs_output *output)
 {
 	struct encoder_packet *video;
-	int video_idx;
-	int max_idx;
+	size_t max_idx;
 	int64_t duration_usec, max_audio_duration_usec = 0;
 	int64_t max_diff = 0;
 	int64_t diff = 0;
 	int audio_encoders = 0;
 
-	video_idx = find_first_packet_type_idx(output, OBS_ENCODER_VIDEO, 0);
-	if (video_idx == -1)
+	video = interleave_first(&output->interleaved_packets,
+				 OBS_ENCODER_VIDEO, 0);
+	if (!video)
 		return -1;
 
-	max_idx = video_idx;
-	video = &output->interleaved_packets.array[video_idx];
+	max_idx = get_packet_rank(output, OBS_ENCODER_VIDEO, 0, 0);
 	duration_usec = video->timebase_num * 1000000LL / video->timebase_den;
 
 	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
 		struct encoder_packet *audio;
-		int audio_idx;
+		size_t audio_idx;
 		int64_t audio_duration_usec = 0;
 
 		if (!output->audio_encoders[i])
 			continue;
 		audio_encoders++;
 
-		audio_idx = find_first_packet_type_idx(output,
-						       OBS_ENCODER_AUDIO, i);
-		if (audio_idx == -1) {
+		audio = interleave_first(&output->interleaved_packets,
+					 OBS_ENCODER_AUDIO, i);
+		if (!audio) {
 			output->received_audio = false;
 			return -1;
 		}
 
-		audio = &output->interleaved_packets.array[audio_idx];
+		audio_idx = get_packet_rank(output, OBS_ENCODER_AUDIO, i, 0);
 		if (audio_idx > max_idx)
 			max_idx = audio_idx;
 
@@ -1724,18 +1744,12 @@ static int prune_premature_packets(struct obs_output *output)
 		duration_usec = max_audio_duration_usec;
 	}
 
-	return diff > duration_usec ? max_idx + 1 : 0;
+	return diff > duration_usec ? (int)max_idx + 1 : 0;
 }
 
-static void discard_to_idx(struct obs_output *output, size_t idx)
+static inline void discard_to_idx(struct obs_output *output, size_t idx)
 {
-	for (size_t i = 0; i < idx; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		obs_encoder_packet_release(packet);
-	}
-
-	da_erase_range(output->interleaved_packets, 0, idx);
+	interleave_discard(&output->interleaved_packets, idx);
 }
 
 #define DEBUG_STARTING_PACKETS 0
@@ -1747,13 +1761,21 @@ static bool prune_interleaved_packets(struct obs_output *output)
 
 #if DEBUG_STARTING_PACKETS == 1
 	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune_start);
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
-		     packet->type == OBS_ENCODER_AUDIO ? "audio" : "video",
-		     (int)packet->track_idx, packet->dts_usec,
-		     (int)i < prune_start ? "true" : "false");
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		struct packet_interleaver *il = &output->interleaved_packets;
+
+		for (size_t j = 0; j < interleave_queue_size(il, i); j++) {
+			struct encoder_packet *packet =
+				&interleave_get(il, i, j)->packet;
+			int rank = (int)interleave_rank(il, i, j);
+
+			blog(LOG_DEBUG,
+			     "packet: %s %d, ts: %lld, pruned = %s",
+			     packet->type == OBS_ENCODER_AUDIO ? "audio"
+							       : "video",
+			     (int)packet->track_idx, packet->dts_usec,
+			     rank < prune_start ? "true" : "false");
+		}
 	}
 #endif
 
@@ -1771,48 +1793,18 @@ static bool prune_interleaved_packets(struct obs_output *output)
 	return true;
 }
 
-static int find_first_packet_type_idx(struct obs_output *output,
-				      enum obs_encoder_type type, size_t idx)
-{
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-
-		if (packet->type == type && packet->track_idx == idx)
-			return (int)i;
-	}
-
-	return -1;
-}
-
-static int find_last_packet_type_idx(struct obs_output *output,
-				     enum obs_encoder_type type, size_t idx)
-{
-	for (size_t i = output->interleaved_packets.num; i > 0; i--) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i - 1];
-
-		if (packet->type == type && packet->track_idx == idx)
-			return (int)(i - 1);
-	}
-
-	return -1;
-}
-
 static inline struct encoder_packet *
 find_first_packet_type(struct obs_output *output, enum obs_encoder_type type,
 		       size_t audio_idx)
 {
-	int idx = find_first_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
+	return interleave_first(&output->interleaved_packets, type, audio_idx);
 }
 
 static inline struct encoder_packet *
 find_last_packet_type(struct obs_output *output, enum obs_encoder_type type,
 		      size_t audio_idx)
 {
-	int idx = find_last_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
+	return interleave_last(&output->interleaved_packets, type, audio_idx);
 }
 
 static bool get_audio_and_video_packets(struct obs_output *output,
@@ -1920,11 +1912,19 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 			output->highest_video_ts[i] -= video[i]->dts_usec;
 	}
 
+	/* keep the current order of packets with equal timestamps once the
+	 * offsets are applied */
+	interleave_renumber(&output->interleaved_packets);
+
 	/* apply new offsets to all existing packet DTS/PTS values */
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		apply_interleaved_packet_offset(output, packet);
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		struct packet_interleaver *il = &output->interleaved_packets;
+
+		for (size_t j = 0; j < interleave_queue_size(il, i); j++) {
+			struct encoder_packet *packet =
+				&interleave_get(il, i, j)->packet;
+			apply_interleaved_packet_offset(output, packet);
+		}
 	}
 
 	return true;
@@ -1933,60 +1933,20 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 static inline void insert_interleaved_packet(struct obs_output *output,
 					     struct encoder_packet *out)
 {
-	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
-
-		// sort video packets with same DTS by track index,
-		// to prevent the pruning logic from removing additional
-		// video tracks
-		if (out->dts_usec == cur_packet->dts_usec &&
-		    out->type == OBS_ENCODER_VIDEO &&
-		    cur_packet->type == OBS_ENCODER_VIDEO &&
-		    out->track_idx > cur_packet->track_idx)
-			continue;
-
-		if (out->dts_usec == cur_packet->dts_usec &&
-		    out->type == OBS_ENCODER_VIDEO) {
-			break;
-		} else if (out->dts_usec < cur_packet->dts_usec) {
-			break;
-		}
-	}
-
-	da_insert(output->interleaved_packets, idx, out);
+	/* video packets with the same DTS are sorted by track index to
+	 * prevent the pruning logic from removing additional video tracks */
+	interleave_push(&output->interleaved_packets, out);
 }
 
-static void resort_interleaved_packets(struct obs_output *output)
+static inline void resort_interleaved_packets(struct obs_output *output)
 {
-	DARRAY(struct encoder_packet) old_array;
-
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0,
-	       sizeof(output->interleaved_packets));
-
-	for (size_t i = 0; i < old_array.num; i++)
-		insert_interleaved_packet(output, &old_array.array[i]);
-
-	da_free(old_array);
+	interleave_reheap(&output->interleaved_packets);
 }
 
-static void discard_unused_audio_packets(struct obs_output *output,
-					 int64_t dts_usec)
+static inline void discard_unused_audio_packets(struct obs_output *output,
+						int64_t dts_usec)
 {
-	size_t idx = 0;
-
-	for (; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *p =
-			&output->interleaved_packets.array[idx];
-
-		if (p->dts_usec >= dts_usec)
-			break;
-	}
-
-	if (idx)
-		discard_to_idx(output, idx);
+	interleave_discard_before(&output->interleaved_packets, dts_usec);
 }
 
 static void interleave_packets(void *data, struct encoder_packet *packet)
@@ -2026,7 +1986,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	if (output->active_delay_ns)
 		out = *packet;
 	else
-		obs_encoder_packet_create_instance(&out, packet);
+		obs_encoder_packet_ref(&out, packet);
 
 	if (was_started)
 		apply_interleaved_packet_offset(output, &out);
@@ -2068,10 +2028,14 @@ static void default_encoded_callback(void *param, struct encoder_packet *packet)
 	if (data_active(output)) {
 		packet->track_idx = get_encoder_index(output, packet);
 
+		/* audio encoders of different tracks output packets from
+		 * different threads, outputs expect them one at a time */
+		pthread_mutex_lock(&output->interleaved_mutex);
 		output->info.encoded_packet(output->context.data, packet);
 
 		if (packet->type == OBS_ENCODER_VIDEO)
 			output->total_frames++;
+		pthread_mutex_unlock(&output->interleaved_mutex);
 	}
 
 	if (output->active_delay_ns)
@@ -2139,6 +2103,7 @@ static void default_raw_audio_callback(void *param, size_t mix_idx,
 {
 	struct obs_output *output = param;
 	struct audio_data out;
+	uint32_t frames = audio_output_get_frames_per_tick(output->audio);
 	size_t frame_size_bytes;
 
 	if (!data_active(output))
@@ -2154,7 +2119,7 @@ static void default_raw_audio_callback(void *param, size_t mix_idx,
 		output->audio_start_ts = out.timestamp;
 	}
 
-	frame_size_bytes = AUDIO_OUTPUT_FRAMES * output->audio_size;
+	frame_size_bytes = frames * output->audio_size;
 
 	for (size_t i = 0; i < output->planes; i++)
 		deque_push_back(&output->audio_buffer[mix_idx][i], out.data[i],
@@ -2170,7 +2135,7 @@ static void default_raw_audio_callback(void *param, size_t mix_idx,
 			out.data[i] = (uint8_t *)output->audio_data[i];
 		}
 
-		out.frames = AUDIO_OUTPUT_FRAMES;
+		out.frames = frames;
 		out.timestamp = output->audio_start_ts +
 				audio_frames_to_ns(output->sample_rate,
 						   output->total_audio_frames);
@@ -2179,7 +2144,7 @@ static void default_raw_audio_callback(void *param, size_t mix_idx,
 		out.timestamp += output->pause.ts_offset;
 		pthread_mutex_unlock(&output->pause.mutex);
 
-		output->total_audio_frames += AUDIO_OUTPUT_FRAMES;
+		output->total_audio_frames += frames;
 
 		if (output->info.raw_audio2)
 			output->info.raw_audio2(output->context.data, mix_idx,
@@ -2270,6 +2235,7 @@ static void hook_data_capture(struct obs_output *output)
 				(uint64_t)output->delay_sec * 1000000000ULL;
 			output->delay_cur_flags = output->delay_flags;
 			output->delay_callback = encoded_callback;
+			obs_output_init_delay_spill(output);
 			encoded_callback = process_delay;
 			os_atomic_set_bool(&output->delay_active, true);
 
@@ -1385,7 +1385,7 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item,
 		new_frame_num = util_mul_div64(timestamp - ts, sample_rate,
 					       1000000000ULL);
 
-		if (ts && new_frame_num >= AUDIO_OUTPUT_FRAMES)
+		if (ts && new_frame_num >= obs->audio.frames_per_tick)
 			break;
 
 		da_erase(item->audio_actions, i--);
@@ -1403,7 +1403,7 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item,
 	}
 
 	if (buf) {
-		for (; frame_num < AUDIO_OUTPUT_FRAMES; frame_num++)
+		for (; frame_num < obs->audio.frames_per_tick; frame_num++)
 			buf[frame_num] = cur_visible ? 1.0f : 0.0f;
 	}
 
@@ -1432,7 +1432,7 @@ static bool apply_scene_item_volume(struct obs_scene_item *item, float *buf,
 	pthread_mutex_unlock(&item->actions_mutex);
 
 	if (actions_pending) {
-		uint64_t duration = util_mul_div64(AUDIO_OUTPUT_FRAMES,
+		uint64_t duration = util_mul_div64(obs->audio.frames_per_tick,
 						   1000000000ULL, sample_rate);
 
 		if (!ts || action.timestamp < (ts + duration)) {
@@ -1452,27 +1452,16 @@ static void process_all_audio_actions(struct obs_scene_item *item,
 		;
 }
 
-static void mix_audio_with_buf(float *p_out, float *p_in, float *buf_in,
-			       size_t pos, size_t count)
+static inline void mix_audio_with_buf(float *p_out, float *p_in,
+				      float *buf_in, size_t pos, size_t count)
 {
-	register float *out = p_out + pos;
-	register float *buf = buf_in;
-	register float *in = p_in;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++) * *(buf++);
+	obs->audio.kernels->mix_mul(p_out + pos, p_in, buf_in, count);
 }
 
 static inline void mix_audio(float *p_out, float *p_in, size_t pos,
 			     size_t count)
 {
-	register float *out = p_out + pos;
-	register float *in = p_in;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++);
+	obs->audio.kernels->mix(p_out + pos, p_in, count);
 }
 
 static bool scene_audio_render(void *data, uint64_t *ts_out,
@@ -1482,6 +1471,7 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 {
 	uint64_t timestamp = 0;
 	float buf[AUDIO_OUTPUT_FRAMES];
+	size_t frames = obs->audio.frames_per_tick;
 	struct obs_source_audio_mix child_audio;
 	struct obs_scene *scene = data;
 	struct obs_scene_item *item;
@@ -1511,6 +1501,9 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 		item = item->next;
 	}
 
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++)
+		audio_output->output[mix].silent = true;
+
 	if (!timestamp) {
 		/* just process all pending audio actions if no audio playing,
 		 * otherwise audio actions will just never be processed */
@@ -1555,12 +1548,12 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 		pos = (size_t)ns_to_audio_frames(sample_rate,
 						 source_ts - timestamp);
 
-		if (pos >= AUDIO_OUTPUT_FRAMES) {
+		if (pos >= frames) {
 			item = item->next;
 			continue;
 		}
 
-		count = AUDIO_OUTPUT_FRAMES - pos;
+		count = frames - pos;
 
 		if (!apply_buf && !item->visible &&
 		    !transition_active(item->hide_transition)) {
@@ -1573,6 +1566,10 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 			if ((mixers & (1 << mix)) == 0)
 				continue;
+			if (child_audio.output[mix].silent)
+				continue;
+
+			audio_output->output[mix].silent = false;
 
 			for (size_t ch = 0; ch < channels; ch++) {
 				float *out = audio_output->output[mix].data[ch];
@@ -2178,7 +2175,7 @@ static obs_sceneitem_t *obs_scene_add_internal(obs_scene_t *scene,
 	pthread_mutex_t mutex;
 
 	struct item_action action = {.visible = true,
-				     .timestamp = os_gettime_ns()};
+				     .timestamp = obs_get_clock_time()};
 
 	if (!scene)
 		return NULL;
@@ -2935,7 +2932,7 @@ bool obs_sceneitem_set_visible(obs_sceneitem_t *item, bool visible)
 	struct calldata cd;
 	uint8_t stack[256];
 	struct item_action action = {.visible = visible,
-				     .timestamp = os_gettime_ns()};
+				     .timestamp = obs_get_clock_time()};
 
 	if (!item)
 		return false;
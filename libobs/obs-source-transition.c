@@ -397,7 +397,7 @@ bool obs_transition_start(obs_source_t *transition,
 		duration_ms = transition->transition_fixed_duration;
 
 	if (!active || (!same_as_dest && !same_as_source)) {
-		transition->transition_start_time = os_gettime_ns();
+		transition->transition_start_time = obs_get_clock_time();
 		transition->transition_duration =
 			(uint64_t)duration_ms * 1000000ULL;
 	}
@@ -967,7 +967,7 @@ static void process_audio(obs_source_t *transition, obs_source_t *child,
 	obs_source_get_audio_mix(child, &child_audio);
 	pos = (size_t)ns_to_audio_frames(sample_rate, ts - min_ts);
 
-	if (pos > AUDIO_OUTPUT_FRAMES)
+	if (pos > obs->audio.frames_per_tick)
 		return;
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
@@ -982,12 +982,28 @@ static void process_audio(obs_source_t *transition, obs_source_t *child,
 			float *in = input->data[ch];
 
 			mix_child(transition, out + pos, in,
-				  AUDIO_OUTPUT_FRAMES - pos, sample_rate, ts,
-				  mix);
+				  obs->audio.frames_per_tick - pos,
+				  sample_rate, ts, mix);
 		}
 	}
 }
 
+static void copy_audio(obs_source_t *child,
+		       struct obs_source_audio_mix *audio, uint32_t mixers,
+		       size_t channels)
+{
+	size_t size = obs->audio.frames_per_tick * sizeof(float);
+
+	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+		if ((mixers & (1 << mix_idx)) == 0)
+			continue;
+
+		for (size_t ch = 0; ch < channels; ch++)
+			memcpy(audio->output[mix_idx].data[ch],
+			       child->audio_output_buf[mix_idx][ch], size);
+	}
+}
+
 static inline uint64_t calc_min_ts(obs_source_t *sources[2])
 {
 	uint64_t min_ts = 0;
@@ -1067,9 +1083,7 @@ bool obs_transition_audio_render(obs_source_t *transition, uint64_t *ts_out,
 					      min_ts, mixers, channels,
 					      sample_rate, mix_b);
 		} else if (state.s[0]) {
-			memcpy(audio->output[0].data[0],
-			       state.s[0]->audio_output_buf[0][0],
-			       TOTAL_AUDIO_SIZE);
+			copy_audio(state.s[0], audio, mixers, channels);
 		}
 
 		obs_source_release(state.s[0]);
@@ -135,20 +135,46 @@ const char *obs_source_get_display_name(const char *id)
 	return (info != NULL) ? info->get_name(info->type_data) : NULL;
 }
 
-static void allocate_audio_output_buffer(struct obs_source *source)
+#define ALL_AUDIO_MIXES ((1 << MAX_AUDIO_MIXES) - 1)
+
+/* mixes a source isn't routed to point here, it is never written to */
+static float silent_audio_output_buf[MAX_AUDIO_CHANNELS * AUDIO_OUTPUT_FRAMES];
+
+/* only allocates the mixes the source is routed to.  mix 0 is always
+ * allocated as it is also used to stage the source's input data. */
+static void allocate_audio_output_buffer(struct obs_source *source,
+					 uint32_t mixers)
 {
-	size_t size = sizeof(float) * AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS *
-		      MAX_AUDIO_MIXES;
-	float *ptr = bzalloc(size);
+	size_t mix_size = AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS;
+	float *old = source->audio_output_buf[0][0];
+	size_t count = 0;
+	float *ptr;
+
+	mixers = (mixers & ALL_AUDIO_MIXES) | 1;
+
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((mixers & (1 << mix)) != 0)
+			count++;
+	}
+
+	ptr = bzalloc(sizeof(float) * mix_size * count);
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		size_t mix_pos = mix * AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS;
+		float *mix_ptr = silent_audio_output_buf;
+
+		if ((mixers & (1 << mix)) != 0) {
+			mix_ptr = ptr;
+			ptr += mix_size;
+		}
 
 		for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
 			source->audio_output_buf[mix][i] =
-				ptr + mix_pos + AUDIO_OUTPUT_FRAMES * i;
+				mix_ptr + AUDIO_OUTPUT_FRAMES * i;
 		}
 	}
+
+	source->audio_buf_mixers = mixers;
+	bfree(old);
 }
 
 static void allocate_audio_mix_buffer(struct obs_source *source)
@@ -213,7 +239,7 @@ static bool obs_source_init(struct obs_source *source)
 		return false;
 
 	if (is_audio_source(source) || is_composite_source(source))
-		allocate_audio_output_buffer(source);
+		allocate_audio_output_buffer(source, 0);
 	if (source->info.audio_mix)
 		allocate_audio_mix_buffer(source);
 
@@ -243,6 +269,7 @@ static void obs_source_init_finalize(struct obs_source *source)
 			obs->data.first_audio_source->prev_next_audio_source =
 				&source->next_audio_source;
 		obs->data.first_audio_source = source;
+		obs_audio_sources_changed();
 
 		pthread_mutex_unlock(&obs->data.audio_sources_mutex);
 	}
@@ -254,6 +281,9 @@ static void obs_source_init_finalize(struct obs_source *source)
 	}
 	obs_context_data_insert_uuid(&source->context, &obs->data.sources_mutex,
 				     &obs->data.sources);
+
+	/* ticked at least once, pruned afterwards if it doesn't need it */
+	obs_source_request_tick(source);
 }
 
 static bool obs_source_hotkey_mute(void *data, obs_hotkey_pair_id id,
@@ -289,7 +319,7 @@ static bool obs_source_hotkey_unmute(void *data, obs_hotkey_pair_id id,
 static void obs_source_hotkey_push_to_mute(void *data, obs_hotkey_id id,
 					   obs_hotkey_t *key, bool pressed)
 {
-	struct audio_action action = {.timestamp = os_gettime_ns(),
+	struct audio_action action = {.timestamp = obs_get_clock_time(),
 				      .type = AUDIO_ACTION_PTM,
 				      .set = pressed};
 
@@ -308,7 +338,7 @@ static void obs_source_hotkey_push_to_mute(void *data, obs_hotkey_id id,
 static void obs_source_hotkey_push_to_talk(void *data, obs_hotkey_id id,
 					   obs_hotkey_t *key, bool pressed)
 {
-	struct audio_action action = {.timestamp = os_gettime_ns(),
+	struct audio_action action = {.timestamp = obs_get_clock_time(),
 				      .type = AUDIO_ACTION_PTT,
 				      .set = pressed};
 
@@ -583,6 +613,7 @@ obs_source_t *obs_source_duplicate(obs_source_t *source, const char *new_name,
 
 	new_source->audio_mixers = source->audio_mixers;
 	new_source->sync_offset = source->sync_offset;
+	new_source->jitter_max = source->jitter_max;
 	new_source->user_volume = source->user_volume;
 	new_source->user_muted = source->user_muted;
 	new_source->volume = source->volume;
@@ -618,10 +649,29 @@ void obs_source_frame_init(struct obs_source_frame *frame,
 	}
 }
 
-static inline void obs_source_frame_decref(struct obs_source_frame *frame)
+/* call with async_mutex locked */
+static void release_async_frame(obs_source_t *source,
+				struct obs_source_frame *frame)
+{
+	for (size_t i = 0; i < source->async_lent_frames.num; i++) {
+		struct lent_frame lf = source->async_lent_frames.array[i];
+
+		if (lf.frame == frame) {
+			da_erase(source->async_lent_frames, i);
+			bfree(frame);
+			lf.release(lf.param);
+			return;
+		}
+	}
+
+	obs_frame_pool_release(frame);
+}
+
+static inline void obs_source_frame_decref(obs_source_t *source,
+					   struct obs_source_frame *frame)
 {
 	if (os_atomic_dec_long(&frame->refs) == 0)
-		obs_source_frame_destroy(frame);
+		release_async_frame(source, frame);
 }
 
 static bool obs_source_filter_remove_refless(obs_source_t *source,
@@ -660,9 +710,17 @@ void obs_source_destroy(struct obs_source *source)
 		if (source->next_audio_source)
 			source->next_audio_source->prev_next_audio_source =
 				source->prev_next_audio_source;
+		obs_audio_sources_changed();
 	}
 	pthread_mutex_unlock(&obs->data.audio_sources_mutex);
 
+	pthread_mutex_lock(&obs->data.tick_list_mutex);
+	if (source->in_tick_list) {
+		da_erase_item(obs->data.tick_list, &source);
+		source->in_tick_list = false;
+	}
+	pthread_mutex_unlock(&obs->data.tick_list_mutex);
+
 	if (source->filter_parent)
 		obs_source_filter_remove_refless(source->filter_parent, source);
 
@@ -679,6 +737,8 @@ void obs_source_destroy(struct obs_source *source)
 				 (os_task_t)obs_source_destroy_defer, source);
 }
 
+static inline void free_async_cache(struct obs_source *source);
+
 static void obs_source_destroy_defer(struct obs_source *source)
 {
 	size_t i;
@@ -689,6 +749,12 @@ static void obs_source_destroy_defer(struct obs_source *source)
 
 	obs_source_dosignal(source, "source_destroy", "destroy");
 
+	/* frames lent through obs_source_output_video_ref have to be handed
+	 * back while the source still exists */
+	pthread_mutex_lock(&source->async_mutex);
+	free_async_cache(source);
+	pthread_mutex_unlock(&source->async_mutex);
+
 	if (source->context.data) {
 		source->info.destroy(source->context.data);
 		source->context.data = NULL;
@@ -704,7 +770,8 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	obs_hotkey_pair_unregister(source->mute_unmute_key);
 
 	for (i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+		obs_source_frame_decref(source,
+					source->async_cache.array[i].frame);
 
 	gs_enter_context(obs->video.graphics);
 	if (source->async_texrender)
@@ -739,6 +806,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	da_free(source->caption_cb_list);
 	da_free(source->async_cache);
 	da_free(source->async_frames);
+	da_free(source->async_lent_frames);
 	da_free(source->filters);
 	da_free(source->media_actions);
 	pthread_mutex_destroy(&source->filter_mutex);
@@ -997,6 +1065,7 @@ void obs_source_update(obs_source_t *source, obs_data_t *settings)
 
 	if (source->info.output_flags & OBS_SOURCE_VIDEO) {
 		os_atomic_inc_long(&source->defer_update_count);
+		obs_source_request_tick(source);
 	} else if (source->context.data && source->info.update) {
 		source->info.update(source->context.data,
 				    source->context.settings);
@@ -1135,6 +1204,7 @@ static void activate_tree(obs_source_t *parent, obs_source_t *child,
 			  void *param)
 {
 	os_atomic_inc_long(&child->activate_refs);
+	obs_source_request_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1152,6 +1222,7 @@ static void deactivate_tree(obs_source_t *parent, obs_source_t *child,
 static void show_tree(obs_source_t *parent, obs_source_t *child, void *param)
 {
 	os_atomic_inc_long(&child->show_refs);
+	obs_source_request_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1171,6 +1242,7 @@ void obs_source_activate(obs_source_t *source, enum view_type type)
 		return;
 
 	os_atomic_inc_long(&source->show_refs);
+	obs_source_request_tick(source);
 	obs_source_enum_active_tree(source, show_tree, NULL);
 
 	if (type == MAIN_VIEW) {
@@ -1198,6 +1270,47 @@ void obs_source_deactivate(obs_source_t *source, enum view_type type)
 	}
 }
 
+/* adds the source to the list of sources that are ticked each frame, it's
+ * pruned from the list by the graphics thread once it no longer needs to be
+ * ticked.  the state that makes it need ticking must be set before calling
+ * this, see obs_source_needs_tick */
+void obs_source_request_tick(obs_source_t *source)
+{
+	struct obs_core_data *data = &obs->data;
+
+	pthread_mutex_lock(&data->tick_list_mutex);
+	if (!source->in_tick_list) {
+		source->in_tick_list = true;
+		da_push_back(data->tick_list, &source);
+	}
+	pthread_mutex_unlock(&data->tick_list_mutex);
+}
+
+/* call with tick_list_mutex locked, on the graphics thread */
+bool obs_source_needs_tick(obs_source_t *source)
+{
+	const uint32_t always_tick = OBS_SOURCE_ASYNC | OBS_SOURCE_ALWAYS_TICK;
+	bool pending_actions;
+
+	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION ||
+	    (source->info.output_flags & always_tick) != 0)
+		return true;
+
+	/* still showing or active, or needs a tick to hide/deactivate */
+	if (source->showing || source->active ||
+	    os_atomic_load_long(&source->show_refs) > 0 ||
+	    os_atomic_load_long(&source->activate_refs) > 0)
+		return true;
+
+	if (os_atomic_load_long(&source->defer_update_count) > 0)
+		return true;
+
+	pthread_mutex_lock(&source->media_actions_mutex);
+	pending_actions = source->media_actions.num > 0;
+	pthread_mutex_unlock(&source->media_actions_mutex);
+	return pending_actions;
+}
+
 static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 							 uint64_t sys_time);
 
@@ -1298,12 +1411,14 @@ static void async_tick(obs_source_t *source)
 	pthread_mutex_unlock(&source->async_mutex);
 }
 
-void obs_source_video_tick(obs_source_t *source, float seconds)
+/* everything that has to happen on the graphics thread before the
+ * video_tick callback is called, returns false if there's nothing to tick */
+bool obs_source_video_tick_prepare(obs_source_t *source, float seconds)
 {
 	bool now_showing, now_active;
 
 	if (!obs_source_valid(source, "obs_source_video_tick"))
-		return;
+		return false;
 
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_tick(source, seconds);
@@ -1369,13 +1484,38 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 		source->active = now_active;
 	}
 
-	if (source->context.data && source->info.video_tick)
+	return true;
+}
+
+/* can be called on a tick worker thread for sources with the
+ * OBS_SOURCE_PARALLEL_TICK flag */
+void obs_source_video_tick_call(obs_source_t *source, float seconds)
+{
+	if (source->context.data && source->info.video_tick) {
+		/* reset when the source is renamed */
+		const char *name = source->profile_tick_name;
+		if (!name) {
+			name = profile_store_name(obs_get_profiler_name_store(),
+						  "video_tick(%s)",
+						  source->context.name);
+			source->profile_tick_name = name;
+		}
+
+		profile_start(name);
 		source->info.video_tick(source->context.data, seconds);
+		profile_end(name);
+	}
 
 	source->async_rendered = false;
 	source->deinterlace_rendered = false;
 }
 
+void obs_source_video_tick(obs_source_t *source, float seconds)
+{
+	if (obs_source_video_tick_prepare(source, seconds))
+		obs_source_video_tick_call(source, seconds);
+}
+
 /* unless the value is 3+ hours worth of frames, this won't overflow */
 static inline uint64_t conv_frames_to_time(const size_t sample_rate,
 					   const size_t frames)
@@ -1399,11 +1539,22 @@ static inline size_t conv_time_to_frames(const size_t sample_rate,
  * possible */
 #define TS_SMOOTHING_THRESHOLD 70000000ULL
 
+/* jitter buffer tuning, times are in nanoseconds.  lateness is averaged
+ * over JITTER_MEAN_TIME, drift is corrected over JITTER_CORRECTION_TIME
+ * with at most JITTER_MAX_COMPENSATION (0.1%) of resampling, and the
+ * lateness peak decays by JITTER_PEAK_DECAY of the elapsed time */
+#define JITTER_MEAN_TIME 5000000000.0
+#define JITTER_CORRECTION_TIME 10000000000.0
+#define JITTER_MAX_COMPENSATION 0.001
+#define JITTER_PEAK_DECAY 0.01
+#define JITTER_MARGIN 5000000.0
+
 static inline void reset_audio_timing(obs_source_t *source, uint64_t timestamp,
 				      uint64_t os_time)
 {
 	source->timing_set = true;
 	source->timing_adjust = os_time - timestamp;
+	source->jitter_init = false;
 }
 
 static void reset_audio_data(obs_source_t *source, uint64_t os_time)
@@ -1534,14 +1685,82 @@ static inline bool source_muted(obs_source_t *source, uint64_t os_time)
 	       (source->push_to_talk_enabled && !push_to_talk_active);
 }
 
+/* lateness is how long after the end of its data (in system time) a packet
+ * arrives.  its slow moving average drifts when the clock of the source runs
+ * at a different rate than ours, which is corrected by slightly resampling
+ * the source.  how far it peaks above the average is the jitter the delay
+ * has to cover, on top of what global buffering already covers. */
+static uint64_t update_jitter_buffer(obs_source_t *source, uint64_t os_time,
+				     uint64_t duration, size_t sample_rate)
+{
+	double lateness =
+		(double)(int64_t)(os_time - source->next_audio_sys_ts_min);
+	double elapsed = (double)duration;
+	double alpha = elapsed / JITTER_MEAN_TIME;
+	double comp, target, buffered;
+
+	if (!source->jitter_init) {
+		source->jitter_init = true;
+		source->jitter_mean = lateness;
+		source->jitter_base = lateness;
+		source->jitter_settle = 0.0;
+		source->jitter_peak = 0.0;
+		source->jitter_comp = 0.0;
+	}
+
+	source->jitter_mean += (lateness - source->jitter_mean) *
+			       (alpha < 1.0 ? alpha : 1.0);
+
+	source->jitter_peak -= elapsed * JITTER_PEAK_DECAY;
+	if (source->jitter_peak < lateness - source->jitter_mean)
+		source->jitter_peak = lateness - source->jitter_mean;
+	if (source->jitter_peak < 0.0)
+		source->jitter_peak = 0.0;
+
+	/* measure drift against the average once it has settled */
+	if (source->jitter_settle < JITTER_MEAN_TIME) {
+		source->jitter_settle += elapsed;
+		if (source->jitter_settle >= JITTER_MEAN_TIME)
+			source->jitter_base = source->jitter_mean;
+	} else {
+		comp = (source->jitter_mean - source->jitter_base) /
+		       JITTER_CORRECTION_TIME;
+		if (comp > JITTER_MAX_COMPENSATION)
+			comp = JITTER_MAX_COMPENSATION;
+		else if (comp < -JITTER_MAX_COMPENSATION)
+			comp = -JITTER_MAX_COMPENSATION;
+		source->jitter_comp = comp;
+	}
+
+	buffered = (double)audio_frames_to_ns(
+		sample_rate, (uint64_t)obs->audio.total_buffering_ticks *
+				     obs->audio.frames_per_tick);
+
+	target = source->jitter_mean + source->jitter_peak + JITTER_MARGIN -
+		 buffered;
+	if (target < 0.0)
+		target = 0.0;
+	if (target > (double)source->jitter_max)
+		target = (double)source->jitter_max;
+
+	/* grow right away, only shrink once well above what's needed since
+	 * every change of the delay is a small discontinuity */
+	if (target > (double)source->jitter_delay ||
+	    target < (double)source->jitter_delay / 2.0)
+		source->jitter_delay = (uint64_t)target;
+
+	return source->jitter_delay;
+}
+
 static void source_output_audio_data(obs_source_t *source,
 				     const struct audio_data *data)
 {
 	size_t sample_rate = audio_output_get_sample_rate(obs->audio.audio);
 	struct audio_data in = *data;
 	uint64_t diff;
-	uint64_t os_time = os_gettime_ns();
+	uint64_t os_time = obs_get_clock_time();
 	int64_t sync_offset;
+	uint64_t jitter_delay;
 	bool using_direct_ts = false;
 	bool push_back = false;
 
@@ -1612,12 +1831,31 @@ static void source_output_audio_data(obs_source_t *source,
 	source->next_audio_sys_ts_min =
 		source->next_audio_ts_min + source->timing_adjust;
 
+	source->audio_lateness =
+		(int64_t)(os_time - source->next_audio_sys_ts_min);
+	if (source->audio_lateness > source->audio_max_lateness)
+		source->audio_max_lateness = source->audio_lateness;
+
 	if (source->last_sync_offset != sync_offset) {
 		if (source->last_sync_offset)
 			push_back = false;
 		source->last_sync_offset = sync_offset;
 	}
 
+	jitter_delay = source->jitter_max
+			       ? update_jitter_buffer(
+					 source, os_time,
+					 conv_frames_to_time(sample_rate,
+							     in.frames),
+					 sample_rate)
+			       : 0;
+	if (source->last_jitter_delay != jitter_delay) {
+		push_back = false;
+		source->last_jitter_delay = jitter_delay;
+	}
+
+	in.timestamp += jitter_delay;
+
 	if (source->monitoring_type != OBS_MONITORING_TYPE_MONITOR_ONLY) {
 		if (push_back && source->audio_ts)
 			source_output_audio_push_back(source, &in);
@@ -3605,7 +3843,8 @@ static inline bool async_texture_changed(struct obs_source *source,
 static inline void free_async_cache(struct obs_source *source)
 {
 	for (size_t i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+		obs_source_frame_decref(source,
+					source->async_cache.array[i].frame);
 
 	da_resize(source->async_cache, 0);
 	da_resize(source->async_frames, 0);
@@ -3615,35 +3854,45 @@ static inline void free_async_cache(struct obs_source *source)
 
 #define MAX_UNUSED_FRAME_DURATION 5
 
-/* frees frame allocations if they haven't been used for a specific period
- * of time */
+/* hands frames back to the frame pool if they haven't been used for a
+ * specific period of time, the pool decides when to actually free them */
 static void clean_cache(obs_source_t *source)
 {
 	for (size_t i = source->async_cache.num; i > 0; i--) {
 		struct async_frame *af = &source->async_cache.array[i - 1];
-		if (!af->used) {
+		if (!af->used && !af->lent) {
 			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
-				obs_source_frame_destroy(af->frame);
+				obs_source_frame_decref(source, af->frame);
 				da_erase(source->async_cache, i - 1);
 			}
 		}
 	}
 }
 
-#define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
-static inline struct obs_source_frame *
-cache_video(struct obs_source *source, const struct obs_source_frame *frame)
+/* frames lent by the source can't be reused for new data, so they're handed
+ * back as soon as they're no longer in use */
+static void release_unused_ref_frames(obs_source_t *source)
 {
-	struct obs_source_frame *new_frame = NULL;
+	for (size_t i = source->async_cache.num; i > 0; i--) {
+		struct async_frame *af = &source->async_cache.array[i - 1];
+		if (!af->used && af->lent) {
+			obs_source_frame_decref(source, af->frame);
+			da_erase(source->async_cache, i - 1);
+		}
+	}
+}
 
-	pthread_mutex_lock(&source->async_mutex);
+#define MAX_ASYNC_FRAMES 30
 
+/* call with async_mutex locked, returns false if the frame must be dropped
+ * because too many frames are queued */
+static bool update_async_cache(struct obs_source *source,
+			       const struct obs_source_frame *frame)
+{
 	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
 		free_async_cache(source);
 		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
-		return NULL;
+		return false;
 	}
 
 	if (async_texture_changed(source, frame)) {
@@ -3652,14 +3901,31 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 		source->async_cache_height = frame->height;
 	}
 
-	const enum video_format format = frame->format;
-	source->async_cache_format = format;
+	source->async_cache_format = frame->format;
 	source->async_cache_full_range = frame->full_range;
 	source->async_cache_trc = frame->trc;
+	return true;
+}
+
+/* if the return value is not null, then do
+ * (os_atomic_dec_long(&output->refs) == 0) && obs_frame_pool_release(output) */
+static inline struct obs_source_frame *
+cache_video(struct obs_source *source, const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *new_frame = NULL;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (!update_async_cache(source, frame)) {
+		pthread_mutex_unlock(&source->async_mutex);
+		return NULL;
+	}
+
+	const enum video_format format = frame->format;
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
-		if (!af->used) {
+		if (!af->used && !af->lent) {
 			new_frame = af->frame;
 			new_frame->format = format;
 			af->used = true;
@@ -3673,12 +3939,12 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 	if (!new_frame) {
 		struct async_frame new_af;
 
-		new_frame = obs_source_frame_create(format, frame->width,
-						    frame->height);
+		new_frame = obs_frame_pool_acquire(format, frame->width,
+						   frame->height);
 		new_af.frame = new_frame;
 		new_af.used = true;
+		new_af.lent = false;
 		new_af.unused_count = 0;
-		new_frame->refs = 1;
 
 		da_push_back(source->async_cache, &new_af);
 	}
@@ -3714,7 +3980,7 @@ obs_source_output_video_internal(obs_source_t *source,
 	pthread_mutex_lock(&source->async_mutex);
 	if (output) {
 		if (os_atomic_dec_long(&output->refs) == 0) {
-			obs_source_frame_destroy(output);
+			obs_frame_pool_release(output);
 			output = NULL;
 		} else {
 			da_push_back(source->async_frames, &output);
@@ -3780,6 +4046,62 @@ void obs_source_output_video2(obs_source_t *source,
 	obs_source_output_video_internal(source, &new_frame);
 }
 
+void obs_source_output_video_ref(obs_source_t *source,
+				 const struct obs_source_frame *frame,
+				 obs_source_frame_release_t release,
+				 void *param)
+{
+	struct obs_source_frame *new_frame;
+	struct lent_frame lf;
+	struct async_frame af;
+
+	if (!release)
+		return;
+	if (destroying(source) ||
+	    !obs_source_valid(source, "obs_source_output_video_ref") ||
+	    !obs_ptr_valid(frame, "obs_source_output_video_ref")) {
+		release(param);
+		return;
+	}
+
+	new_frame = bmalloc(sizeof(*new_frame));
+	*new_frame = *frame;
+	new_frame->full_range =
+		format_is_yuv(frame->format) ? frame->full_range : true;
+	new_frame->refs = 1;
+	new_frame->prev_frame = false;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	/* checked again with the lock held so that no lent frame can outlive
+	 * the cache flush done before the source is destroyed */
+	if (destroying(source) || !update_async_cache(source, new_frame)) {
+		pthread_mutex_unlock(&source->async_mutex);
+		bfree(new_frame);
+		release(param);
+		return;
+	}
+
+	clean_cache(source);
+	release_unused_ref_frames(source);
+
+	lf.frame = new_frame;
+	lf.release = release;
+	lf.param = param;
+	da_push_back(source->async_lent_frames, &lf);
+
+	/* the cache holds the only reference, same as with copied frames */
+	af.frame = new_frame;
+	af.used = true;
+	af.lent = true;
+	af.unused_count = 0;
+	da_push_back(source->async_cache, &af);
+	da_push_back(source->async_frames, &new_frame);
+	source->async_active = true;
+
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
 void obs_source_set_async_rotation(obs_source_t *source, long rotation)
 {
 	if (source)
@@ -3944,7 +4266,7 @@ void obs_source_show_preloaded_video(obs_source_t *source)
 
 	pthread_mutex_lock(&source->audio_buf_mutex);
 	sys_ts = (source->monitoring_type != OBS_MONITORING_TYPE_MONITOR_ONLY)
-			 ? os_gettime_ns()
+			 ? obs_get_clock_time()
 			 : 0;
 	reset_audio_timing(source, source->last_frame_ts, sys_ts);
 	reset_audio_data(source, sys_ts);
@@ -4075,15 +4397,21 @@ static inline void reset_resampler(obs_source_t *source,
 	source->resampler = NULL;
 	source->resample_offset = 0;
 
-	if (source->sample_info.samples_per_sec == obs_info->samples_per_sec &&
+	/* jitter buffered sources always go through the resampler, it is
+	 * what corrects their drift */
+	if (!source->jitter_max &&
+	    source->sample_info.samples_per_sec == obs_info->samples_per_sec &&
 	    source->sample_info.format == obs_info->format &&
 	    source->sample_info.speakers == obs_info->speakers) {
 		source->audio_failed = false;
 		return;
 	}
 
-	source->resampler =
-		audio_resampler_create(&output_info, &source->sample_info);
+	/* the polyphase resampler only takes the plain rate conversion to
+	 * the mix's planar float, and supports the sync compensation below;
+	 * anything else still goes through swresample */
+	source->resampler = audio_resampler_create2(
+		&output_info, &source->sample_info, AUDIO_RESAMPLER_AUTO);
 
 	source->audio_failed = source->resampler == NULL;
 	if (source->resampler == NULL)
@@ -4167,6 +4495,28 @@ static void process_audio_balancing(struct obs_source *source, uint32_t frames,
 	}
 }
 
+/* spreads the drift correction of the jitter buffer over this packet,
+ * carrying the fraction of a frame that can't be applied yet */
+static void apply_jitter_compensation(obs_source_t *source,
+				      const struct obs_source_audio *audio)
+{
+	uint32_t out_rate = audio_output_get_sample_rate(obs->audio.audio);
+	double distance = (double)audio->frames * (double)out_rate /
+			  (double)audio->samples_per_sec;
+	double delta;
+	int frames;
+
+	if (distance < 1.0)
+		return;
+
+	delta = distance * source->jitter_comp + source->jitter_comp_frac;
+	frames = (int)delta;
+	source->jitter_comp_frac = delta - (double)frames;
+
+	audio_resampler_set_compensation(source->resampler, frames,
+					 (int)distance);
+}
+
 /* resamples/remixes new audio to the designated main audio output format */
 static void process_audio(obs_source_t *source,
 			  const struct obs_source_audio *audio)
@@ -4174,7 +4524,8 @@ static void process_audio(obs_source_t *source,
 	uint32_t frames = audio->frames;
 	bool mono_output;
 
-	if (source->sample_info.samples_per_sec != audio->samples_per_sec ||
+	if (os_atomic_set_bool(&source->jitter_reset, false) ||
+	    source->sample_info.samples_per_sec != audio->samples_per_sec ||
 	    source->sample_info.format != audio->format ||
 	    source->sample_info.speakers != audio->speakers)
 		reset_resampler(source, audio);
@@ -4187,6 +4538,9 @@ static void process_audio(obs_source_t *source,
 
 		memset(output, 0, sizeof(output));
 
+		if (source->jitter_max)
+			apply_jitter_compensation(source, audio);
+
 		audio_resampler_resample(source->resampler, output, &frames,
 					 &source->resample_offset, audio->data,
 					 audio->frames);
@@ -4417,10 +4771,12 @@ void obs_source_release_frame(obs_source_t *source,
 	} else {
 		pthread_mutex_lock(&source->async_mutex);
 
-		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
-		else
+		if (os_atomic_dec_long(&frame->refs) == 0) {
+			release_async_frame(source, frame);
+		} else {
 			remove_async_frame(source, frame);
+			release_unused_ref_frames(source);
+		}
 
 		pthread_mutex_unlock(&source->async_mutex);
 	}
@@ -4456,6 +4812,7 @@ void obs_source_set_name(obs_source_t *source, const char *name)
 		} else {
 			obs_context_data_setname(&source->context, name);
 		}
+		source->profile_tick_name = NULL;
 
 		calldata_init(&data);
 		calldata_set_ptr(&data, "source", source);
@@ -4741,7 +5098,7 @@ proc_handler_t *obs_source_get_proc_handler(const obs_source_t *source)
 void obs_source_set_volume(obs_source_t *source, float volume)
 {
 	if (obs_source_valid(source, "obs_source_set_volume")) {
-		struct audio_action action = {.timestamp = os_gettime_ns(),
+		struct audio_action action = {.timestamp = obs_get_clock_time(),
 					      .type = AUDIO_ACTION_VOL,
 					      .vol = volume};
 
@@ -4798,6 +5155,63 @@ int64_t obs_source_get_sync_offset(const obs_source_t *source)
 		       : 0;
 }
 
+void obs_source_set_audio_jitter_buffer(obs_source_t *source, uint32_t max_ms)
+{
+	if (!obs_source_valid(source, "obs_source_set_audio_jitter_buffer"))
+		return;
+
+	uint64_t jitter_max = (uint64_t)max_ms * 1000000ULL;
+	if (source->jitter_max == jitter_max)
+		return;
+
+	/* the resampler is only forced on while the jitter buffer is */
+	if (!source->jitter_max || !jitter_max)
+		os_atomic_set_bool(&source->jitter_reset, true);
+
+	source->jitter_max = jitter_max;
+}
+
+uint32_t obs_source_get_audio_jitter_buffer(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_audio_jitter_buffer")
+		       ? (uint32_t)(source->jitter_max / 1000000ULL)
+		       : 0;
+}
+
+uint64_t obs_source_get_audio_jitter_delay(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_audio_jitter_delay")
+		       ? source->last_jitter_delay
+		       : 0;
+}
+
+bool obs_source_get_audio_stats(const obs_source_t *source,
+				struct obs_source_audio_stats *stats)
+{
+	if (!obs_source_valid(source, "obs_source_get_audio_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_source_get_audio_stats"))
+		return false;
+
+	obs_source_t *s = (obs_source_t *)source;
+	uint32_t sample_rate = audio_output_get_sample_rate(obs->audio.audio);
+	size_t frames;
+
+	pthread_mutex_lock(&s->audio_buf_mutex);
+	frames = s->audio_input_buf[0].size / sizeof(float);
+	stats->audio_ts = s->audio_ts;
+	pthread_mutex_unlock(&s->audio_buf_mutex);
+
+	stats->lateness_ns = s->audio_lateness;
+	stats->max_lateness_ns = s->audio_max_lateness;
+	stats->buffered_ns = sample_rate ? audio_frames_to_ns(sample_rate,
+							      frames)
+					 : 0;
+	stats->buffering_increases = s->audio_buffering_increases;
+	stats->buffering_added_ns = s->audio_buffering_added;
+	return true;
+}
+
 struct source_enum_data {
 	obs_source_enum_proc_t enum_callback;
 	void *param;
@@ -5308,7 +5722,7 @@ void obs_source_set_muted(obs_source_t *source, bool muted)
 {
 	struct calldata data;
 	uint8_t stack[128];
-	struct audio_action action = {.timestamp = os_gettime_ns(),
+	struct audio_action action = {.timestamp = obs_get_clock_time(),
 				      .type = AUDIO_ACTION_MUTE,
 				      .set = muted};
 
@@ -5507,24 +5921,27 @@ static float get_source_volume(obs_source_t *source, uint64_t os_time)
 static inline void multiply_output_audio(obs_source_t *source, size_t mix,
 					 size_t channels, float vol)
 {
-	register float *out = source->audio_output_buf[mix][0];
-	register float *end = out + AUDIO_OUTPUT_FRAMES * channels;
+	size_t frames = obs->audio.frames_per_tick;
+
+	if (frames == AUDIO_OUTPUT_FRAMES) {
+		/* channel planes are contiguous, do them all at once */
+		obs->audio.kernels->mul(source->audio_output_buf[mix][0], vol,
+					frames * channels);
+		return;
+	}
 
-	while (out < end)
-		*(out++) *= vol;
+	for (size_t ch = 0; ch < channels; ch++)
+		obs->audio.kernels->mul(source->audio_output_buf[mix][ch], vol,
+					frames);
 }
 
 static inline void multiply_vol_data(obs_source_t *source, size_t mix,
 				     size_t channels, float *vol_data)
 {
-	for (size_t ch = 0; ch < channels; ch++) {
-		register float *out = source->audio_output_buf[mix][ch];
-		register float *end = out + AUDIO_OUTPUT_FRAMES;
-		register float *vol = vol_data;
-
-		while (out < end)
-			*(out++) *= *(vol++);
-	}
+	for (size_t ch = 0; ch < channels; ch++)
+		obs->audio.kernels->mul_buf(source->audio_output_buf[mix][ch],
+					    vol_data,
+					    obs->audio.frames_per_tick);
 }
 
 static inline void apply_audio_action(obs_source_t *source,
@@ -5551,6 +5968,7 @@ static void apply_audio_actions(obs_source_t *source, size_t channels,
 {
 	float vol_data[AUDIO_OUTPUT_FRAMES];
 	float cur_vol = get_source_volume(source, source->audio_ts);
+	size_t frames = obs->audio.frames_per_tick;
 	size_t frame_num = 0;
 
 	pthread_mutex_lock(&source->audio_actions_mutex);
@@ -5566,7 +5984,7 @@ static void apply_audio_actions(obs_source_t *source, size_t channels,
 		new_frame_num = conv_time_to_frames(
 			sample_rate, timestamp - source->audio_ts);
 
-		if (new_frame_num >= AUDIO_OUTPUT_FRAMES)
+		if (new_frame_num >= frames)
 			break;
 
 		da_erase(source->audio_actions, i--);
@@ -5581,17 +5999,42 @@ static void apply_audio_actions(obs_source_t *source, size_t channels,
 		cur_vol = get_source_volume(source, timestamp);
 	}
 
-	for (; frame_num < AUDIO_OUTPUT_FRAMES; frame_num++)
+	for (; frame_num < frames; frame_num++)
 		vol_data[frame_num] = cur_vol;
 
 	pthread_mutex_unlock(&source->audio_actions_mutex);
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		if ((source->audio_mixers & (1 << mix)) != 0)
+		if ((source->audio_render_mixers & (1 << mix)) != 0)
 			multiply_vol_data(source, mix, channels, vol_data);
 	}
 }
 
+/* channel planes are AUDIO_OUTPUT_FRAMES apart, only the current tick size
+ * of each is used */
+static inline void clear_audio_output(float *const *planes, size_t channels)
+{
+	size_t frames = obs->audio.frames_per_tick;
+
+	if (frames == AUDIO_OUTPUT_FRAMES) {
+		memset(planes[0], 0, sizeof(float) * frames * channels);
+		return;
+	}
+
+	for (size_t ch = 0; ch < channels; ch++)
+		memset(planes[ch], 0, sizeof(float) * frames);
+}
+
+/* clears a mix the source isn't routed to, without touching the shared
+ * silent buffer unallocated mixes point to */
+static inline void clear_audio_output_mix(obs_source_t *source, size_t mix,
+					  size_t channels)
+{
+	if ((source->audio_buf_mixers & (1 << mix)) != 0)
+		clear_audio_output(source->audio_output_buf[mix], channels);
+	source->audio_silent_mixes |= 1 << mix;
+}
+
 static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 			       size_t channels, size_t sample_rate)
 {
@@ -5608,8 +6051,8 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 	pthread_mutex_unlock(&source->audio_actions_mutex);
 
 	if (actions_pending) {
-		uint64_t duration =
-			conv_frames_to_time(sample_rate, AUDIO_OUTPUT_FRAMES);
+		uint64_t duration = conv_frames_to_time(
+			sample_rate, obs->audio.frames_per_tick);
 
 		if (action.timestamp < (source->audio_ts + duration)) {
 			apply_audio_actions(source, channels, sample_rate);
@@ -5622,15 +6065,14 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 		return;
 
 	if (vol == 0.0f || mixers == 0) {
-		memset(source->audio_output_buf[0][0], 0,
-		       AUDIO_OUTPUT_FRAMES * sizeof(float) *
-			       MAX_AUDIO_CHANNELS * MAX_AUDIO_MIXES);
+		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++)
+			clear_audio_output_mix(source, mix, channels);
 		return;
 	}
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 		uint32_t mix_and_val = (1 << mix);
-		if ((source->audio_mixers & mix_and_val) != 0 &&
+		if ((source->audio_render_mixers & mix_and_val) != 0 &&
 		    (mixers & mix_and_val) != 0)
 			multiply_output_audio(source, mix, channels, vol);
 	}
@@ -5640,6 +6082,7 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers,
 				size_t channels, size_t sample_rate)
 {
 	struct obs_source_audio_mix audio_data;
+	uint32_t routed = source->audio_render_mixers;
 	bool success;
 	uint64_t ts;
 
@@ -5649,18 +6092,24 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers,
 				source->audio_output_buf[mix][ch];
 		}
 
-		if ((source->audio_mixers & mixers & (1 << mix)) != 0) {
-			memset(source->audio_output_buf[mix][0], 0,
-			       sizeof(float) * AUDIO_OUTPUT_FRAMES * channels);
-		}
+		/* renderers that know about it mark untouched mixes */
+		audio_data.output[mix].silent = false;
+
+		if ((routed & mixers & (1 << mix)) != 0)
+			clear_audio_output(source->audio_output_buf[mix],
+					   channels);
 	}
 
+	/* never let the renderer write to mixes without their own memory */
 	success = source->info.audio_render(source->context.data, &ts,
-					    &audio_data, mixers, channels,
-					    sample_rate);
+					    &audio_data,
+					    mixers & source->audio_buf_mixers,
+					    channels, sample_rate);
 	source->audio_ts = success ? ts : 0;
 	source->audio_pending = !success;
 
+	source->audio_silent_mixes = 0;
+
 	if (!success || !source->audio_ts || !mixers)
 		return;
 
@@ -5670,9 +6119,11 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers,
 		if ((mixers & mix_bit) == 0)
 			continue;
 
-		if ((source->audio_mixers & mix_bit) == 0) {
-			memset(source->audio_output_buf[mix][0], 0,
-			       sizeof(float) * AUDIO_OUTPUT_FRAMES * channels);
+		if ((routed & mix_bit) == 0) {
+			clear_audio_output_mix(source, mix, channels);
+
+		} else if (audio_data.output[mix].silent) {
+			source->audio_silent_mixes |= mix_bit;
 		}
 	}
 
@@ -5691,8 +6142,7 @@ static void audio_submix(obs_source_t *source, size_t channels,
 		audio_data.data[ch] = source->audio_mix_buf[ch];
 	}
 
-	memset(source->audio_mix_buf[0], 0,
-	       sizeof(float) * AUDIO_OUTPUT_FRAMES * channels);
+	clear_audio_output(source->audio_mix_buf, channels);
 
 	success = source->info.audio_mix(source->context.data, &ts, &audio_data,
 					 channels, sample_rate);
@@ -5704,7 +6154,7 @@ static void audio_submix(obs_source_t *source, size_t channels,
 		audio.data[i] = (const uint8_t *)audio_data.data[i];
 
 	audio.samples_per_sec = (uint32_t)sample_rate;
-	audio.frames = AUDIO_OUTPUT_FRAMES;
+	audio.frames = obs->audio.frames_per_tick;
 	audio.format = AUDIO_FORMAT_FLOAT_PLANAR;
 	audio.speakers = (enum speaker_layout)channels;
 	audio.timestamp = ts;
@@ -5717,6 +6167,8 @@ static inline void process_audio_source_tick(obs_source_t *source,
 					     size_t sample_rate, size_t size)
 {
 	bool audio_submix = !!(source->info.output_flags & OBS_SOURCE_SUBMIX);
+	uint32_t routed = source->audio_render_mixers;
+	bool silent;
 
 	pthread_mutex_lock(&source->audio_buf_mutex);
 
@@ -5732,6 +6184,12 @@ static inline void process_audio_source_tick(obs_source_t *source,
 
 	pthread_mutex_unlock(&source->audio_buf_mutex);
 
+	silent = true;
+	for (size_t ch = 0; ch < channels && silent; ch++)
+		silent = obs->audio.kernels->is_silent(
+			source->audio_output_buf[0][ch], size / sizeof(float));
+	source->audio_silent_mixes = silent ? 1 : 0;
+
 	for (size_t mix = 1; mix < MAX_AUDIO_MIXES; mix++) {
 		uint32_t mix_and_val = (1 << mix);
 
@@ -5743,16 +6201,20 @@ static inline void process_audio_source_tick(obs_source_t *source,
 			mix_and_val = 1;
 		}
 
-		if ((source->audio_mixers & mix_and_val) == 0 ||
-		    (mixers & mix_and_val) == 0) {
-			memset(source->audio_output_buf[mix][0], 0,
-			       size * channels);
+		/* inactive mixes aren't read by anything this tick */
+		if ((mixers & mix_and_val) == 0)
+			continue;
+
+		if ((routed & mix_and_val) == 0) {
+			clear_audio_output_mix(source, mix, channels);
 			continue;
 		}
 
 		for (size_t ch = 0; ch < channels; ch++)
 			memcpy(source->audio_output_buf[mix][ch],
 			       source->audio_output_buf[0][ch], size);
+		if (silent)
+			source->audio_silent_mixes |= 1 << mix;
 	}
 
 	if (audio_submix) {
@@ -5760,13 +6222,27 @@ static inline void process_audio_source_tick(obs_source_t *source,
 		return;
 	}
 
-	if ((source->audio_mixers & 1) == 0 || (mixers & 1) == 0)
-		memset(source->audio_output_buf[0][0], 0, size * channels);
+	if ((routed & 1) == 0)
+		clear_audio_output_mix(source, 0, channels);
 
 	apply_audio_volume(source, mixers, channels, sample_rate);
 	source->audio_pending = false;
 }
 
+/* routing changes are picked up here on the audio thread, so buffers are
+ * never reallocated while the audio thread may be using them */
+static inline void update_audio_output_mixers(obs_source_t *source)
+{
+	bool submix = !!(source->info.output_flags & OBS_SOURCE_SUBMIX);
+	uint32_t routed = source->audio_mixers & ALL_AUDIO_MIXES;
+	uint32_t needed = submix ? 0x3 : routed;
+
+	if ((needed | 1) != source->audio_buf_mixers)
+		allocate_audio_output_buffer(source, needed);
+
+	source->audio_render_mixers = routed;
+}
+
 void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
 			     size_t channels, size_t sample_rate, size_t size)
 {
@@ -5775,6 +6251,8 @@ void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
 		return;
 	}
 
+	update_audio_output_mixers(source);
+
 	if (source->info.audio_render) {
 		if (!source->context.data) {
 			source->audio_pending = true;
@@ -5826,6 +6304,9 @@ void obs_source_get_audio_mix(const obs_source_t *source,
 			audio->output[mix].data[ch] =
 				source->audio_output_buf[mix][ch];
 		}
+
+		audio->output[mix].silent =
+			(source->audio_silent_mixes & (1 << mix)) != 0;
 	}
 }
 
@@ -6052,6 +6533,17 @@ enum obs_icon_type obs_source_get_icon_type(const char *id)
 	return (info) ? info->icon_type : OBS_ICON_TYPE_UNKNOWN;
 }
 
+/* media actions are processed in the source's video tick */
+static void queue_media_action(obs_source_t *source,
+			       const struct media_action *action)
+{
+	pthread_mutex_lock(&source->media_actions_mutex);
+	da_push_back(source->media_actions, action);
+	pthread_mutex_unlock(&source->media_actions_mutex);
+
+	obs_source_request_tick(source);
+}
+
 void obs_source_media_play_pause(obs_source_t *source, bool pause)
 {
 	if (!data_valid(source, "obs_source_media_play_pause"))
@@ -6067,9 +6559,7 @@ void obs_source_media_play_pause(obs_source_t *source, bool pause)
 		.pause = pause,
 	};
 
-	pthread_mutex_lock(&source->media_actions_mutex);
-	da_push_back(source->media_actions, &action);
-	pthread_mutex_unlock(&source->media_actions_mutex);
+	queue_media_action(source, &action);
 }
 
 void obs_source_media_restart(obs_source_t *source)
@@ -6086,9 +6576,7 @@ void obs_source_media_restart(obs_source_t *source)
 		.type = MEDIA_ACTION_RESTART,
 	};
 
-	pthread_mutex_lock(&source->media_actions_mutex);
-	da_push_back(source->media_actions, &action);
-	pthread_mutex_unlock(&source->media_actions_mutex);
+	queue_media_action(source, &action);
 }
 
 void obs_source_media_stop(obs_source_t *source)
@@ -6105,9 +6593,7 @@ void obs_source_media_stop(obs_source_t *source)
 		.type = MEDIA_ACTION_STOP,
 	};
 
-	pthread_mutex_lock(&source->media_actions_mutex);
-	da_push_back(source->media_actions, &action);
-	pthread_mutex_unlock(&source->media_actions_mutex);
+	queue_media_action(source, &action);
 }
 
 void obs_source_media_next(obs_source_t *source)
@@ -6124,9 +6610,7 @@ void obs_source_media_next(obs_source_t *source)
 		.type = MEDIA_ACTION_NEXT,
 	};
 
-	pthread_mutex_lock(&source->media_actions_mutex);
-	da_push_back(source->media_actions, &action);
-	pthread_mutex_unlock(&source->media_actions_mutex);
+	queue_media_action(source, &action);
 }
 
 void obs_source_media_previous(obs_source_t *source)
@@ -6143,9 +6627,7 @@ void obs_source_media_previous(obs_source_t *source)
 		.type = MEDIA_ACTION_PREVIOUS,
 	};
 
-	pthread_mutex_lock(&source->media_actions_mutex);
-	da_push_back(source->media_actions, &action);
-	pthread_mutex_unlock(&source->media_actions_mutex);
+	queue_media_action(source, &action);
 }
 
 int64_t obs_source_media_get_duration(obs_source_t *source)
@@ -6188,9 +6670,7 @@ void obs_source_media_set_time(obs_source_t *source, int64_t ms)
 		.ms = ms,
 	};
 
-	pthread_mutex_lock(&source->media_actions_mutex);
-	da_push_back(source->media_actions, &action);
-	pthread_mutex_unlock(&source->media_actions_mutex);
+	queue_media_action(source, &action);
 }
 
 enum obs_media_state obs_source_media_get_state(obs_source_t *source)
@@ -203,6 +203,18 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_CAP_DONT_SHOW_PROPERTIES (1 << 16)
 
+/**
+ * Source's video_tick callback is thread safe and can be called on a worker
+ * thread, in parallel with the video_tick callbacks of other sources
+ */
+#define OBS_SOURCE_PARALLEL_TICK (1 << 17)
+
+/**
+ * Source's video_tick callback needs to be called every frame, even while
+ * the source is neither showing nor active
+ */
+#define OBS_SOURCE_ALWAYS_TICK (1 << 18)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
@@ -29,6 +29,32 @@
 #include <windows.h>
 #endif
 
+struct parallel_tick_info {
+	obs_source_t **sources;
+	float seconds;
+	pthread_t caller;
+};
+
+static const char *parallel_tick_name = "parallel_tick";
+static const char *parallel_tick_worker_name = "parallel_tick_worker";
+
+static void parallel_tick_job(void *param, size_t idx)
+{
+	struct parallel_tick_info *info = param;
+
+	/* the graphics thread ticks under parallel_tick, the pool threads have
+	 * no profiler call of their own to record the ticks under */
+	if (pthread_equal(pthread_self(), info->caller)) {
+		obs_source_video_tick_call(info->sources[idx], info->seconds);
+		return;
+	}
+
+	profile_start(parallel_tick_worker_name);
+	obs_source_video_tick_call(info->sources[idx], info->seconds);
+	profile_end(parallel_tick_worker_name);
+	profile_reenable_thread();
+}
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
 	struct obs_core_data *data = &obs->data;
@@ -60,27 +86,93 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 
 	da_clear(data->sources_to_tick);
 
-	pthread_mutex_lock(&data->sources_mutex);
+	pthread_mutex_lock(&data->tick_list_mutex);
 
-	source = data->sources;
-	while (source) {
-		obs_source_t *s = obs_source_get_ref(source);
-		if (s)
+	for (size_t i = 0; i < data->tick_list.num; i++) {
+		obs_source_t *s = obs_source_get_ref(data->tick_list.array[i]);
+		if (s) {
+			s->tick_collected = true;
 			da_push_back(data->sources_to_tick, &s);
-		source = (struct obs_source *)source->context.hh_uuid.next;
+		}
 	}
 
-	pthread_mutex_unlock(&data->sources_mutex);
+	pthread_mutex_unlock(&data->tick_list_mutex);
+
+	/* filters are ticked along with the source they're attached to */
+	for (size_t i = 0, num = data->sources_to_tick.num; i < num; i++) {
+		source = data->sources_to_tick.array[i];
+
+		pthread_mutex_lock(&source->filter_mutex);
+		for (size_t j = 0; j < source->filters.num; j++) {
+			obs_source_t *filter = source->filters.array[j];
+			if (filter->tick_collected)
+				continue;
+
+			filter = obs_source_get_ref(filter);
+			if (filter) {
+				filter->tick_collected = true;
+				da_push_back(data->sources_to_tick, &filter);
+			}
+		}
+		pthread_mutex_unlock(&source->filter_mutex);
+	}
 
 	/* ------------------------------------- */
 	/* call the tick function of each source */
 
+	da_clear(data->sources_to_tick_parallel);
+
+	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
+		obs_source_t *s = data->sources_to_tick.array[i];
+
+		if (!obs_source_video_tick_prepare(s, seconds))
+			continue;
+
+		if (obs->video.tick_pool &&
+		    (s->info.output_flags & OBS_SOURCE_PARALLEL_TICK) != 0)
+			da_push_back(data->sources_to_tick_parallel, &s);
+		else
+			obs_source_video_tick_call(s, seconds);
+	}
+
+	if (data->sources_to_tick_parallel.num) {
+		struct parallel_tick_info info = {
+			.sources = data->sources_to_tick_parallel.array,
+			.seconds = seconds,
+			.caller = pthread_self(),
+		};
+
+		profile_start(parallel_tick_name);
+		os_thread_pool_parallel_for(obs->video.tick_pool,
+					    parallel_tick_job, &info,
+					    data->sources_to_tick_parallel.num);
+		profile_end(parallel_tick_name);
+	}
+
 	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
 		obs_source_t *s = data->sources_to_tick.array[i];
-		obs_source_video_tick(s, seconds);
+		s->tick_collected = false;
 		obs_source_release(s);
 	}
 
+	/* ------------------------------------- */
+	/* drop sources that have settled        */
+
+	pthread_mutex_lock(&data->tick_list_mutex);
+
+	for (size_t i = data->tick_list.num; i > 0; i--) {
+		obs_source_t *s = data->tick_list.array[i - 1];
+		if (!obs_source_needs_tick(s)) {
+			s->in_tick_list = false;
+			da_erase(data->tick_list, i - 1);
+		}
+	}
+
+	pthread_mutex_unlock(&data->tick_list_mutex);
+
+	/* free async frames that have been idle for too long */
+	obs_frame_pool_trim();
+
 	return cur_time;
 }
 
@@ -558,6 +650,22 @@ static inline void encode_gpu(struct obs_core_video_mix *video, bool raw_active,
 		;
 }
 
+/* a virtual clock waits for the encoder rather than dropping frames */
+static void wait_for_gpu_encoder(struct obs_core_video_mix *video)
+{
+	bool available = false;
+
+	while (!available) {
+		pthread_mutex_lock(&video->gpu_encoder_mutex);
+		available = video->gpu_encoder_avail_queue.size ||
+			    os_atomic_load_bool(&video->gpu_encode_stop);
+		pthread_mutex_unlock(&video->gpu_encoder_mutex);
+
+		if (!available)
+			os_event_timedwait(video->gpu_encode_inactive, 1);
+	}
+}
+
 static const char *output_gpu_encoders_name = "output_gpu_encoders";
 static void output_gpu_encoders(struct obs_core_video_mix *video,
 				bool raw_active)
@@ -573,6 +681,9 @@ static void output_gpu_encoders(struct obs_core_video_mix *video,
 	deque_pop_front(&video->vframe_info_buffer_gpu, &vframe_info,
 			sizeof(vframe_info));
 
+	if (obs->virtual_clock)
+		wait_for_gpu_encoder(video);
+
 	pthread_mutex_lock(&video->gpu_encoder_mutex);
 	encode_gpu(video, raw_active, &vframe_info);
 	pthread_mutex_unlock(&video->gpu_encoder_mutex);
@@ -873,6 +984,10 @@ static inline void output_video_data(struct obs_core_video_mix *video,
 
 	info = video_output_get_info(video->video);
 
+	/* a virtual clock waits for raw outputs rather than dropping frames */
+	if (obs->virtual_clock)
+		video_output_wait_available(video->video);
+
 	locked = video_output_lock_frame(video->video, &output_frame, count,
 					 input_frame->timestamp);
 	if (locked) {
@@ -895,7 +1010,12 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time,
 	uint64_t t = cur_time + interval_ns;
 	int count;
 
-	if (os_sleepto_ns(t)) {
+	if (obs->virtual_clock) {
+		virtual_clock_sleepto(obs->virtual_clock, video->video_clock_id,
+				      t);
+		*p_time = t;
+		count = 1;
+	} else if (os_sleepto_ns(t)) {
 		*p_time = t;
 		count = 1;
 	} else {
@@ -1248,7 +1368,14 @@ void *obs_graphics_thread(void *param)
 
 	const uint64_t interval = obs->video.video_frame_interval_ns;
 
-	obs->video.video_time = os_gettime_ns();
+	if (obs->virtual_clock) {
+		obs->video.video_clock_id =
+			virtual_clock_join(obs->virtual_clock);
+		obs->video.video_time =
+			virtual_clock_get_time(obs->virtual_clock);
+	} else {
+		obs->video.video_time = os_gettime_ns();
+	}
 
 	os_set_thread_name("libobs: graphics thread");
 
@@ -1256,6 +1383,7 @@ void *obs_graphics_thread(void *param)
 		obs_get_profiler_name_store(),
 		"obs_graphics_thread(%g" NBSP "ms)", interval / 1000000.);
 	profile_register_root(video_thread_name, interval);
+	profile_register_root(parallel_tick_worker_name, 0);
 
 	srand((unsigned int)time(NULL));
 
@@ -1274,6 +1402,10 @@ void *obs_graphics_thread(void *param)
 #endif
 		;
 
+	if (obs->virtual_clock)
+		virtual_clock_leave(obs->virtual_clock,
+				    obs->video.video_clock_id);
+
 #ifdef _WIN32
 	uninit_winrt_state(&winrt);
 #endif
@@ -736,6 +736,8 @@ struct obs_core_video_mix *obs_create_video_mix(struct obs_video_info *ovi)
 	return video;
 }
 
+#define MAX_TICK_THREADS 4
+
 static int obs_init_video(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
@@ -752,6 +754,13 @@ static int obs_init_video(struct obs_video_info *ovi)
 	if (!obs_view_add2(&obs->data.main_view, ovi))
 		return OBS_VIDEO_FAIL;
 
+	int tick_threads = os_get_logical_cores() - 1;
+	if (tick_threads > MAX_TICK_THREADS)
+		tick_threads = MAX_TICK_THREADS;
+	if (tick_threads > 0)
+		video->tick_pool = os_thread_pool_create(
+			"video tick", (size_t)tick_threads);
+
 	int errorcode;
 #ifdef __APPLE__
 	pthread_attr_t attr;
@@ -887,6 +896,9 @@ static void obs_free_video(void)
 	pthread_mutex_destroy(&obs->video.task_mutex);
 	pthread_mutex_init_value(&obs->video.task_mutex);
 	deque_free(&obs->video.tasks);
+
+	os_thread_pool_destroy(obs->video.tick_pool);
+	obs->video.tick_pool = NULL;
 }
 
 static void obs_free_graphics(void)
@@ -939,6 +951,12 @@ static bool obs_init_audio(struct audio_output_info *ai)
 	audio->monitoring_device_name = bstrdup("Default");
 	audio->monitoring_device_id = bstrdup("default");
 
+	audio->kernels = audio_kernels_get();
+	blog(LOG_INFO, "audio mixing kernels: %s", audio->kernels->name);
+
+	/* the new audio thread starts without a snapshot */
+	obs_audio_sources_changed();
+
 	errorcode = audio_output_open(&audio->audio, ai);
 	if (errorcode == AUDIO_OUTPUT_SUCCESS)
 		return true;
@@ -966,9 +984,15 @@ static void obs_free_audio(void)
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
+	os_thread_pool_destroy(audio->render_pool);
+	os_thread_pool_destroy(audio->encode_pool);
+
 	deque_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
+	da_free(audio->render_batch);
+	da_free(audio->audio_sources);
+	audio_source_snapshot_free(audio->source_snapshot);
 
 	da_free(audio->monitors);
 	bfree(audio->monitoring_device_name);
@@ -988,6 +1012,7 @@ static bool obs_init_data(void)
 
 	pthread_mutex_init_value(&obs->data.displays_mutex);
 	pthread_mutex_init_value(&obs->data.draw_callbacks_mutex);
+	pthread_mutex_init_value(&obs->data.tick_list_mutex);
 
 	if (pthread_mutex_init_recursive(&data->sources_mutex) != 0)
 		goto fail;
@@ -1003,6 +1028,8 @@ static bool obs_init_data(void)
 		goto fail;
 	if (pthread_mutex_init_recursive(&obs->data.draw_callbacks_mutex) != 0)
 		goto fail;
+	if (pthread_mutex_init(&data->tick_list_mutex, NULL) != 0)
+		goto fail;
 
 	if (!obs_view_init(&data->main_view))
 		goto fail;
@@ -1082,6 +1109,7 @@ static void obs_free_data(void)
 	pthread_mutex_destroy(&data->encoders_mutex);
 	pthread_mutex_destroy(&data->services_mutex);
 	pthread_mutex_destroy(&data->draw_callbacks_mutex);
+	pthread_mutex_destroy(&data->tick_list_mutex);
 	da_free(data->draw_callbacks);
 	da_free(data->rendered_callbacks);
 	da_free(data->tick_callbacks);
@@ -1090,7 +1118,9 @@ static void obs_free_data(void)
 	for (size_t i = 0; i < data->protocols.num; i++)
 		bfree(data->protocols.array[i]);
 	da_free(data->protocols);
+	da_free(data->tick_list);
 	da_free(data->sources_to_tick);
+	da_free(data->sources_to_tick_parallel);
 }
 
 static const char *obs_signals[] = {
@@ -1116,6 +1146,8 @@ static const char *obs_signals[] = {
 
 	"void channel_change(int channel, in out ptr source, ptr prev_source)",
 
+	"void audio_buffering(ptr source, int added_ms, int total_ms)",
+
 	"void hotkey_layout_change()",
 	"void hotkey_register(ptr hotkey)",
 	"void hotkey_unregister(ptr hotkey)",
@@ -1431,6 +1463,8 @@ void obs_shutdown(void)
 	obs_free_data();
 	obs_free_audio();
 	obs_free_video();
+	virtual_clock_destroy(obs->virtual_clock);
+	obs_frame_pool_free();
 	os_task_queue_destroy(obs->destruction_task_thread);
 	obs_free_hotkeys();
 	obs_free_graphics();
@@ -1584,52 +1618,132 @@ int obs_reset_video(struct obs_video_info *ovi)
 #define SEC_TO_MSEC 1000
 #endif
 
-bool obs_reset_audio2(const struct obs_audio_info2 *oai)
+#define MAX_AUDIO_RENDER_THREADS 8
+
+static bool audio_info_valid(const struct obs_audio_info3 *oai,
+			     uint32_t tick_frames)
+{
+	if (!oai->samples_per_sec || oai->speakers == SPEAKERS_UNKNOWN) {
+		blog(LOG_ERROR, "Invalid audio settings: %u Hz, speakers %d",
+		     oai->samples_per_sec, (int)oai->speakers);
+		return false;
+	}
+
+	switch (tick_frames) {
+	case 128:
+	case 256:
+	case 512:
+	case AUDIO_OUTPUT_FRAMES:
+		return true;
+	}
+
+	blog(LOG_ERROR,
+	     "Invalid audio tick size: %u frames "
+	     "(must be 128, 256, 512 or %d)",
+	     tick_frames, AUDIO_OUTPUT_FRAMES);
+	return false;
+}
+
+bool obs_reset_audio3(const struct obs_audio_info3 *oai)
 {
 	struct obs_core_audio *audio = &obs->audio;
 	struct audio_output_info ai;
+	uint32_t tick_frames = AUDIO_OUTPUT_FRAMES;
 
 	/* don't allow changing of audio settings if active. */
 	if (!obs || (audio->audio && audio_output_active(audio->audio)))
 		return false;
 
+	/* keep the current audio if the new settings can't be used */
+	if (oai) {
+		if (oai->frames_per_tick)
+			tick_frames = oai->frames_per_tick;
+		if (!audio_info_valid(oai, tick_frames))
+			return false;
+	}
+
 	obs_free_audio();
 	if (!oai)
 		return true;
 
+	audio->frames_per_tick = tick_frames;
+
 	if (oai->max_buffering_ms) {
 		uint32_t max_frames = oai->max_buffering_ms *
 				      oai->samples_per_sec / SEC_TO_MSEC;
-		max_frames += (AUDIO_OUTPUT_FRAMES - 1);
-		audio->max_buffering_ticks = max_frames / AUDIO_OUTPUT_FRAMES;
+		max_frames += (tick_frames - 1);
+		audio->max_buffering_ticks = max_frames / tick_frames;
 	} else {
-		audio->max_buffering_ticks = 45;
+		/* same maximum latency as 45 ticks of the default size */
+		audio->max_buffering_ticks =
+			45 * AUDIO_OUTPUT_FRAMES / tick_frames;
 	}
 	audio->fixed_buffer = oai->fixed_buffering;
 
-	int max_buffering_ms = audio->max_buffering_ticks *
-			       AUDIO_OUTPUT_FRAMES * SEC_TO_MSEC /
-			       (int)oai->samples_per_sec;
+	if (oai->parallel_render) {
+		int threads = os_get_logical_cores() - 1;
+		if (threads > MAX_AUDIO_RENDER_THREADS)
+			threads = MAX_AUDIO_RENDER_THREADS;
+		if (threads > 0)
+			audio->render_pool = os_thread_pool_create(
+				"audio render", (size_t)threads);
+	}
+
+	/* the audio thread encodes one of the tracks itself */
+	if (oai->parallel_encode) {
+		int threads = os_get_logical_cores() - 1;
+		if (threads > MAX_AUDIO_MIXES - 1)
+			threads = MAX_AUDIO_MIXES - 1;
+		if (threads > 0)
+			audio->encode_pool = os_thread_pool_create(
+				"audio encode", (size_t)threads);
+	}
+
+	int max_buffering_ms = audio->max_buffering_ticks * (int)tick_frames *
+			       SEC_TO_MSEC / (int)oai->samples_per_sec;
 
 	ai.name = "Audio";
 	ai.samples_per_sec = oai->samples_per_sec;
 	ai.format = AUDIO_FORMAT_FLOAT_PLANAR;
 	ai.speakers = oai->speakers;
+	ai.frames_per_tick = tick_frames;
 	ai.input_callback = audio_callback;
+	ai.clock = obs->virtual_clock;
+	ai.output_pool = audio->encode_pool;
 
 	blog(LOG_INFO, "---------------------------------");
 	blog(LOG_INFO,
 	     "audio settings reset:\n"
 	     "\tsamples per sec: %d\n"
 	     "\tspeakers:        %d\n"
+	     "\ttick size:       %d frames\n"
 	     "\tmax buffering:   %d milliseconds\n"
-	     "\tbuffering type:  %s",
-	     (int)ai.samples_per_sec, (int)ai.speakers, max_buffering_ms,
-	     oai->fixed_buffering ? "fixed" : "dynamically increasing");
+	     "\tbuffering type:  %s\n"
+	     "\trender threads:  %d\n"
+	     "\tencode threads:  %d",
+	     (int)ai.samples_per_sec, (int)ai.speakers, (int)tick_frames,
+	     max_buffering_ms,
+	     oai->fixed_buffering ? "fixed" : "dynamically increasing",
+	     (int)os_thread_pool_get_threads(audio->render_pool),
+	     (int)os_thread_pool_get_threads(audio->encode_pool));
 
 	return obs_init_audio(&ai);
 }
 
+bool obs_reset_audio2(const struct obs_audio_info2 *oai)
+{
+	struct obs_audio_info3 oai3 = {0};
+
+	if (!oai)
+		return obs_reset_audio3(NULL);
+
+	oai3.samples_per_sec = oai->samples_per_sec;
+	oai3.speakers = oai->speakers;
+	oai3.max_buffering_ms = oai->max_buffering_ms;
+	oai3.fixed_buffering = oai->fixed_buffering;
+	return obs_reset_audio3(&oai3);
+}
+
 bool obs_reset_audio(const struct obs_audio_info *oai)
 {
 	struct obs_audio_info2 oai2 = {
@@ -2254,6 +2368,7 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data,
 	double volume;
 	double balance;
 	int64_t sync;
+	uint32_t jitter_buffer;
 	uint32_t prev_ver;
 	uint32_t caps;
 	uint32_t flags;
@@ -2290,6 +2405,10 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data,
 	sync = obs_data_get_int(source_data, "sync");
 	obs_source_set_sync_offset(source, sync);
 
+	jitter_buffer =
+		(uint32_t)obs_data_get_int(source_data, "jitter_buffer");
+	obs_source_set_audio_jitter_buffer(source, jitter_buffer);
+
 	obs_data_set_default_int(source_data, "mixers", 0x3F);
 	mixers = (uint32_t)obs_data_get_int(source_data, "mixers");
 	obs_source_set_audio_mixers(source, mixers);
@@ -2441,6 +2560,7 @@ obs_data_t *obs_save_source(obs_source_t *source)
 	float balance = obs_source_get_balance_value(source);
 	uint32_t mixers = obs_source_get_audio_mixers(source);
 	int64_t sync = obs_source_get_sync_offset(source);
+	uint32_t jitter_buffer = obs_source_get_audio_jitter_buffer(source);
 	uint32_t flags = obs_source_get_flags(source);
 	const char *name = obs_source_get_name(source);
 	const char *uuid = obs_source_get_uuid(source);
@@ -2475,6 +2595,7 @@ obs_data_t *obs_save_source(obs_source_t *source)
 	obs_data_set_obj(source_data, "settings", settings);
 	obs_data_set_int(source_data, "mixers", mixers);
 	obs_data_set_int(source_data, "sync", sync);
+	obs_data_set_int(source_data, "jitter_buffer", jitter_buffer);
 	obs_data_set_int(source_data, "flags", flags);
 	obs_data_set_double(source_data, "volume", volume);
 	obs_data_set_double(source_data, "balance", balance);
@@ -2894,6 +3015,43 @@ uint64_t obs_get_video_frame_time(void)
 	return obs->video.video_time;
 }
 
+bool obs_set_virtual_clock(bool enable)
+{
+	if (!obs)
+		return false;
+
+	/* nothing may be running on the clock that is swapped out */
+	if (obs->video.thread_initialized || obs->audio.audio)
+		return false;
+
+	if (enable == (obs->virtual_clock != NULL))
+		return true;
+
+	if (enable) {
+		obs->virtual_clock = virtual_clock_create(os_gettime_ns());
+		if (!obs->virtual_clock)
+			return false;
+	} else {
+		virtual_clock_destroy(obs->virtual_clock);
+		obs->virtual_clock = NULL;
+	}
+
+	blog(LOG_INFO, "Virtual clock %s", enable ? "enabled" : "disabled");
+	return true;
+}
+
+bool obs_virtual_clock_enabled(void)
+{
+	return obs && obs->virtual_clock;
+}
+
+uint64_t obs_get_clock_time(void)
+{
+	return obs && obs->virtual_clock
+		       ? virtual_clock_get_time(obs->virtual_clock)
+		       : os_gettime_ns();
+}
+
 double obs_get_active_fps(void)
 {
 	return obs->video.video_fps;
@@ -3084,6 +3242,41 @@ uint32_t obs_get_lagged_frames(void)
 	return obs->video.lagged_frames;
 }
 
+uint64_t obs_get_audio_silent_blocks_skipped(void)
+{
+	return obs->audio.silent_blocks_skipped;
+}
+
+bool obs_get_audio_buffering_info(struct obs_audio_buffering_info *info)
+{
+	struct obs_core_audio *audio = &obs->audio;
+	uint32_t sample_rate;
+
+	if (!obs_ptr_valid(info, "obs_get_audio_buffering_info"))
+		return false;
+	if (!audio->audio)
+		return false;
+
+	sample_rate = audio_output_get_sample_rate(audio->audio);
+
+	info->buffering_ticks = (uint32_t)audio->total_buffering_ticks;
+	info->max_buffering_ticks = (uint32_t)audio->max_buffering_ticks;
+	info->buffering_ns = audio_frames_to_ns(
+		sample_rate,
+		(uint64_t)info->buffering_ticks * audio->frames_per_tick);
+	info->increases = audio->buffering_increases;
+
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
+		info->mix_latency_ns[i] =
+			audio_output_get_mix_latency(audio->audio, i);
+	return true;
+}
+
+uint64_t obs_get_audio_silent_mixes(void)
+{
+	return audio_output_get_silent_mixes(obs->audio.audio);
+}
+
 struct obs_core_video_mix *get_mix_for_video(video_t *v)
 {
 	struct obs_core_video_mix *result = NULL;
@@ -171,7 +171,8 @@ struct obs_transform_info {
 struct obs_video_info {
 #ifndef SWIG
 	/**
-	 * Graphics module to use (usually "libobs-opengl" or "libobs-d3d11")
+	 * Graphics module to use (usually "libobs-opengl" or "libobs-d3d11",
+	 * or "libobs-null" to run headless without rendering anything)
 	 */
 	const char *graphics_module;
 #endif
@@ -214,6 +215,27 @@ struct obs_audio_info2 {
 	bool fixed_buffering;
 };
 
+struct obs_audio_info3 {
+	uint32_t samples_per_sec;
+	enum speaker_layout speakers;
+
+	uint32_t max_buffering_ms;
+	bool fixed_buffering;
+
+	/** Render independent audio sources concurrently on a thread pool */
+	bool parallel_render;
+
+	/** Run the audio encoders of different tracks concurrently */
+	bool parallel_encode;
+
+	/**
+	 * Frames rendered per audio tick: 128, 256, 512 or
+	 * AUDIO_OUTPUT_FRAMES (the default if 0).  Smaller ticks lower audio
+	 * latency.
+	 */
+	uint32_t frames_per_tick;
+};
+
 /**
  * Sent to source filters via the filter_audio callback to allow filtering of
  * audio data
@@ -247,6 +269,12 @@ struct obs_source_cea_708 {
 
 #define OBS_SOURCE_FRAME_LINEAR_ALPHA (1 << 0)
 
+/**
+ * Called once libobs no longer needs the data of a frame passed to
+ * obs_source_output_video_ref.
+ */
+typedef void (*obs_source_frame_release_t)(void *param);
+
 /**
  * Source asynchronous video output structure.  Used with
  * obs_source_output_video to output asynchronous video.  Video is buffered as
@@ -423,6 +451,26 @@ EXPORT int obs_reset_video(struct obs_video_info *ovi);
  */
 EXPORT bool obs_reset_audio(const struct obs_audio_info *oai);
 EXPORT bool obs_reset_audio2(const struct obs_audio_info2 *oai);
+EXPORT bool obs_reset_audio3(const struct obs_audio_info3 *oai);
+
+/**
+ * Drives video and audio with a shared virtual clock instead of the system
+ * clock.  Each advances as soon as its previous tick has completed, so
+ * outputs are produced faster than real time with the same timestamps they
+ * would have had in real time.  Raw and texture encoders are waited on
+ * rather than having frames dropped, which makes renders reproducible.
+ *
+ * @note Can only be changed while neither video nor audio is running, i.e.
+ *       before obs_reset_video and obs_reset_audio are first called.
+ */
+EXPORT bool obs_set_virtual_clock(bool enable);
+EXPORT bool obs_virtual_clock_enabled(void);
+
+/**
+ * Returns the current time on the clock video and audio are rendered with,
+ * which is os_gettime_ns() unless a virtual clock is enabled.
+ */
+EXPORT uint64_t obs_get_clock_time(void);
 
 /** Gets the current video settings, returns false if no video */
 EXPORT bool obs_get_video_info(struct obs_video_info *ovi);
@@ -882,6 +930,51 @@ EXPORT uint64_t obs_get_frame_interval_ns(void);
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+/** Number of silent source mix buffers that were skipped instead of mixed */
+EXPORT uint64_t obs_get_audio_silent_blocks_skipped(void);
+/** Number of output mix ticks that were silent and not clamped */
+EXPORT uint64_t obs_get_audio_silent_mixes(void);
+
+struct obs_audio_buffering_info {
+	/** Audio buffering currently added to all sources */
+	uint32_t buffering_ticks;
+	uint32_t max_buffering_ticks;
+	uint64_t buffering_ns;
+	/** Number of times audio buffering was increased */
+	uint32_t increases;
+	/** Time between the timestamp of a mix's audio and it being handed to
+	 * outputs, 0 if the mix is not in use */
+	uint64_t mix_latency_ns[MAX_AUDIO_MIXES];
+};
+
+/**
+ * Gets the current audio buffering and latency.  The "audio_buffering"
+ * signal reports which source caused each increase.
+ */
+EXPORT bool obs_get_audio_buffering_info(struct obs_audio_buffering_info *info);
+
+struct obs_frame_pool_stats {
+	/** Async frames that were reused from the pool or newly allocated */
+	uint64_t hits;
+	uint64_t misses;
+	/** Idle frames freed because of the size limit or their age */
+	uint64_t trimmed;
+	/** Memory held by idle frames in the pool */
+	uint64_t bytes_held;
+	uint64_t bytes_limit;
+	uint32_t frames_held;
+};
+
+/**
+ * Sets how much memory idle async source frames may hold before the least
+ * recently used ones are freed.  Frames released by one async source are
+ * reused by any source outputting the same format and size.
+ */
+EXPORT void obs_set_frame_pool_limit(uint64_t bytes);
+
+/** Gets the async frame pool statistics */
+EXPORT void obs_get_frame_pool_stats(struct obs_frame_pool_stats *stats);
+
 EXPORT bool obs_nv12_tex_active(void);
 EXPORT bool obs_p010_tex_active(void);
 
@@ -1204,6 +1297,40 @@ EXPORT void obs_source_set_sync_offset(obs_source_t *source, int64_t offset);
 /** Gets the audio sync offset (in nanoseconds) for a source */
 EXPORT int64_t obs_source_get_sync_offset(const obs_source_t *source);
 
+/**
+ * Enables a jitter buffer for just this source, which delays the source by
+ * up to max_ms to absorb late delivery and corrects clock drift by
+ * resampling, rather than raising the audio buffering of all sources.
+ * 0 disables it.
+ */
+EXPORT void obs_source_set_audio_jitter_buffer(obs_source_t *source,
+					       uint32_t max_ms);
+
+/** Gets the maximum jitter buffer delay (in milliseconds) of a source */
+EXPORT uint32_t obs_source_get_audio_jitter_buffer(const obs_source_t *source);
+
+/** Gets the current jitter buffer delay (in nanoseconds) of a source */
+EXPORT uint64_t obs_source_get_audio_jitter_delay(const obs_source_t *source);
+
+/** Audio timing of a source, for finding what forces audio latency */
+struct obs_source_audio_stats {
+	/** Timestamp of the next audio to be mixed */
+	uint64_t audio_ts;
+	/** How far behind the system clock the end of the last audio packet
+	 * was when it arrived, and the most it has been */
+	int64_t lateness_ns;
+	int64_t max_lateness_ns;
+	/** Audio waiting in the source to be mixed */
+	uint64_t buffered_ns;
+	/** How often, and by how much in total, audio buffering was increased
+	 * because of this source */
+	uint32_t buffering_increases;
+	uint64_t buffering_added_ns;
+};
+
+EXPORT bool obs_source_get_audio_stats(const obs_source_t *source,
+				       struct obs_source_audio_stats *stats);
+
 /** Enumerates active child sources used by this source */
 EXPORT void obs_source_enum_active_sources(obs_source_t *source,
 					   obs_source_enum_proc_t enum_callback,
@@ -1441,6 +1568,18 @@ EXPORT void obs_source_output_video(obs_source_t *source,
 EXPORT void obs_source_output_video2(obs_source_t *source,
 				     const struct obs_source_frame2 *frame);
 
+/**
+ * Outputs asynchronous video data without copying it.  libobs uses the
+ * frame's data in place and calls release(param) exactly once when it no
+ * longer needs it, which may happen on any thread, possibly before this
+ * function returns.  The data must not be modified until then, and the
+ * release callback must not call back into the source.
+ */
+EXPORT void obs_source_output_video_ref(obs_source_t *source,
+					const struct obs_source_frame *frame,
+					obs_source_frame_release_t release,
+					void *param);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
 EXPORT void obs_source_output_cea708(obs_source_t *source,
@@ -2094,6 +2233,45 @@ EXPORT uint32_t obs_output_get_delay(const obs_output_t *output);
 /** If delay is active, gets the currently active delay value, in seconds. */
 EXPORT uint32_t obs_output_get_active_delay(const obs_output_t *output);
 
+/**
+ * Lets delayed packets be spilled to a file in the given directory instead of
+ * holding all of them in memory.  Once more than ram_window bytes of packet
+ * data are waiting in memory, further packet data is written to a ring file
+ * of file_size bytes and read back when the packets get sent.  Packets stay
+ * in memory if the file is full.  A NULL directory or a file size of 0
+ * disables spilling.
+ *
+ * Like the delay itself, this only takes effect the next time the output is
+ * activated.
+ */
+EXPORT void obs_output_set_delay_spill(obs_output_t *output, const char *dir,
+				       uint64_t ram_window, uint64_t file_size);
+
+struct obs_output_delay_stats {
+	/** Delayed packet data currently held in memory and on disk */
+	uint64_t ram_bytes;
+	uint64_t disk_bytes;
+
+	/**
+	 * Packet data written to and read back from the spill file, and the
+	 * time spent doing so in nanoseconds.  Sample this twice to get a
+	 * rate.
+	 */
+	uint64_t bytes_written;
+	uint64_t bytes_read;
+	uint64_t write_ns;
+	uint64_t read_ns;
+
+	/** Packets spilled to disk */
+	uint64_t spilled_packets;
+	/** Packets that were kept in memory because the file was full */
+	uint64_t full_packets;
+};
+
+/** Gets the memory and disk usage of the delay since it was last activated */
+EXPORT bool obs_output_get_delay_stats(obs_output_t *output,
+				       struct obs_output_delay_stats *stats);
+
 /** Forces the output to stop.  Usually only used with delay. */
 EXPORT void obs_output_force_stop(obs_output_t *output);
 
@@ -2501,6 +2679,21 @@ EXPORT enum obs_scale_type obs_encoder_get_scale_type(obs_encoder_t *encoder);
 /** For video encoders, returns the frame rate divisor (default is 1) */
 EXPORT uint32_t obs_encoder_get_frame_rate_divisor(const obs_encoder_t *encoder);
 
+/**
+ * Lets a video encoder that takes raw frames encode on a thread of its own,
+ * with up to depth frames queued up for it, so that it doesn't hold up the
+ * video thread and other encoders.  0 (the default) encodes on the video
+ * thread.  Has no effect on texture encoders.
+ *
+ * Can only be called on stopped encoders.
+ */
+EXPORT bool obs_encoder_set_encode_queue_depth(obs_encoder_t *encoder,
+					       size_t depth);
+
+/** For video encoders, returns the encode queue depth (default is 0) */
+EXPORT size_t
+obs_encoder_get_encode_queue_depth(const obs_encoder_t *encoder);
+
 /** For audio encoders, returns the sample rate of the audio */
 EXPORT uint32_t obs_encoder_get_sample_rate(const obs_encoder_t *encoder);
 
@@ -2600,6 +2793,28 @@ EXPORT void obs_encoder_set_last_error(obs_encoder_t *encoder,
 
 EXPORT uint64_t obs_encoder_get_pause_offset(const obs_encoder_t *encoder);
 
+struct obs_encoder_stats {
+	/** Packets and payload bytes sent to outputs */
+	uint64_t packets;
+	uint64_t bytes;
+	/**
+	 * Payload bytes copied on the way to outputs.  Each packet is copied
+	 * once and shared by all outputs, sample this twice to get a rate.
+	 */
+	uint64_t bytes_copied;
+
+	/** Raw frames waiting in the encode queue */
+	uint64_t queued_frames;
+	/** Time the last queued frame took to get encoded, in nanoseconds */
+	uint64_t lag_ns;
+	/** Frames the video thread had to wait for room in the queue for */
+	uint64_t queue_stalls;
+};
+
+/** Gets the packet and copy counters of an encoder */
+EXPORT bool obs_encoder_get_stats(obs_encoder_t *encoder,
+				  struct obs_encoder_stats *stats);
+
 /* ------------------------------------------------------------------------- */
 /* Stream Services */
 
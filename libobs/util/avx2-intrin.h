@@ -0,0 +1,65 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/*
+ * AVX2 intrinsics for code paths that are selected at runtime.  Never include
+ * this in the same translation unit as sse-intrin.h, simde's native aliases
+ * clash with the real intrinsics; keep AVX2 code in its own source files.
+ * HAVE_AVX2_INTRIN is defined when the target is x86, in which case functions
+ * using AVX2 must be marked with AVX2_FUNC and only be called if
+ * cpu_has_avx2() returns true.
+ */
+
+#include "c99defs.h"
+
+#if (defined(_M_X64) && !defined(_M_ARM64EC)) || defined(_M_IX86) || \
+	defined(__x86_64__) || defined(__i386__)
+#define HAVE_AVX2_INTRIN
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_FUNC
+#else
+#define AVX2_FUNC __attribute__((target("avx2")))
+#endif
+
+static inline bool cpu_has_avx2(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	/* OSXSAVE + AVX, then make sure the OS saves the YMM state */
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+		return false;
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
@@ -24,7 +24,9 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
 #include <dirent.h>
@@ -851,6 +853,108 @@ void os_inhibit_sleep_destroy(os_inhibit_t *info)
 
 #endif
 
+struct os_mapped_file {
+	void *data;
+	size_t size;
+};
+
+/* writes zeros over the whole file so that every block actually exists */
+static int fill_file(int fd, size_t size)
+{
+	static const uint8_t zeros[65536];
+	size_t offset = 0;
+
+	while (offset < size) {
+		size_t chunk = size - offset;
+		ssize_t written;
+
+		if (chunk > sizeof(zeros))
+			chunk = sizeof(zeros);
+
+		written = pwrite(fd, zeros, chunk, (off_t)offset);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+
+		offset += (size_t)written;
+	}
+
+	return 0;
+}
+
+/* reserves the blocks of the file up front: running out of disk space while
+ * writing to a hole in a shared mapping raises SIGBUS instead of returning an
+ * error, so the file must never be left sparse */
+static int reserve_file(int fd, size_t size)
+{
+#if defined(__linux__) || defined(__FreeBSD__)
+	if (posix_fallocate(fd, 0, (off_t)size) == 0)
+		return 0;
+#elif defined(__APPLE__)
+	fstore_t store = {F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)size, 0};
+
+	if (fcntl(fd, F_PREALLOCATE, &store) != -1 &&
+	    ftruncate(fd, (off_t)size) == 0)
+		return 0;
+#endif
+
+	/* filesystems without preallocation support, such as ZFS */
+	return fill_file(fd, size);
+}
+
+os_mapped_file_t *os_mapped_file_create(const char *path, size_t size)
+{
+	struct os_mapped_file *file;
+	void *data;
+	int fd;
+
+	if (!path || !size)
+		return NULL;
+
+	fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (fd == -1)
+		return NULL;
+
+	/* the mapping keeps the data alive, the name is not needed anymore */
+	unlink(path);
+
+	if (reserve_file(fd, size) != 0) {
+		close(fd);
+		return NULL;
+	}
+
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return NULL;
+
+	file = bzalloc(sizeof(struct os_mapped_file));
+	file->data = data;
+	file->size = size;
+	return file;
+}
+
+void *os_mapped_file_get_data(os_mapped_file_t *file)
+{
+	return file ? file->data : NULL;
+}
+
+size_t os_mapped_file_get_size(const os_mapped_file_t *file)
+{
+	return file ? file->size : 0;
+}
+
+void os_mapped_file_destroy(os_mapped_file_t *file)
+{
+	if (file) {
+		munmap(file->data, file->size);
+		bfree(file);
+	}
+}
+
 void os_breakpoint()
 {
 	raise(SIGTRAP);
@@ -1313,6 +1313,80 @@ void os_inhibit_sleep_destroy(os_inhibit_t *info)
 	}
 }
 
+struct os_mapped_file {
+	HANDLE file;
+	HANDLE mapping;
+	void *data;
+	size_t size;
+};
+
+os_mapped_file_t *os_mapped_file_create(const char *path, size_t size)
+{
+	struct os_mapped_file *file;
+	wchar_t *path_utf16;
+	HANDLE handle;
+	HANDLE mapping;
+	void *data;
+
+	if (!path || !size)
+		return NULL;
+	if (!os_utf8_to_wcs_ptr(path, 0, &path_utf16))
+		return NULL;
+
+	handle = CreateFileW(path_utf16, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+			     CREATE_NEW,
+			     FILE_ATTRIBUTE_TEMPORARY |
+				     FILE_FLAG_DELETE_ON_CLOSE,
+			     NULL);
+	bfree(path_utf16);
+
+	if (handle == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	/* the mapping grows the file to the requested size */
+	mapping = CreateFileMappingW(handle, NULL, PAGE_READWRITE,
+				     (DWORD)((uint64_t)size >> 32),
+				     (DWORD)size, NULL);
+	if (!mapping) {
+		CloseHandle(handle);
+		return NULL;
+	}
+
+	data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!data) {
+		CloseHandle(mapping);
+		CloseHandle(handle);
+		return NULL;
+	}
+
+	file = bzalloc(sizeof(struct os_mapped_file));
+	file->file = handle;
+	file->mapping = mapping;
+	file->data = data;
+	file->size = size;
+	return file;
+}
+
+void *os_mapped_file_get_data(os_mapped_file_t *file)
+{
+	return file ? file->data : NULL;
+}
+
+size_t os_mapped_file_get_size(const os_mapped_file_t *file)
+{
+	return file ? file->size : 0;
+}
+
+void os_mapped_file_destroy(os_mapped_file_t *file)
+{
+	if (file) {
+		UnmapViewOfFile(file->data);
+		CloseHandle(file->mapping);
+		CloseHandle(file->file);
+		bfree(file);
+	}
+}
+
 void os_breakpoint(void)
 {
 	__debugbreak();
@@ -183,6 +183,19 @@ EXPORT os_inhibit_t *os_inhibit_sleep_create(const char *reason);
 EXPORT bool os_inhibit_sleep_set_active(os_inhibit_t *info, bool active);
 EXPORT void os_inhibit_sleep_destroy(os_inhibit_t *info);
 
+struct os_mapped_file;
+typedef struct os_mapped_file os_mapped_file_t;
+
+/**
+ * Creates a new scratch file of the given size and maps it into memory for
+ * reading and writing.  Fails if the file already exists.  The file is
+ * deleted again once it is unmapped or the process exits.
+ */
+EXPORT os_mapped_file_t *os_mapped_file_create(const char *path, size_t size);
+EXPORT void *os_mapped_file_get_data(os_mapped_file_t *file);
+EXPORT size_t os_mapped_file_get_size(const os_mapped_file_t *file);
+EXPORT void os_mapped_file_destroy(os_mapped_file_t *file);
+
 EXPORT void os_breakpoint(void);
 
 EXPORT int os_get_physical_cores(void);
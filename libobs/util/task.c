@@ -2,6 +2,8 @@
 #include "bmem.h"
 #include "threading.h"
 #include "deque.h"
+#include "darray.h"
+#include "dstr.h"
 
 struct os_task_queue {
 	pthread_t thread;
@@ -163,3 +165,181 @@ static void *tiny_tubular_task_thread(void *param)
 
 	return NULL;
 }
+
+/* ------------------------------------------------------------------------- */
+
+struct parallel_batch {
+	os_parallel_job_t job;
+	void *param;
+	size_t count;
+	size_t next_idx;
+	size_t remaining;
+	struct parallel_batch *next;
+};
+
+struct os_thread_pool {
+	char *name;
+	DARRAY(pthread_t) threads;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+	struct parallel_batch *first_batch;
+	bool stop;
+};
+
+static void unlink_batch(os_thread_pool_t *pool, struct parallel_batch *batch)
+{
+	struct parallel_batch **prev = &pool->first_batch;
+
+	while (*prev) {
+		if (*prev == batch) {
+			*prev = batch->next;
+			return;
+		}
+		prev = &(*prev)->next;
+	}
+}
+
+/* must be called with the pool mutex locked */
+static inline size_t claim_job(os_thread_pool_t *pool,
+			       struct parallel_batch *batch)
+{
+	size_t idx = batch->next_idx++;
+	if (batch->next_idx == batch->count)
+		unlink_batch(pool, batch);
+	return idx;
+}
+
+/* must be called with the pool mutex locked */
+static inline void run_job(os_thread_pool_t *pool,
+			   struct parallel_batch *batch, size_t idx)
+{
+	pthread_mutex_unlock(&pool->mutex);
+	batch->job(batch->param, idx);
+	pthread_mutex_lock(&pool->mutex);
+
+	if (--batch->remaining == 0)
+		pthread_cond_broadcast(&pool->done_cond);
+}
+
+static void *thread_pool_thread(void *param)
+{
+	os_thread_pool_t *pool = param;
+
+	os_set_thread_name(pool->name);
+
+	pthread_mutex_lock(&pool->mutex);
+
+	while (!pool->stop) {
+		struct parallel_batch *batch = pool->first_batch;
+		if (!batch) {
+			pthread_cond_wait(&pool->work_cond, &pool->mutex);
+			continue;
+		}
+
+		run_job(pool, batch, claim_job(pool, batch));
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+os_thread_pool_t *os_thread_pool_create(const char *name, size_t threads)
+{
+	struct os_thread_pool *pool = bzalloc(sizeof(*pool));
+	struct dstr thread_name = {0};
+
+	dstr_printf(&thread_name, "%s: worker", name ? name : "thread pool");
+	pool->name = thread_name.array;
+
+	if (pthread_mutex_init(&pool->mutex, NULL) != 0)
+		goto fail1;
+	if (pthread_cond_init(&pool->work_cond, NULL) != 0)
+		goto fail2;
+	if (pthread_cond_init(&pool->done_cond, NULL) != 0)
+		goto fail3;
+
+	for (size_t i = 0; i < threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, thread_pool_thread, pool) !=
+		    0)
+			break;
+		da_push_back(pool->threads, &thread);
+	}
+
+	return pool;
+
+fail3:
+	pthread_cond_destroy(&pool->work_cond);
+fail2:
+	pthread_mutex_destroy(&pool->mutex);
+fail1:
+	bfree(pool->name);
+	bfree(pool);
+	return NULL;
+}
+
+void os_thread_pool_destroy(os_thread_pool_t *pool)
+{
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->stop = true;
+	pthread_cond_broadcast(&pool->work_cond);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (size_t i = 0; i < pool->threads.num; i++)
+		pthread_join(pool->threads.array[i], NULL);
+
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->work_cond);
+	pthread_mutex_destroy(&pool->mutex);
+	da_free(pool->threads);
+	bfree(pool->name);
+	bfree(pool);
+}
+
+size_t os_thread_pool_get_threads(const os_thread_pool_t *pool)
+{
+	return pool ? pool->threads.num : 0;
+}
+
+void os_thread_pool_parallel_for(os_thread_pool_t *pool, os_parallel_job_t job,
+				 void *param, size_t count)
+{
+	struct parallel_batch batch = {
+		.job = job,
+		.param = param,
+		.count = count,
+		.remaining = count,
+	};
+
+	if (!count)
+		return;
+
+	if (!pool || !pool->threads.num || count == 1) {
+		for (size_t i = 0; i < count; i++)
+			job(param, i);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+
+	struct parallel_batch **last = &pool->first_batch;
+	while (*last)
+		last = &(*last)->next;
+	*last = &batch;
+
+	pthread_cond_broadcast(&pool->work_cond);
+
+	/* the calling thread helps out rather than just waiting */
+	while (batch.next_idx < batch.count)
+		run_job(pool, &batch, claim_job(pool, &batch));
+
+	while (batch.remaining)
+		pthread_cond_wait(&pool->done_cond, &pool->mutex);
+
+	pthread_mutex_unlock(&pool->mutex);
+}
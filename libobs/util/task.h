@@ -18,6 +18,26 @@ EXPORT void os_task_queue_destroy(os_task_queue_t *tt);
 EXPORT bool os_task_queue_wait(os_task_queue_t *tt);
 EXPORT bool os_task_queue_inside(os_task_queue_t *tt);
 
+/*
+ * Thread pool for fork/join style work.  os_thread_pool_parallel_for calls
+ * job(param, idx) for every idx in [0, count) spread across the pool threads
+ * and the calling thread, and returns once all of them have finished.
+ * Multiple threads may submit work to the same pool at the same time.
+ */
+
+struct os_thread_pool;
+typedef struct os_thread_pool os_thread_pool_t;
+
+typedef void (*os_parallel_job_t)(void *param, size_t idx);
+
+EXPORT os_thread_pool_t *os_thread_pool_create(const char *name,
+					       size_t threads);
+EXPORT void os_thread_pool_destroy(os_thread_pool_t *pool);
+EXPORT size_t os_thread_pool_get_threads(const os_thread_pool_t *pool);
+EXPORT void os_thread_pool_parallel_for(os_thread_pool_t *pool,
+					os_parallel_job_t job, void *param,
+					size_t count);
+
 #ifdef __cplusplus
 }
 #endif
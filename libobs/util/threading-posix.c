@@ -30,6 +30,12 @@
 #include <pthread_np.h>
 #endif
 
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #include "bmem.h"
 #include "threading.h"
 
@@ -271,3 +277,21 @@ void os_set_thread_name(const char *name)
 	}
 #endif
 }
+
+bool os_set_thread_priority(enum os_thread_priority priority)
+{
+#if defined(__APPLE__)
+	qos_class_t qos = priority == OS_THREAD_PRIORITY_BELOW_NORMAL
+				  ? QOS_CLASS_UTILITY
+				  : QOS_CLASS_DEFAULT;
+	return pthread_set_qos_class_self_np(qos, 0) == 0;
+#elif defined(__linux__)
+	/* on linux the nice value is per thread */
+	int nice = priority == OS_THREAD_PRIORITY_BELOW_NORMAL ? 5 : 0;
+	return setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice) ==
+	       0;
+#else
+	UNUSED_PARAMETER(priority);
+	return false;
+#endif
+}
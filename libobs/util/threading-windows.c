@@ -214,3 +214,11 @@ void os_set_thread_name(const char *name)
 		FreeLibrary(hModule);
 	}
 }
+
+bool os_set_thread_priority(enum os_thread_priority priority)
+{
+	int win_priority = priority == OS_THREAD_PRIORITY_BELOW_NORMAL
+				   ? THREAD_PRIORITY_BELOW_NORMAL
+				   : THREAD_PRIORITY_NORMAL;
+	return !!SetThreadPriority(GetCurrentThread(), win_priority);
+}
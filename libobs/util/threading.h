@@ -92,6 +92,13 @@ EXPORT int os_sem_wait(os_sem_t *sem);
 
 EXPORT void os_set_thread_name(const char *name);
 
+enum os_thread_priority {
+	OS_THREAD_PRIORITY_BELOW_NORMAL,
+	OS_THREAD_PRIORITY_NORMAL,
+};
+
+EXPORT bool os_set_thread_priority(enum os_thread_priority priority);
+
 #ifdef _MSC_VER
 #define THREAD_LOCAL __declspec(thread)
 #else
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "virtual-clock.h"
+#include "bmem.h"
+#include "threading.h"
+#include "darray.h"
+
+struct clock_thread {
+	uint64_t target;
+	bool active;
+};
+
+struct virtual_clock {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	uint64_t time;
+
+	DARRAY(struct clock_thread) threads;
+};
+
+virtual_clock_t *virtual_clock_create(uint64_t start_ns)
+{
+	struct virtual_clock *clock = bzalloc(sizeof(*clock));
+
+	if (pthread_mutex_init(&clock->mutex, NULL) != 0)
+		goto fail1;
+	if (pthread_cond_init(&clock->cond, NULL) != 0)
+		goto fail2;
+
+	clock->time = start_ns;
+	return clock;
+
+fail2:
+	pthread_mutex_destroy(&clock->mutex);
+fail1:
+	bfree(clock);
+	return NULL;
+}
+
+void virtual_clock_destroy(virtual_clock_t *clock)
+{
+	if (!clock)
+		return;
+
+	pthread_cond_destroy(&clock->cond);
+	pthread_mutex_destroy(&clock->mutex);
+	da_free(clock->threads);
+	bfree(clock);
+}
+
+uint64_t virtual_clock_get_time(virtual_clock_t *clock)
+{
+	uint64_t time;
+
+	pthread_mutex_lock(&clock->mutex);
+	time = clock->time;
+	pthread_mutex_unlock(&clock->mutex);
+
+	return time;
+}
+
+size_t virtual_clock_join(virtual_clock_t *clock)
+{
+	struct clock_thread *thread = NULL;
+	size_t id;
+
+	pthread_mutex_lock(&clock->mutex);
+
+	for (id = 0; id < clock->threads.num; id++) {
+		if (!clock->threads.array[id].active) {
+			thread = &clock->threads.array[id];
+			break;
+		}
+	}
+	if (!thread)
+		thread = da_push_back_new(clock->threads);
+
+	/* starts out busy with the current tick */
+	thread->target = clock->time;
+	thread->active = true;
+
+	pthread_mutex_unlock(&clock->mutex);
+	return id;
+}
+
+void virtual_clock_leave(virtual_clock_t *clock, size_t id)
+{
+	pthread_mutex_lock(&clock->mutex);
+	clock->threads.array[id].active = false;
+	pthread_cond_broadcast(&clock->cond);
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+static inline uint64_t earliest_target(const struct virtual_clock *clock)
+{
+	uint64_t earliest = UINT64_MAX;
+
+	for (size_t i = 0; i < clock->threads.num; i++) {
+		const struct clock_thread *thread = &clock->threads.array[i];
+		if (thread->active && thread->target < earliest)
+			earliest = thread->target;
+	}
+
+	return earliest;
+}
+
+void virtual_clock_sleepto(virtual_clock_t *clock, size_t id,
+			   uint64_t time_ns)
+{
+	pthread_mutex_lock(&clock->mutex);
+
+	clock->threads.array[id].target = time_ns;
+	pthread_cond_broadcast(&clock->cond);
+
+	while (earliest_target(clock) < time_ns)
+		pthread_cond_wait(&clock->cond, &clock->mutex);
+
+	if (time_ns > clock->time)
+		clock->time = time_ns;
+
+	pthread_mutex_unlock(&clock->mutex);
+}
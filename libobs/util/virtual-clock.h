@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Virtual clock
+ *
+ *   Lets threads that normally pace themselves with os_sleepto_ns run as
+ *   fast as they can while still taking turns in timestamp order.  Each
+ *   thread joins the clock and waits for the time of its next tick with
+ *   virtual_clock_sleepto, which returns as soon as no other joined thread
+ *   is still working on an earlier tick.  The clock's time is the latest
+ *   tick time handed out so far.
+ */
+
+struct virtual_clock;
+typedef struct virtual_clock virtual_clock_t;
+
+EXPORT virtual_clock_t *virtual_clock_create(uint64_t start_ns);
+EXPORT void virtual_clock_destroy(virtual_clock_t *clock);
+
+EXPORT uint64_t virtual_clock_get_time(virtual_clock_t *clock);
+
+/** Joins the clock, returns the id to pass to the other thread functions */
+EXPORT size_t virtual_clock_join(virtual_clock_t *clock);
+EXPORT void virtual_clock_leave(virtual_clock_t *clock, size_t id);
+EXPORT void virtual_clock_sleepto(virtual_clock_t *clock, size_t id,
+				  uint64_t time_ns);
+
+#ifdef __cplusplus
+}
+#endif
@@ -50,16 +50,19 @@ static void free_audio_data(struct audio_data *frames)
 static void copy_video_data(struct video_data *src, struct video_data *dst,
 			    size_t size)
 {
-	if (src->data[0]) {
+	// Hold on to the shared frame rather than copying it when possible
+	dst->buffer = video_data_addref(src);
+	if (src->data[0] && !dst->buffer) {
 		dst->data[0] = (uint8_t *)bmemdup(src->data[0], size);
 	}
 }
 
 static void free_video_frame(struct video_data *frame)
 {
-	if (frame->data[0]) {
+	if (frame->buffer) {
+		video_frame_buffer_release(frame->buffer);
+	} else if (frame->data[0]) {
 		bfree(frame->data[0]);
-		frame->data[0] = NULL;
 	}
 
 	memset(frame, 0, sizeof(*frame));
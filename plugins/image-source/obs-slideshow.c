@@ -798,6 +798,7 @@ static inline bool ss_audio_render_(obs_source_t *transition, uint64_t *ts_out,
 {
 	struct obs_source_audio_mix child_audio;
 	uint64_t source_ts;
+	size_t size;
 
 	if (obs_source_audio_pending(transition))
 		return false;
@@ -806,6 +807,9 @@ static inline bool ss_audio_render_(obs_source_t *transition, uint64_t *ts_out,
 	if (!source_ts)
 		return false;
 
+	size = audio_output_get_frames_per_tick(obs_get_audio()) *
+	       sizeof(float);
+
 	obs_source_get_audio_mix(transition, &child_audio);
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 		if ((mixers & (1 << mix)) == 0)
@@ -815,7 +819,7 @@ static inline bool ss_audio_render_(obs_source_t *transition, uint64_t *ts_out,
 			float *out = audio_output->output[mix].data[ch];
 			float *in = child_audio.output[mix].data[ch];
 
-			memcpy(out, in, AUDIO_OUTPUT_FRAMES * sizeof(float));
+			memcpy(out, in, size);
 		}
 	}
 
@@ -1092,7 +1096,7 @@ struct obs_source_info slideshow_info = {
 	.type = OBS_SOURCE_TYPE_INPUT,
 	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
 			OBS_SOURCE_COMPOSITE | OBS_SOURCE_CONTROLLABLE_MEDIA |
-			OBS_SOURCE_CAP_OBSOLETE,
+			OBS_SOURCE_ALWAYS_TICK | OBS_SOURCE_CAP_OBSOLETE,
 	.get_name = ss_getname,
 	.create = ss_create,
 	.destroy = ss_destroy,
@@ -65,6 +65,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "v4l2-input: " msg, ##__VA_ARGS__)
 
+/* number of buffers that always stay queued to the device, frames are copied
+ * instead of lent to obs when lending one more would go below this */
+#define V4L2_MIN_QUEUED_BUFFERS 2
+
+/**
+ * State of a mapped buffer that obs reads from in place.  It is queued to
+ * the device again by the capture thread once obs has released it.
+ */
+struct v4l2_lent_buffer {
+	bool lent;
+	volatile bool returned;
+};
+
 /**
  * Data structure for the v4l2 source
  */
@@ -92,6 +105,8 @@ struct v4l2_data {
 	int height;
 	int linesize;
 	struct v4l2_buffer_data buffers;
+	struct v4l2_lent_buffer *lent;
+	uint_fast32_t lent_count;
 
 	bool auto_reset;
 	int timeout_frames;
@@ -161,6 +176,101 @@ static void v4l2_prep_obs_frame(struct v4l2_data *data,
 	}
 }
 
+/**
+ * Called by obs once it no longer reads from a lent buffer
+ */
+static void v4l2_release_buffer(void *param)
+{
+	struct v4l2_lent_buffer *lent = param;
+	os_atomic_set_bool(&lent->returned, true);
+}
+
+/**
+ * Check whether the dequeued buffer can be passed to obs without copying
+ *
+ * Decoded formats are written to a single frame owned by the decoder, and a
+ * few buffers are kept queued so the device never runs out of them.
+ */
+static bool v4l2_can_lend(struct v4l2_data *data)
+{
+	if (data->pixfmt == V4L2_PIX_FMT_MJPEG ||
+	    data->pixfmt == V4L2_PIX_FMT_H264)
+		return false;
+
+	return data->lent_count + V4L2_MIN_QUEUED_BUFFERS <
+	       data->buffers.count;
+}
+
+/**
+ * Queue all buffers that obs has released back to the device
+ *
+ * @return negative value on failure
+ */
+static int_fast32_t v4l2_requeue_returned(struct v4l2_data *data)
+{
+	struct v4l2_buffer buf;
+
+	for (uint_fast32_t i = 0; i < data->buffers.count; i++) {
+		struct v4l2_lent_buffer *lent = &data->lent[i];
+
+		if (!lent->lent || !os_atomic_load_bool(&lent->returned))
+			continue;
+
+		lent->lent = false;
+		lent->returned = false;
+		data->lent_count--;
+
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+
+		if (v4l2_ioctl(data->dev, VIDIOC_QBUF, &buf) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Take back all buffers lent to obs without queueing them to the device
+ *
+ * This flushes the frames obs has queued for the source, so it must only be
+ * used when the stream is reset or stopped.
+ *
+ * @return false if obs did not release all buffers in time
+ */
+static bool v4l2_reclaim_buffers(struct v4l2_data *data)
+{
+	if (!data->lent_count)
+		return true;
+
+	obs_source_output_video(data->source, NULL);
+
+	for (int wait = 0; wait < 1000; wait++) {
+		bool busy = false;
+
+		for (uint_fast32_t i = 0; i < data->buffers.count; i++) {
+			if (data->lent[i].lent &&
+			    !os_atomic_load_bool(&data->lent[i].returned))
+				busy = true;
+		}
+
+		if (!busy) {
+			memset(data->lent, 0,
+			       data->buffers.count * sizeof(*data->lent));
+			data->lent_count = 0;
+			return true;
+		}
+
+		os_sleep_ms(1);
+	}
+
+	blog(LOG_WARNING, "%s: buffers still in use after one second",
+	     data->device_id);
+	return false;
+}
+
 /*
  * Worker thread to get video data
  */
@@ -231,7 +341,7 @@ static void *v4l2_thread(void *vptr)
 				     data->device_id);
 			}
 
-			if (data->auto_reset) {
+			if (data->auto_reset && v4l2_reclaim_buffers(data)) {
 				if (v4l2_reset_capture(data->dev,
 						       &data->buffers) == 0)
 					blog(LOG_INFO,
@@ -245,6 +355,12 @@ static void *v4l2_thread(void *vptr)
 			continue;
 		}
 
+		if (v4l2_requeue_returned(data) < 0) {
+			blog(LOG_ERROR, "%s: failed to enqueue buffer",
+			     data->device_id);
+			break;
+		}
+
 		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 		buf.memory = V4L2_MEMORY_MMAP;
 
@@ -283,6 +399,18 @@ static void *v4l2_thread(void *vptr)
 			for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
 				out.data[i] = start + plane_offsets[i];
 		}
+
+		if (v4l2_can_lend(data)) {
+			struct v4l2_lent_buffer *lent = &data->lent[buf.index];
+
+			lent->lent = true;
+			data->lent_count++;
+			obs_source_output_video_ref(data->source, &out,
+						    v4l2_release_buffer, lent);
+			frames++;
+			continue;
+		}
+
 		obs_source_output_video(data->source, &out);
 
 		if (v4l2_ioctl(data->dev, VIDIOC_QBUF, &buf) < 0) {
@@ -928,6 +1056,16 @@ static void v4l2_terminate(struct v4l2_data *data)
 	    data->pixfmt == V4L2_PIX_FMT_H264) {
 		v4l2_destroy_decoder(&data->decoder);
 	}
+
+	/* obs may still read from buffers that were lent to it, leak them
+	 * rather than unmapping memory that is in use */
+	if (data->lent && !v4l2_reclaim_buffers(data)) {
+		memset(&data->buffers, 0, sizeof(data->buffers));
+		data->lent = NULL;
+		data->lent_count = 0;
+	}
+	bfree(data->lent);
+	data->lent = NULL;
 	v4l2_destroy_mmap(&data->buffers);
 
 	if (data->dev != -1) {
@@ -1047,6 +1185,7 @@ static void v4l2_init(struct v4l2_data *data)
 		blog(LOG_ERROR, "Failed to map buffers");
 		goto fail;
 	}
+	data->lent = bzalloc(data->buffers.count * sizeof(*data->lent));
 
 	if (data->pixfmt == V4L2_PIX_FMT_MJPEG ||
 	    data->pixfmt == V4L2_PIX_FMT_H264) {
@@ -763,6 +763,58 @@ static inline void copy_data(AVFrame *pic, const struct video_data *frame,
 	}
 }
 
+static void release_video_buffer(void *opaque, uint8_t *data)
+{
+	video_frame_buffer_release(opaque);
+	UNUSED_PARAMETER(data);
+}
+
+/* wraps the frame's shared storage instead of copying it, the codec keeps
+ * its own reference for as long as it needs the frame */
+static AVFrame *ref_data(const AVFrame *props, const struct video_data *frame,
+			 int height, enum AVPixelFormat format)
+{
+	int h_chroma_shift, v_chroma_shift;
+	AVFrame *pic;
+
+	if (!frame->buffer)
+		return NULL;
+
+	pic = av_frame_alloc();
+	if (!pic)
+		return NULL;
+
+	pic->format = format;
+	pic->width = props->width;
+	pic->height = props->height;
+	av_frame_copy_props(pic, props);
+
+	av_pix_fmt_get_chroma_sub_sample(format, &h_chroma_shift,
+					 &v_chroma_shift);
+	for (int plane = 0; plane < MAX_AV_PLANES; plane++) {
+		if (!frame->data[plane])
+			continue;
+
+		struct video_frame_buffer *ref = video_data_addref(frame);
+		int plane_height = height >> (plane ? v_chroma_shift : 0);
+		size_t size = (size_t)frame->linesize[plane] * plane_height;
+
+		pic->buf[plane] = av_buffer_create(frame->data[plane], size,
+						   release_video_buffer, ref,
+						   AV_BUFFER_FLAG_READONLY);
+		if (!pic->buf[plane]) {
+			video_frame_buffer_release(ref);
+			av_frame_free(&pic);
+			return NULL;
+		}
+
+		pic->data[plane] = frame->data[plane];
+		pic->linesize[plane] = (int)frame->linesize[plane];
+	}
+
+	return pic;
+}
+
 static void receive_video(void *param, struct video_data *frame)
 {
 	struct ffmpeg_output *output = param;
@@ -774,6 +826,7 @@ static void receive_video(void *param, struct video_data *frame)
 
 	AVCodecContext *context = data->video_ctx;
 	AVPacket *packet = NULL;
+	AVFrame *pic = NULL;
 	int ret = 0, got_packet;
 
 	if (!output->video_start_ts)
@@ -781,27 +834,39 @@ static void receive_video(void *param, struct video_data *frame)
 	if (!data->start_timestamp)
 		data->start_timestamp = frame->timestamp;
 
-	ret = av_frame_make_writable(data->vframe);
-	if (ret < 0) {
-		blog(LOG_WARNING,
-		     "receive_video: Error obtaining writable "
-		     "AVFrame: %s",
-		     av_err2str(ret));
-		//FIXME: stop the encode with an error
-		return;
+	if (!data->swscale)
+		pic = ref_data(data->vframe, frame, context->height,
+			       context->pix_fmt);
+
+	if (!pic) {
+		ret = av_frame_make_writable(data->vframe);
+		if (ret < 0) {
+			blog(LOG_WARNING,
+			     "receive_video: Error obtaining writable "
+			     "AVFrame: %s",
+			     av_err2str(ret));
+			//FIXME: stop the encode with an error
+			return;
+		}
+		if (!!data->swscale)
+			sws_scale(data->swscale,
+				  (const uint8_t *const *)frame->data,
+				  (const int *)frame->linesize, 0,
+				  data->config.height, data->vframe->data,
+				  data->vframe->linesize);
+		else
+			copy_data(data->vframe, frame, context->height,
+				  context->pix_fmt);
+
+		pic = data->vframe;
 	}
-	if (!!data->swscale)
-		sws_scale(data->swscale, (const uint8_t *const *)frame->data,
-			  (const int *)frame->linesize, 0, data->config.height,
-			  data->vframe->data, data->vframe->linesize);
-	else
-		copy_data(data->vframe, frame, context->height,
-			  context->pix_fmt);
 
 	packet = av_packet_alloc();
 
-	data->vframe->pts = data->total_frames;
-	ret = avcodec_send_frame(context, data->vframe);
+	pic->pts = data->total_frames;
+	ret = avcodec_send_frame(context, pic);
+	if (pic != data->vframe)
+		av_frame_free(&pic);
 	if (ret == 0)
 		ret = avcodec_receive_packet(context, packet);
 
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdlib.h>
+
+/* include after cmocka.h */
+
+static inline int run_benchmarks_on_request(int ret, const char *name,
+					    const struct CMUnitTest *benchmarks,
+					    size_t count)
+{
+	/* benchmarks are only run on request, not as part of ctest */
+	if (!ret && getenv("OBS_CMOCKA_BENCHMARK"))
+		ret = _cmocka_run_group_tests(name, benchmarks, count, NULL,
+					      NULL);
+	return ret;
+}
+
+/* runs the tests, then the benchmarks if the tests passed and
+ * OBS_CMOCKA_BENCHMARK is set */
+#define run_tests_and_benchmarks(tests, benchmarks)                          \
+	run_benchmarks_on_request(cmocka_run_group_tests(tests, NULL, NULL), \
+				  #benchmarks, benchmarks,                   \
+				  sizeof(benchmarks) / sizeof((benchmarks)[0]))
@@ -0,0 +1,186 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <util/platform.h>
+#include <media-io/audio-io.h>
+#include <media-io/audio-kernels.h>
+
+#include "benchmark.h"
+
+/* odd sizes and offsets exercise the unaligned heads and scalar tails */
+#define TEST_FRAMES (AUDIO_OUTPUT_FRAMES + 3)
+#define BENCH_ITERATIONS 20000
+
+static float src[TEST_FRAMES];
+static float mul[TEST_FRAMES];
+static float ref[TEST_FRAMES + 1];
+static float out[TEST_FRAMES + 1];
+
+static void fill_buffers(void)
+{
+	uint32_t seed = 12345;
+
+	for (size_t i = 0; i < TEST_FRAMES; i++) {
+		seed = seed * 1664525 + 1013904223;
+		src[i] = ((float)(seed >> 8) / (float)(1 << 24)) * 4.0f - 2.0f;
+		mul[i] = (float)i / (float)TEST_FRAMES;
+		ref[i] = out[i] = src[(i * 7) % TEST_FRAMES] * 0.5f;
+	}
+
+	src[10] = NAN;
+	src[11] = INFINITY;
+	src[12] = -INFINITY;
+}
+
+static void reset_out(void)
+{
+	memcpy(out, ref, sizeof(out));
+}
+
+static void kernels_match_scalar(void **state)
+{
+	const struct audio_kernels *scalar =
+		audio_kernels_get_type(AUDIO_KERNEL_SCALAR);
+	float expected[TEST_FRAMES + 1];
+
+	UNUSED_PARAMETER(state);
+	fill_buffers();
+
+	for (int type = 0; type < AUDIO_KERNEL_COUNT; type++) {
+		const struct audio_kernels *k = audio_kernels_get_type(type);
+		if (!k)
+			continue;
+
+		memcpy(expected, ref, sizeof(expected));
+		scalar->mix(expected + 1, src, TEST_FRAMES);
+		reset_out();
+		k->mix(out + 1, src, TEST_FRAMES);
+		assert_memory_equal(out, expected, sizeof(out));
+
+		memcpy(expected, ref, sizeof(expected));
+		scalar->mix_mul(expected + 1, src, mul, TEST_FRAMES);
+		reset_out();
+		k->mix_mul(out + 1, src, mul, TEST_FRAMES);
+		assert_memory_equal(out, expected, sizeof(out));
+
+		memcpy(expected, src, sizeof(src));
+		scalar->mul(expected, 0.3f, TEST_FRAMES);
+		memcpy(out, src, sizeof(src));
+		k->mul(out, 0.3f, TEST_FRAMES);
+		assert_memory_equal(out, expected, sizeof(src));
+
+		memcpy(expected, src, sizeof(src));
+		scalar->mul_buf(expected, mul, TEST_FRAMES);
+		memcpy(out, src, sizeof(src));
+		k->mul_buf(out, mul, TEST_FRAMES);
+		assert_memory_equal(out, expected, sizeof(src));
+
+		memcpy(out, src, sizeof(src));
+		k->clamp(out, TEST_FRAMES);
+		assert_true(out[10] == 0.0f);
+		assert_true(out[11] == 1.0f);
+		assert_true(out[12] == -1.0f);
+		for (size_t i = 0; i < TEST_FRAMES; i++)
+			assert_true(out[i] >= -1.0f && out[i] <= 1.0f);
+
+		memset(out, 0, sizeof(out));
+		out[3] = -0.0f;
+		assert_true(k->is_silent(out, TEST_FRAMES));
+		out[TEST_FRAMES - 1] = 1e-30f;
+		assert_false(k->is_silent(out, TEST_FRAMES));
+		out[TEST_FRAMES - 1] = 0.0f;
+		out[17] = NAN;
+		assert_false(k->is_silent(out, TEST_FRAMES));
+
+		/* the same summation order everywhere, so exact matches,
+		 * starting past the NaN/inf samples */
+		for (size_t count = 0; count <= 1000; count += 7) {
+			float a = scalar->dot(src + 13, mul + 1, count);
+			float b = k->dot(src + 13, mul + 1, count);
+			assert_memory_equal(&a, &b, sizeof(float));
+		}
+	}
+}
+
+static void kernels_benchmark(void **state)
+{
+	UNUSED_PARAMETER(state);
+	fill_buffers();
+	src[10] = src[11] = src[12] = 0.0f;
+
+	for (int type = 0; type < AUDIO_KERNEL_COUNT; type++) {
+		const struct audio_kernels *k = audio_kernels_get_type(type);
+		if (!k)
+			continue;
+
+		uint64_t t0 = os_gettime_ns();
+		for (int i = 0; i < BENCH_ITERATIONS; i++)
+			k->mix(out, src, AUDIO_OUTPUT_FRAMES);
+		uint64_t t1 = os_gettime_ns();
+		for (int i = 0; i < BENCH_ITERATIONS; i++)
+			k->mix_mul(out, src, mul, AUDIO_OUTPUT_FRAMES);
+		uint64_t t2 = os_gettime_ns();
+		for (int i = 0; i < BENCH_ITERATIONS; i++)
+			k->clamp(out, AUDIO_OUTPUT_FRAMES);
+		uint64_t t3 = os_gettime_ns();
+
+		printf("%-8s mix: %6.1f ns  mix_mul: %6.1f ns  clamp: %6.1f ns "
+		       "(per %d frames)\n",
+		       k->name, (double)(t1 - t0) / BENCH_ITERATIONS,
+		       (double)(t2 - t1) / BENCH_ITERATIONS,
+		       (double)(t3 - t2) / BENCH_ITERATIONS,
+		       AUDIO_OUTPUT_FRAMES);
+	}
+
+	printf("selected: %s\n", audio_kernels_get()->name);
+}
+
+/* per-tick cost of the selected kernels at the supported tick sizes, the
+ * fixed cost per tick is what smaller ticks pay for their lower latency */
+static void tick_size_benchmark(void **state)
+{
+	const struct audio_kernels *k = audio_kernels_get();
+	static const uint32_t tick_sizes[] = {128, 256, 512, 1024};
+
+	UNUSED_PARAMETER(state);
+	fill_buffers();
+	src[10] = src[11] = src[12] = 0.0f;
+
+	for (size_t t = 0; t < sizeof(tick_sizes) / sizeof(tick_sizes[0]);
+	     t++) {
+		uint32_t frames = tick_sizes[t];
+		uint32_t ticks = BENCH_ITERATIONS * AUDIO_OUTPUT_FRAMES;
+
+		ticks /= frames;
+
+		uint64_t t0 = os_gettime_ns();
+		for (uint32_t i = 0; i < ticks; i++) {
+			k->mix_mul(out, src, mul, frames);
+			k->mix(out, src, frames);
+			k->clamp(out, frames);
+		}
+		uint64_t t1 = os_gettime_ns();
+
+		printf("tick %4u frames: %7.1f ns/tick  %5.2f ns/frame\n",
+		       frames, (double)(t1 - t0) / ticks,
+		       (double)(t1 - t0) / ((double)ticks * frames));
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(kernels_match_scalar),
+	};
+	const struct CMUnitTest benchmarks[] = {
+		cmocka_unit_test(kernels_benchmark),
+		cmocka_unit_test(tick_size_benchmark),
+	};
+
+	return run_tests_and_benchmarks(tests, benchmarks);
+}
@@ -0,0 +1,362 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+/* NULL_GRAPHICS_MODULE and LIBOBS_DATA_PATH are set by the build */
+
+#define QUEUE_DEPTH 4
+#define WAIT_MS 10000
+
+/* encoder that outputs one packet per frame, with the frame's pts.  it can
+ * be held in encode() to fill up its queue, and made to fail on a frame */
+struct test_encoder_state {
+	pthread_mutex_t mutex;
+	os_event_t *resume;
+	volatile bool hold;
+	int64_t fail_pts;
+	long encoded;
+};
+
+/* encoded video output that checks the packets it gets */
+struct test_output {
+	obs_output_t *output;
+	long packets;
+	int64_t next_pts;
+	bool out_of_order;
+};
+
+static struct test_encoder_state enc_state;
+static uint8_t packet_data[1];
+
+static const char *test_encoder_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Encode queue test encoder";
+}
+
+static void *test_encoder_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(encoder);
+	return &enc_state;
+}
+
+static void test_encoder_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static bool test_encoder_encode(void *data, struct encoder_frame *frame,
+				struct encoder_packet *packet,
+				bool *received_packet)
+{
+	struct test_encoder_state *state = data;
+
+	if (os_atomic_load_bool(&state->hold))
+		os_event_wait(state->resume);
+
+	pthread_mutex_lock(&state->mutex);
+	state->encoded++;
+	pthread_mutex_unlock(&state->mutex);
+
+	if (frame->pts == state->fail_pts)
+		return false;
+
+	packet->data = packet_data;
+	packet->size = sizeof(packet_data);
+	packet->pts = frame->pts;
+	packet->dts = frame->pts;
+	packet->type = OBS_ENCODER_VIDEO;
+	packet->keyframe = true;
+	*received_packet = true;
+	return true;
+}
+
+static struct obs_encoder_info test_encoder = {
+	.id = "encode_queue_test",
+	.type = OBS_ENCODER_VIDEO,
+	.codec = "test",
+	.get_name = test_encoder_name,
+	.create = test_encoder_create,
+	.destroy = test_encoder_destroy,
+	.encode = test_encoder_encode,
+};
+
+static void *test_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct test_output *to = bzalloc(sizeof(*to));
+	UNUSED_PARAMETER(settings);
+	to->output = output;
+	return to;
+}
+
+static void test_output_destroy(void *data)
+{
+	bfree(data);
+}
+
+static bool test_output_start(void *data)
+{
+	struct test_output *to = data;
+
+	pthread_mutex_lock(&enc_state.mutex);
+	to->packets = 0;
+	to->next_pts = 0;
+	to->out_of_order = false;
+	enc_state.encoded = 0;
+	pthread_mutex_unlock(&enc_state.mutex);
+
+	if (!obs_output_can_begin_data_capture(to->output, 0) ||
+	    !obs_output_initialize_encoders(to->output, 0))
+		return false;
+	return obs_output_begin_data_capture(to->output, 0);
+}
+
+static void test_output_stop(void *data, uint64_t ts)
+{
+	struct test_output *to = data;
+	UNUSED_PARAMETER(ts);
+	obs_output_end_data_capture(to->output);
+}
+
+static void test_output_packet(void *data, struct encoder_packet *packet)
+{
+	struct test_output *to = data;
+
+	/* sent when the encoder fails */
+	if (!packet)
+		return;
+
+	pthread_mutex_lock(&enc_state.mutex);
+	if (packet->pts != to->next_pts)
+		to->out_of_order = true;
+	to->next_pts = packet->pts + 1;
+	to->packets++;
+	pthread_mutex_unlock(&enc_state.mutex);
+}
+
+static struct obs_output_info test_output = {
+	.id = "encode_queue_test_output",
+	.flags = OBS_OUTPUT_VIDEO | OBS_OUTPUT_ENCODED,
+	.get_name = test_encoder_name,
+	.create = test_output_create,
+	.destroy = test_output_destroy,
+	.start = test_output_start,
+	.stop = test_output_stop,
+	.encoded_packet = test_output_packet,
+};
+
+struct test_context {
+	obs_encoder_t *encoder;
+	obs_output_t *output;
+	struct test_output *to;
+};
+
+static long get_encoded(void)
+{
+	pthread_mutex_lock(&enc_state.mutex);
+	long encoded = enc_state.encoded;
+	pthread_mutex_unlock(&enc_state.mutex);
+	return encoded;
+}
+
+static long get_packets(struct test_output *to)
+{
+	pthread_mutex_lock(&enc_state.mutex);
+	long packets = to->packets;
+	pthread_mutex_unlock(&enc_state.mutex);
+	return packets;
+}
+
+/* packets the encoder sent out, whether the output still took them or not */
+static uint64_t get_sent_packets(obs_encoder_t *encoder)
+{
+	struct obs_encoder_stats stats;
+	obs_encoder_get_stats(encoder, &stats);
+	return stats.packets;
+}
+
+static bool wait_for_queued(obs_encoder_t *encoder, uint64_t frames)
+{
+	struct obs_encoder_stats stats;
+
+	for (int i = 0; i < WAIT_MS; i++) {
+		obs_encoder_get_stats(encoder, &stats);
+		if (stats.queued_frames >= frames)
+			return true;
+		os_sleep_ms(1);
+	}
+	return false;
+}
+
+static bool wait_for_packets(struct test_output *to, long packets)
+{
+	for (int i = 0; i < WAIT_MS; i++) {
+		if (get_packets(to) >= packets)
+			return true;
+		os_sleep_ms(1);
+	}
+	return false;
+}
+
+static bool wait_for_stopped(struct test_context *ctx)
+{
+	for (int i = 0; i < WAIT_MS; i++) {
+		if (!obs_output_active(ctx->output) &&
+		    !obs_encoder_active(ctx->encoder))
+			return true;
+		os_sleep_ms(1);
+	}
+	return false;
+}
+
+static void stop_output(struct test_context *ctx)
+{
+	obs_output_stop(ctx->output);
+	assert_true(wait_for_stopped(ctx));
+}
+
+static int setup(void **state)
+{
+	struct obs_video_info ovi = {
+		.graphics_module = NULL_GRAPHICS_MODULE,
+		.fps_num = 60,
+		.fps_den = 1,
+		.base_width = 320,
+		.base_height = 240,
+		.output_width = 320,
+		.output_height = 240,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+	struct test_context *ctx;
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return -1;
+	obs_add_data_path(LIBOBS_DATA_PATH "/");
+	if (!obs_set_virtual_clock(true) ||
+	    obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS)
+		return -1;
+
+	pthread_mutex_init(&enc_state.mutex, NULL);
+	os_event_init(&enc_state.resume, OS_EVENT_TYPE_MANUAL);
+	enc_state.fail_pts = -1;
+	obs_register_encoder(&test_encoder);
+	obs_register_output(&test_output);
+
+	ctx = bzalloc(sizeof(*ctx));
+	ctx->encoder = obs_video_encoder_create("encode_queue_test", "queue",
+						NULL, NULL);
+	ctx->output = obs_output_create("encode_queue_test_output", "queue",
+					NULL, NULL);
+	if (!ctx->encoder || !ctx->output)
+		return -1;
+
+	ctx->to = obs_obj_get_data(ctx->output);
+	obs_encoder_set_video(ctx->encoder, obs_get_video());
+	obs_encoder_set_encode_queue_depth(ctx->encoder, QUEUE_DEPTH);
+	obs_output_set_video_encoder(ctx->output, ctx->encoder);
+	*state = ctx;
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	struct test_context *ctx = *state;
+
+	obs_output_release(ctx->output);
+	obs_encoder_release(ctx->encoder);
+	bfree(ctx);
+	obs_shutdown();
+	os_event_destroy(enc_state.resume);
+	pthread_mutex_destroy(&enc_state.mutex);
+	return 0;
+}
+
+/* packets come out in order with continuous pts, also after a restart */
+static void queue_order(void **state)
+{
+	struct test_context *ctx = *state;
+
+	for (int run = 0; run < 2; run++) {
+		uint64_t packets_before = get_sent_packets(ctx->encoder);
+
+		assert_true(obs_output_start(ctx->output));
+		assert_true(wait_for_packets(ctx->to, 30));
+		stop_output(ctx);
+
+		assert_false(ctx->to->out_of_order);
+		assert_int_equal(get_sent_packets(ctx->encoder) -
+					 packets_before,
+				 get_encoded());
+	}
+}
+
+/* frames that were queued when the encoder is stopped are still encoded */
+static void queue_drained_on_stop(void **state)
+{
+	struct test_context *ctx = *state;
+	uint64_t packets_before;
+
+	os_event_reset(enc_state.resume);
+	os_atomic_set_bool(&enc_state.hold, true);
+
+	packets_before = get_sent_packets(ctx->encoder);
+	assert_true(obs_output_start(ctx->output));
+	assert_true(wait_for_queued(ctx->encoder, QUEUE_DEPTH));
+
+	/* stop while the encoder is held with a full queue */
+	obs_output_stop(ctx->output);
+	os_sleep_ms(100);
+
+	os_atomic_set_bool(&enc_state.hold, false);
+	os_event_signal(enc_state.resume);
+	assert_true(wait_for_stopped(ctx));
+
+	assert_true(get_encoded() >= QUEUE_DEPTH + 1);
+	assert_int_equal(get_sent_packets(ctx->encoder) - packets_before,
+			 get_encoded());
+	assert_false(ctx->to->out_of_order);
+}
+
+/* an encoding error stops the encoder from its encode thread, which is
+ * joined when the encoder starts again */
+static void queue_error_stop(void **state)
+{
+	struct test_context *ctx = *state;
+
+	enc_state.fail_pts = 10;
+	assert_true(obs_output_start(ctx->output));
+	assert_true(wait_for_stopped(ctx));
+
+	assert_int_equal(get_encoded(), 11);
+	assert_int_equal(get_packets(ctx->to), 10);
+	assert_false(ctx->to->out_of_order);
+
+	enc_state.fail_pts = -1;
+	assert_true(obs_output_start(ctx->output));
+	assert_true(wait_for_packets(ctx->to, 30));
+	stop_output(ctx);
+
+	assert_false(ctx->to->out_of_order);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(queue_order),
+		cmocka_unit_test(queue_drained_on_stop),
+		cmocka_unit_test(queue_error_stop),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
@@ -0,0 +1,250 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/format-conversion.h>
+
+#include "benchmark.h"
+
+/* not a multiple of any vector width, with odd strides and buffers that
+ * start one byte off so that nothing is aligned */
+#define WIDTH 1926
+#define HEIGHT 1080
+#define STRIDE_PAD 7
+#define BENCH_FRAMES 50
+
+struct planes {
+	uint8_t *alloc[3];
+	uint8_t *data[3];
+	uint32_t linesize[3];
+	size_t size[3];
+};
+
+static void planes_init(struct planes *p, const uint32_t linesize[3],
+			uint32_t rows)
+{
+	memset(p, 0, sizeof(*p));
+
+	for (size_t i = 0; i < 3; i++) {
+		if (!linesize[i])
+			continue;
+
+		/* decompress_422 writes a whole extra line past the end */
+		p->linesize[i] = linesize[i];
+		p->size[i] = (size_t)linesize[i] * (rows + 2);
+		p->alloc[i] = bzalloc(p->size[i] + 1);
+		p->data[i] = p->alloc[i] + 1;
+	}
+}
+
+static void planes_fill(struct planes *p)
+{
+	uint32_t seed = 4321;
+
+	for (size_t i = 0; i < 3; i++) {
+		for (size_t j = 0; j < p->size[i]; j++) {
+			seed = seed * 1664525 + 1013904223;
+			p->data[i][j] = (uint8_t)(seed >> 24);
+		}
+	}
+}
+
+static void planes_free(struct planes *p)
+{
+	for (size_t i = 0; i < 3; i++)
+		bfree(p->alloc[i]);
+}
+
+enum conversion {
+	CONVERT_UYVX_TO_I420,
+	CONVERT_UYVX_TO_NV12,
+	CONVERT_UYVX_TO_I444,
+	CONVERT_420_TO_444,
+	CONVERT_NV12_TO_444,
+	CONVERT_YUY2_TO_444,
+	CONVERT_UYVY_TO_444,
+	CONVERT_COUNT,
+};
+
+static const char *conversion_names[] = {
+	"uyvx -> i420", "uyvx -> nv12", "uyvx -> i444", "i420 -> 444",
+	"nv12 -> 444",  "yuy2 -> 444",  "uyvy -> 444",
+};
+
+static void setup(enum conversion conv, struct planes *in, struct planes *out)
+{
+	const uint32_t packed = WIDTH * 4 + STRIDE_PAD;
+	const uint32_t lum = WIDTH + STRIDE_PAD;
+	const uint32_t half = WIDTH / 2 + STRIDE_PAD;
+
+	switch (conv) {
+	case CONVERT_UYVX_TO_I420:
+		planes_init(in, (uint32_t[3]){packed, 0, 0}, HEIGHT);
+		planes_init(out, (uint32_t[3]){WIDTH, half, half}, HEIGHT);
+		break;
+	case CONVERT_UYVX_TO_NV12:
+		planes_init(in, (uint32_t[3]){packed, 0, 0}, HEIGHT);
+		planes_init(out, (uint32_t[3]){WIDTH, lum, 0}, HEIGHT);
+		break;
+	case CONVERT_UYVX_TO_I444:
+		planes_init(in, (uint32_t[3]){packed, 0, 0}, HEIGHT);
+		planes_init(out, (uint32_t[3]){WIDTH, lum, lum}, HEIGHT);
+		break;
+	case CONVERT_420_TO_444:
+		planes_init(in, (uint32_t[3]){WIDTH, half, half}, HEIGHT);
+		planes_init(out, (uint32_t[3]){packed, 0, 0}, HEIGHT);
+		break;
+	case CONVERT_NV12_TO_444:
+		planes_init(in, (uint32_t[3]){WIDTH, lum, 0}, HEIGHT);
+		planes_init(out, (uint32_t[3]){packed, 0, 0}, HEIGHT);
+		break;
+	case CONVERT_YUY2_TO_444:
+	case CONVERT_UYVY_TO_444:
+		planes_init(in, (uint32_t[3]){packed / 2, 0, 0}, HEIGHT);
+		planes_init(out, (uint32_t[3]){packed, 0, 0}, HEIGHT * 2);
+		break;
+	case CONVERT_COUNT:
+		break;
+	}
+
+	planes_fill(in);
+}
+
+static void convert(const struct format_conversion_funcs *f,
+		    enum conversion conv, struct planes *in, struct planes *out)
+{
+	const uint8_t *const *in_data = (const uint8_t *const *)in->data;
+
+	switch (conv) {
+	case CONVERT_UYVX_TO_I420:
+		f->compress_uyvx_to_i420(in->data[0], in->linesize[0], 0,
+					 HEIGHT, out->data, out->linesize);
+		break;
+	case CONVERT_UYVX_TO_NV12:
+		f->compress_uyvx_to_nv12(in->data[0], in->linesize[0], 0,
+					 HEIGHT, out->data, out->linesize);
+		break;
+	case CONVERT_UYVX_TO_I444:
+		f->convert_uyvx_to_i444(in->data[0], in->linesize[0], 0, HEIGHT,
+					out->data, out->linesize);
+		break;
+	case CONVERT_420_TO_444:
+		f->decompress_420(in_data, in->linesize, 0, HEIGHT,
+				  out->data[0], out->linesize[0]);
+		break;
+	case CONVERT_NV12_TO_444:
+		f->decompress_nv12(in_data, in->linesize, 0, HEIGHT,
+				   out->data[0], out->linesize[0]);
+		break;
+	case CONVERT_YUY2_TO_444:
+	case CONVERT_UYVY_TO_444:
+		f->decompress_422(in->data[0], in->linesize[0], 0, HEIGHT,
+				  out->data[0], out->linesize[0],
+				  conv == CONVERT_YUY2_TO_444);
+		break;
+	case CONVERT_COUNT:
+		break;
+	}
+}
+
+static size_t frame_bytes(const struct planes *in, const struct planes *out)
+{
+	size_t bytes = 0;
+
+	for (size_t i = 0; i < 3; i++)
+		bytes += in->size[i] + out->size[i];
+	return bytes;
+}
+
+/* the SSE2 kernels were the only ones for a long time, so every other set is
+ * held to exactly their output */
+static void conversions_match_sse2(void **state)
+{
+	const struct format_conversion_funcs *sse2 =
+		format_conversion_get_type(FORMAT_CONVERSION_SSE2);
+
+	UNUSED_PARAMETER(state);
+
+	for (int conv = 0; conv < CONVERT_COUNT; conv++) {
+		struct planes in, expected, out;
+
+		setup(conv, &in, &expected);
+		setup(conv, &in, &out);
+		convert(sse2, conv, &in, &expected);
+
+		for (int type = 0; type < FORMAT_CONVERSION_COUNT; type++) {
+			const struct format_conversion_funcs *f =
+				format_conversion_get_type(type);
+			if (!f || f == sse2)
+				continue;
+
+			for (size_t i = 0; i < 3; i++)
+				memset(out.data[i], 0, out.size[i]);
+
+			convert(f, conv, &in, &out);
+
+			for (size_t i = 0; i < 3; i++)
+				assert_memory_equal(out.data[i],
+						    expected.data[i],
+						    out.size[i]);
+		}
+
+		planes_free(&in);
+		planes_free(&expected);
+		planes_free(&out);
+	}
+}
+
+static void conversion_benchmark(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (int conv = 0; conv < CONVERT_COUNT; conv++) {
+		struct planes in, out;
+
+		setup(conv, &in, &out);
+		printf("%-13s", conversion_names[conv]);
+
+		for (int type = 0; type < FORMAT_CONVERSION_COUNT; type++) {
+			const struct format_conversion_funcs *f =
+				format_conversion_get_type(type);
+			if (!f)
+				continue;
+
+			convert(f, conv, &in, &out);
+
+			uint64_t t0 = os_gettime_ns();
+			for (int i = 0; i < BENCH_FRAMES; i++)
+				convert(f, conv, &in, &out);
+			uint64_t t1 = os_gettime_ns();
+
+			double bytes = (double)frame_bytes(&in, &out) *
+				       BENCH_FRAMES;
+			printf("  %s: %6.2f GB/s", f->name,
+			       bytes / (double)(t1 - t0));
+		}
+
+		printf("\n");
+		planes_free(&in);
+		planes_free(&out);
+	}
+
+	printf("selected: %s\n", format_conversion_get()->name);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(conversions_match_sse2),
+	};
+	const struct CMUnitTest benchmarks[] = {
+		cmocka_unit_test(conversion_benchmark),
+	};
+
+	return run_tests_and_benchmarks(tests, benchmarks);
+}
@@ -0,0 +1,247 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs-interleave.h>
+
+/* the list based interleaving that obs-output.c used before, kept here as
+ * the reference the interleaver has to match (plus ordering equal audio
+ * timestamps by track) */
+struct reference_list {
+	DARRAY(struct encoder_packet) packets;
+};
+
+static void reference_insert(struct reference_list *ref,
+			     struct encoder_packet *out)
+{
+	size_t idx;
+	for (idx = 0; idx < ref->packets.num; idx++) {
+		struct encoder_packet *cur_packet = ref->packets.array + idx;
+
+		if (out->dts_usec == cur_packet->dts_usec &&
+		    out->type == OBS_ENCODER_VIDEO &&
+		    cur_packet->type == OBS_ENCODER_VIDEO &&
+		    out->track_idx > cur_packet->track_idx)
+			continue;
+
+		if (out->dts_usec == cur_packet->dts_usec &&
+		    out->type == OBS_ENCODER_VIDEO) {
+			break;
+		} else if (out->dts_usec == cur_packet->dts_usec &&
+			   cur_packet->type == OBS_ENCODER_AUDIO &&
+			   out->track_idx < cur_packet->track_idx) {
+			break;
+		} else if (out->dts_usec < cur_packet->dts_usec) {
+			break;
+		}
+	}
+
+	da_insert(ref->packets, idx, out);
+}
+
+static void reference_resort(struct reference_list *ref)
+{
+	DARRAY(struct encoder_packet) old_array;
+
+	old_array.da = ref->packets.da;
+	memset(&ref->packets, 0, sizeof(ref->packets));
+
+	for (size_t i = 0; i < old_array.num; i++)
+		reference_insert(ref, &old_array.array[i]);
+
+	da_free(old_array);
+}
+
+/* recorded streams: one video frame every 4 ticks and audio frames every
+ * 2, 4 or 3 ticks, so timestamps of different tracks collide often */
+struct track {
+	enum obs_encoder_type type;
+	size_t track_idx;
+	int64_t interval;
+	int64_t next_dts;
+};
+
+static uint32_t rand_state = 1;
+
+static uint32_t next_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return (rand_state >> 16) & 0x7FFF;
+}
+
+static void assert_same_packet(const struct encoder_packet *a,
+			       const struct encoder_packet *b)
+{
+	assert_int_equal(a->type, b->type);
+	assert_int_equal(a->track_idx, b->track_idx);
+	assert_int_equal(a->dts_usec, b->dts_usec);
+	assert_int_equal(a->pts, b->pts);
+}
+
+static void assert_same_order(struct packet_interleaver *il,
+			      struct reference_list *ref)
+{
+	assert_int_equal(il->num, ref->packets.num);
+
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		for (size_t j = 0; j < interleave_queue_size(il, i); j++) {
+			struct interleaved_packet *ip;
+			size_t rank;
+
+			ip = interleave_get(il, i, j);
+			rank = interleave_rank(il, i, j);
+
+			assert_true(rank < ref->packets.num);
+			assert_same_packet(&ip->packet,
+					   ref->packets.array + rank);
+		}
+	}
+}
+
+static void pop_and_compare(struct packet_interleaver *il,
+			    struct reference_list *ref, size_t count)
+{
+	struct encoder_packet packet;
+
+	while (count-- && ref->packets.num) {
+		assert_true(interleave_pop(il, &packet));
+		assert_same_packet(&packet, ref->packets.array);
+		da_erase(ref->packets, 0);
+	}
+}
+
+static void replay(size_t num_video, size_t num_audio, uint32_t seed)
+{
+	struct packet_interleaver il = {0};
+	struct reference_list ref = {0};
+	struct track tracks[INTERLEAVE_QUEUES];
+	size_t num_tracks = num_video + num_audio;
+	int64_t id = 0;
+
+	rand_state = seed;
+
+	for (size_t i = 0; i < num_tracks; i++) {
+		struct track *track = &tracks[i];
+		bool video = i < num_video;
+
+		track->type = video ? OBS_ENCODER_VIDEO : OBS_ENCODER_AUDIO;
+		track->track_idx = video ? i : i - num_video;
+		track->interval = video ? 4 : 2 + (int64_t)(i % 3);
+		track->next_dts = (int64_t)(next_rand() % 4);
+	}
+
+	for (size_t step = 0; step < 2000; step++) {
+		struct track *track = &tracks[next_rand() % num_tracks];
+		struct encoder_packet packet = {0};
+
+		packet.type = track->type;
+		packet.track_idx = track->track_idx;
+		packet.dts_usec = track->next_dts;
+		packet.pts = id++;
+		track->next_dts += track->interval;
+
+		/* encoders deliver late every now and then */
+		if (next_rand() % 8 == 0)
+			track->next_dts += track->interval * 3;
+
+		reference_insert(&ref, &packet);
+		interleave_push(&il, &packet);
+
+		if (step == 500) {
+			/* offsets applied once an output starts up */
+			int64_t offsets[INTERLEAVE_QUEUES];
+
+			for (size_t i = 0; i < INTERLEAVE_QUEUES; i++)
+				offsets[i] = (int64_t)(next_rand() % 7);
+
+			for (size_t i = 0; i < ref.packets.num; i++) {
+				struct encoder_packet *p =
+					ref.packets.array + i;
+				p->dts_usec -= offsets[interleave_queue_idx(
+					p->type, p->track_idx)];
+			}
+
+			interleave_renumber(&il);
+			for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+				for (size_t j = 0;
+				     j < interleave_queue_size(&il, i); j++)
+					interleave_get(&il, i, j)
+						->packet.dts_usec -= offsets[i];
+			}
+
+			reference_resort(&ref);
+			interleave_reheap(&il);
+		}
+
+		if (step % 50 == 0)
+			assert_same_order(&il, &ref);
+
+		pop_and_compare(&il, &ref, next_rand() % 3);
+	}
+
+	assert_same_order(&il, &ref);
+	pop_and_compare(&il, &ref, ref.packets.num);
+	assert_null(interleave_peek(&il));
+
+	interleave_free(&il);
+	da_free(ref.packets);
+}
+
+static void interleave_order_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (uint32_t seed = 1; seed <= 8; seed++) {
+		replay(1, 1, seed);
+		replay(1, MAX_OUTPUT_AUDIO_ENCODERS, seed);
+		replay(3, 2, seed);
+		replay(MAX_OUTPUT_VIDEO_ENCODERS, MAX_OUTPUT_AUDIO_ENCODERS,
+		       seed);
+	}
+}
+
+static void interleave_discard_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct packet_interleaver il = {0};
+	struct encoder_packet packet = {0};
+
+	for (int64_t dts = 0; dts < 10; dts++) {
+		packet.type = OBS_ENCODER_AUDIO;
+		packet.track_idx = 0;
+		packet.dts_usec = dts;
+		interleave_push(&il, &packet);
+
+		packet.type = OBS_ENCODER_VIDEO;
+		packet.dts_usec = dts * 2;
+		interleave_push(&il, &packet);
+	}
+
+	interleave_discard_before(&il, 5);
+	assert_int_equal(il.num, 12);
+	assert_int_equal(interleave_peek(&il)->dts_usec, 5);
+	assert_int_equal(interleave_first(&il, OBS_ENCODER_VIDEO, 0)->dts_usec,
+			 6);
+	assert_int_equal(interleave_last(&il, OBS_ENCODER_AUDIO, 0)->dts_usec,
+			 9);
+
+	interleave_discard(&il, 3);
+	assert_int_equal(il.num, 9);
+	assert_int_equal(interleave_peek(&il)->dts_usec, 7);
+	assert_null(interleave_first(&il, OBS_ENCODER_AUDIO, 1));
+
+	interleave_free(&il);
+	assert_null(interleave_peek(&il));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(interleave_order_test),
+		cmocka_unit_test(interleave_discard_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,111 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/threading.h>
+
+/* NULL_GRAPHICS_MODULE, TEST_INPUT_MODULE, TEST_INPUT_DATA_PATH and
+ * LIBOBS_DATA_PATH are set by the build */
+
+#define TEST_FRAMES 60
+#define WAIT_MS 30000
+
+struct frame_counter {
+	os_event_t *done;
+	volatile long frames;
+	long target;
+	volatile bool missing_data;
+};
+
+static void count_frame(void *param, struct video_data *frame)
+{
+	struct frame_counter *fc = param;
+
+	if (!frame->data[0])
+		fc->missing_data = true;
+	if (os_atomic_inc_long(&fc->frames) == fc->target)
+		os_event_signal(fc->done);
+}
+
+/* starts libobs on the null graphics module with a test-input source on
+ * the main output channel.  the virtual clock renders frames as fast as
+ * possible rather than in real time. */
+static obs_source_t *start_null_obs(uint32_t width, uint32_t height)
+{
+	struct obs_video_info ovi = {
+		.graphics_module = NULL_GRAPHICS_MODULE,
+		.fps_num = 60,
+		.fps_den = 1,
+		.base_width = width,
+		.base_height = height,
+		.output_width = width,
+		.output_height = height,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+	obs_module_t *module;
+	obs_source_t *source;
+
+	assert_true(obs_startup("en-US", NULL, NULL));
+	obs_add_data_path(LIBOBS_DATA_PATH "/");
+	assert_true(obs_set_virtual_clock(true));
+
+	assert_int_equal(obs_reset_video(&ovi), OBS_VIDEO_SUCCESS);
+
+	assert_int_equal(obs_open_module(&module, TEST_INPUT_MODULE,
+					 TEST_INPUT_DATA_PATH),
+			 MODULE_SUCCESS);
+	assert_true(obs_init_module(module));
+
+	source = obs_source_create("random", "random", NULL, NULL);
+	assert_non_null(source);
+	obs_set_output_source(0, source);
+	return source;
+}
+
+static void stop_null_obs(obs_source_t *source)
+{
+	obs_set_output_source(0, NULL);
+	obs_source_release(source);
+	obs_shutdown();
+}
+
+static void render_frames(long frames)
+{
+	struct frame_counter fc = {.target = frames};
+	int ret;
+
+	assert_int_equal(os_event_init(&fc.done, OS_EVENT_TYPE_MANUAL), 0);
+
+	obs_add_raw_video_callback(NULL, count_frame, &fc);
+	ret = os_event_timedwait(fc.done, WAIT_MS);
+	obs_remove_raw_video_callback(count_frame, &fc);
+
+	os_event_destroy(fc.done);
+
+	assert_int_equal(ret, 0);
+	assert_false(fc.missing_data);
+}
+
+static void renders_frames(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_source_t *source = start_null_obs(1280, 720);
+	render_frames(TEST_FRAMES);
+	stop_null_obs(source);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(renders_frames),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
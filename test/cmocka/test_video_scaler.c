@@ -0,0 +1,209 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/video-scaler.h>
+#include <media-io/video-frame.h>
+
+#include "benchmark.h"
+
+#define SRC_WIDTH 3840
+#define SRC_HEIGHT 2160
+#define BENCH_FRAMES 30
+
+static const uint32_t thread_counts[] = {1, 2, 4, 8};
+
+struct scale_case {
+	const char *name;
+	struct video_scale_info src;
+	struct video_scale_info dst;
+	enum video_scale_type type;
+};
+
+static const struct scale_case cases[] = {
+	{
+		"4k i420 -> 1080p i420 bicubic",
+		{VIDEO_FORMAT_I420, SRC_WIDTH, SRC_HEIGHT, VIDEO_RANGE_PARTIAL,
+		 VIDEO_CS_709},
+		{VIDEO_FORMAT_I420, 1920, 1080, VIDEO_RANGE_PARTIAL,
+		 VIDEO_CS_709},
+		VIDEO_SCALE_BICUBIC,
+	},
+	{
+		"4k nv12 -> 4k i444",
+		{VIDEO_FORMAT_NV12, SRC_WIDTH, SRC_HEIGHT, VIDEO_RANGE_PARTIAL,
+		 VIDEO_CS_709},
+		{VIDEO_FORMAT_I444, SRC_WIDTH, SRC_HEIGHT, VIDEO_RANGE_PARTIAL,
+		 VIDEO_CS_709},
+		VIDEO_SCALE_DEFAULT,
+	},
+	{
+		"1080p bgra -> 720p i420 bilinear",
+		{VIDEO_FORMAT_BGRA, 1920, 1080, VIDEO_RANGE_PARTIAL,
+		 VIDEO_CS_709},
+		{VIDEO_FORMAT_I420, 1280, 720, VIDEO_RANGE_PARTIAL,
+		 VIDEO_CS_709},
+		VIDEO_SCALE_BILINEAR,
+	},
+};
+
+#define NUM_CASES (sizeof(cases) / sizeof(cases[0]))
+#define NUM_THREAD_COUNTS (sizeof(thread_counts) / sizeof(thread_counts[0]))
+
+static struct video_frame *create_input(const struct video_scale_info *info)
+{
+	struct video_frame *frame =
+		video_frame_create(info->format, info->width, info->height);
+	uint32_t seed = 12345;
+
+	for (size_t plane = 0; plane < MAX_AV_PLANES; plane++) {
+		if (!frame->data[plane])
+			continue;
+
+		/* smooth gradients with some noise, so that every filter tap
+		 * matters */
+		uint32_t rows = info->height;
+		if (plane && (info->format == VIDEO_FORMAT_I420 ||
+			      info->format == VIDEO_FORMAT_NV12))
+			rows /= 2;
+
+		for (uint32_t y = 0; y < rows; y++) {
+			uint8_t *line = frame->data[plane] +
+					y * frame->linesize[plane];
+			for (uint32_t x = 0; x < frame->linesize[plane]; x++) {
+				seed = seed * 1664525 + 1013904223;
+				line[x] = (uint8_t)(x + y * 3 +
+						    ((seed >> 24) & 15));
+			}
+		}
+	}
+
+	return frame;
+}
+
+static size_t plane_size(const struct video_frame *frame,
+			 const struct video_scale_info *info, size_t plane)
+{
+	uint32_t rows = info->height;
+	if (plane && info->format == VIDEO_FORMAT_I420)
+		rows /= 2;
+	return (size_t)frame->linesize[plane] * rows;
+}
+
+static void scale(video_scaler_t *scaler, struct video_frame *out,
+		  const struct video_frame *in)
+{
+	assert_true(video_scaler_scale(scaler, out->data, out->linesize,
+				       (const uint8_t *const *)in->data,
+				       in->linesize));
+}
+
+/* splitting the frame must not change a single pixel, including around the
+ * band edges where the filter overlaps */
+static void sliced_matches_whole_frame(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (size_t i = 0; i < NUM_CASES; i++) {
+		const struct scale_case *c = &cases[i];
+		struct video_frame *in = create_input(&c->src);
+		struct video_frame *expected = video_frame_create(
+			c->dst.format, c->dst.width, c->dst.height);
+		struct video_frame *out = video_frame_create(
+			c->dst.format, c->dst.width, c->dst.height);
+		video_scaler_t *scaler;
+
+		assert_int_equal(video_scaler_create(&scaler, &c->dst, &c->src,
+						     c->type),
+				 VIDEO_SCALER_SUCCESS);
+		scale(scaler, expected, in);
+		video_scaler_destroy(scaler);
+
+		for (size_t t = 1; t < NUM_THREAD_COUNTS; t++) {
+			assert_int_equal(video_scaler_create2(&scaler, &c->dst,
+							      &c->src, c->type,
+							      thread_counts[t]),
+					 VIDEO_SCALER_SUCCESS);
+			assert_int_equal(video_scaler_get_threads(scaler),
+					 thread_counts[t]);
+
+			scale(scaler, out, in);
+			video_scaler_destroy(scaler);
+
+			for (size_t plane = 0; plane < MAX_AV_PLANES; plane++) {
+				if (!out->data[plane])
+					continue;
+				assert_memory_equal(
+					out->data[plane],
+					expected->data[plane],
+					plane_size(out, &c->dst, plane));
+			}
+		}
+
+		video_frame_destroy(in);
+		video_frame_destroy(expected);
+		video_frame_destroy(out);
+	}
+}
+
+static void scaler_benchmark(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (size_t i = 0; i < NUM_CASES; i++) {
+		const struct scale_case *c = &cases[i];
+		struct video_frame *in = create_input(&c->src);
+		struct video_frame *out = video_frame_create(
+			c->dst.format, c->dst.width, c->dst.height);
+		double base = 0.0;
+
+		printf("%s\n", c->name);
+
+		for (size_t t = 0; t < NUM_THREAD_COUNTS; t++) {
+			video_scaler_t *scaler;
+
+			assert_int_equal(video_scaler_create2(&scaler, &c->dst,
+							      &c->src, c->type,
+							      thread_counts[t]),
+					 VIDEO_SCALER_SUCCESS);
+
+			scale(scaler, out, in);
+
+			uint64_t t0 = os_gettime_ns();
+			for (int f = 0; f < BENCH_FRAMES; f++)
+				scale(scaler, out, in);
+			uint64_t t1 = os_gettime_ns();
+
+			double ms = (double)(t1 - t0) / BENCH_FRAMES / 1e6;
+			if (!base)
+				base = ms;
+
+			printf("  %u threads: %7.2f ms/frame  %7.1f fps  "
+			       "%4.2fx\n",
+			       video_scaler_get_threads(scaler), ms,
+			       1000.0 / ms, base / ms);
+
+			video_scaler_destroy(scaler);
+		}
+
+		video_frame_destroy(in);
+		video_frame_destroy(out);
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(sliced_matches_whole_frame),
+	};
+	const struct CMUnitTest benchmarks[] = {
+		cmocka_unit_test(scaler_benchmark),
+	};
+
+	return run_tests_and_benchmarks(tests, benchmarks);
+}